@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstring>
 
 #include <GL/glew.h>
 #include <SDL.h>
@@ -11,9 +12,11 @@
 #include <glm/glm.hpp> //include the main glm header
 #include <glm/gtc/matrix_transform.hpp> //include functions to ease the calculation of the view and projection matrices
 #include <glm/gtc/type_ptr.hpp> //include functionality for converting a matrix object into a float array for usage in OpenGL
+#include <glm/gtc/quaternion.hpp> //include quaternions, to accumulate the rotate in without it drifting
 
 
 #include "cubeWithColorAndTextureCoordinates.h"
+#include "softwareRasterizer.h" //the game's CPU renderer, from src/3D_matrices
 
 using namespace std;
 
@@ -69,14 +72,16 @@ const std::string strFragmentShader(
 bool done = false;
 
 //the rotate we'll pass to the GLSL
-glm::mat4 rotateMatrix; // the transformation matrix for our object - which is the identity matrix by default
+glm::quat orientation(1.0f, 0.0f, 0.0f, 0.0f); // the accumulated rotate of our object - no rotate to start with
+int stepsSinceNormalize = 0; //rounding slowly pulls orientation off unit length - it is normalized every so often
+glm::mat4 rotateMatrix; // the transformation matrix for our object, built from orientation each frame
 float rotateSpeed = 1.0f; //rate of change of the rotate - in radians per second
 
 
 //our GL and GLSL variables
 
 GLuint theProgram; //GLuint that we'll fill in to refer to the GLSL program (only have 1 at this point)
-GLint positionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
+GLint cubePositionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL (positionLocation is the game's, in shaderVariants.h)
 GLint colorLocation; //GLuint that we'll fill in with the location of the `color` attribute in the GLSL
 GLint vertexUVLocation;
 
@@ -88,6 +93,12 @@ GLuint vao;
 
 GLuint textureID;
 
+//--software draws the same cube on the CPU instead, with no GL context at all
+bool softwareRendering = false;
+SoftwareRasterizer softwareRasterizer;
+SoftwareMesh softwareCube;
+SoftwareTexture softwareTexture;
+
 // end Global Variables
 /////////////////////////
 
@@ -111,7 +122,8 @@ void createWindow()
 	const char *exeNameCStr = exeNameEnd.c_str();
 
 	//create window
-	win = SDL_CreateWindow(exeNameCStr, 100, 100, 600, 600, SDL_WINDOW_OPENGL); //same height and width makes the window square ...
+	Uint32 windowFlags = softwareRendering ? 0 : SDL_WINDOW_OPENGL; //the software renderer blits to the window's surface instead
+	win = SDL_CreateWindow(exeNameCStr, 100, 100, 600, 600, windowFlags); //same height and width makes the window square ...
 
 	//error handling
 	if (win == nullptr)
@@ -263,15 +275,15 @@ void initializeProgram()
 		cout << "GLSL program creation OK! GLUint is: " << theProgram << std::endl;
 	}
 
-	positionLocation = glGetAttribLocation(theProgram, "position");
+	cubePositionLocation = glGetAttribLocation(theProgram, "position");
 	colorLocation = glGetAttribLocation(theProgram, "color");
 	vertexUVLocation = glGetAttribLocation(theProgram, "vertexUV");
 
 	//Error check Attributes
-	if (positionLocation < 0 || vertexUVLocation < 0)
+	if (cubePositionLocation < 0 || vertexUVLocation < 0)
 	{
 		cout << "GLSL getAttributeLocation failed." << std::endl;
-		cout << "positionLocation= " << positionLocation << std::endl;
+		cout << "cubePositionLocation= " << cubePositionLocation << std::endl;
 		cout << "colorLocation= " << colorLocation << std::endl;
 		cout << "vertexUVLocation= " << vertexUVLocation << std::endl;
 		SDL_Quit();
@@ -356,18 +368,72 @@ void loadAssets()
 	cout << "Loaded Assets OK!\n";
 }
 
+void loadSoftwareAssets()
+{
+	if (!createSoftwareRasterizer(softwareRasterizer, 600, 600))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+
+	//the same vertex data the VBO gets - positions, then (unused) colours, then texture coordinates
+	softwareCube.positions = cubeWithColorAndTexturesCoordinates;
+	softwareCube.positionSize = 3;
+	softwareCube.positionStride = 3;
+	softwareCube.uvs = cubeWithColorAndTexturesCoordinates + (3 + 4) * 36;
+	softwareCube.uvStride = 2;
+	softwareCube.colors = nullptr;
+	softwareCube.colorSize = 4;
+	softwareCube.colorStride = 4;
+	softwareCube.normals = nullptr;
+	softwareCube.normalStride = 0;
+	softwareCube.vertexCount = 36;
+	softwareCube.indices = nullptr;
+	softwareCube.indexCount = 0;
+
+	SDL_Surface* image = SDL_LoadBMP("hello.bmp");
+	if (image == NULL)
+	{
+		cout << "image loading (for texture) failed." << std::endl;
+		SDL_Quit();
+		exit(1);
+	}
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ABGR8888, 0); //RGBA byte order, the rasterizer's texel format
+	SDL_FreeSurface(image);
+	if (rgba == NULL)
+	{
+		cout << "texture conversion failed: " << SDL_GetError() << std::endl;
+		SDL_Quit();
+		exit(1);
+	}
+
+	softwareTexture.width = rgba->w;
+	softwareTexture.height = rgba->h;
+	softwareTexture.texels.resize(rgba->w * rgba->h);
+	for (int y = 0; y < rgba->h; y++)
+		memcpy(&softwareTexture.texels[y * rgba->w], (const Uint8 *)rgba->pixels + y * rgba->pitch, rgba->w * 4);
+	SDL_FreeSurface(rgba);
+
+	cout << "Loaded Assets (software) OK!\n";
+}
+
 void updateSimulation(double simLength) //update simulation with an amount of time to simulate for (in seconds)
 {
 
 	//calculate the amount of rotate for this timestep
 	float rotate = (float)simLength * rotateSpeed; //simlength is a double for precision, but rotateSpeedVector in a vector of float, alternatively use glm::dvec3
 
-	//modify the rotateMatrix with the rotate, as a rotate, around the z-axis
+	//modify the orientation with the rotate, as a rotate, around the 45 degree axis
 	const glm::vec3 unitX = glm::vec3(1, 0, 0);
 	const glm::vec3 unitY = glm::vec3(0, 1, 0);
 	const glm::vec3 unitZ = glm::vec3(0, 0, 1);
 	const glm::vec3 unit45 = glm::normalize(glm::vec3(0, 1, 1));
-	rotateMatrix = glm::rotate(rotateMatrix, rotate, unit45);
+	orientation = orientation * glm::angleAxis(rotate, unit45);
+	if (++stepsSinceNormalize >= 60) {
+		orientation = glm::normalize(orientation);
+		stepsSinceNormalize = 0;
+	}
+	rotateMatrix = glm::mat4_cast(orientation); //only the matrix goes to the GLSL
 }
 
 void render()
@@ -378,14 +444,14 @@ void render()
 	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(rotateMatrix)); //upload the rotateMatrix to the appropriate uniform location
 
 	int s = sizeof(cubeWithColorAndTexturesCoordinates);
-	size_t colorData = 0 + sizeof(GL_FLOAT) * 4 * 36; //0 plus number of bytes for position
-	size_t textureData = colorData + sizeof(GL_FLOAT) * 4 * 36; //colorDate plus number of bytes for color
+	size_t colorData = 0 + sizeof(GLfloat) * 3 * 36; //0 plus number of bytes for position
+	size_t textureData = colorData + sizeof(GLfloat) * 4 * 36; //colorDate plus number of bytes for color
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject); //bind positionBufferObject
 
-	glEnableVertexAttribArray(positionLocation);
+	glEnableVertexAttribArray(cubePositionLocation);
 	glEnableVertexAttribArray(vertexUVLocation);
 
-	glVertexAttribPointer(positionLocation, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(cubePositionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0); //w is left to default to 1
 	glVertexAttribPointer(vertexUVLocation, 2, GL_FLOAT, GL_FALSE, 0, (void*)textureData);
 
 	glUniform1i(textureSamplerLocation, 0); //make texture unit 0 feed our textureSampler
@@ -399,9 +465,28 @@ void render()
 	glUseProgram(0); //clean up
 
 }
+void renderSoftware()
+{
+	beginSoftwareFrame(softwareRasterizer, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)); //glClear's default colour
+
+	//the cube is drawn straight into clip space, as the GLSL does - no view or projection
+	FrameParameters frame = FrameParameters();
+	frame.viewMatrix = glm::mat4(1.0f);
+	frame.projectionMatrix = glm::mat4(1.0f);
+	ObjectParameters object;
+	object.modelMatrix = glm::mat4(1.0f);
+	object.rotateMatrix = rotateMatrix;
+
+	drawSoftware(softwareRasterizer, softwareCube, &softwareTexture, SHADER_TEXTURED, true, frame, object);
+	finishSoftwareFrame(softwareRasterizer);
+}
+
 void cleanUp()
 {
-	SDL_GL_DeleteContext(context);
+	if (softwareRendering)
+		destroySoftwareRasterizer(softwareRasterizer);
+	else
+		SDL_GL_DeleteContext(context);
 	SDL_DestroyWindow(win);
 	cout << "Cleaning up OK!\n";
 }
@@ -409,18 +494,30 @@ void cleanUp()
 int main( int argc, char* args[] )
 {
 	exeName = args[0];
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(args[i]) == "--software") softwareRendering = true;
+	}
+
 	//setup
 	//- do just once
 	initialise();
 	createWindow();
-	setGLAttributes();
-	createContext();
-	initGlew();
-    glViewport(0,0, 600, 600);
-
-	//load stuff from files
-	//- usually do just once
-	loadAssets();
+	if (softwareRendering)
+	{
+		loadSoftwareAssets(); //no context, GLEW or GLSL - the rasterizer is all there is
+	}
+	else
+	{
+		setGLAttributes();
+		createContext();
+		initGlew();
+		glViewport(0,0, 600, 600);
+
+		//load stuff from files
+		//- usually do just once
+		loadAssets();
+	}
 
 
 	while (!done && (SDL_GetTicks() < 5000)) //LOOP FROM HERE, for 2000ms (or if done flag is set)
@@ -432,11 +529,19 @@ int main( int argc, char* args[] )
 		  //WARNING - we are always updating by a constant amount of time. This should be tied to how long has elapsed
 		    // see, for example, http://headerphile.blogspot.co.uk/2014/07/part-9-no-more-delays.html
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (softwareRendering)
+		{
+			renderSoftware();
+			presentSoftwareFrame(softwareRasterizer, win); //copy the colour buffer to the window
+		}
+		else
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		render(); //RENDER HERE - PLACEHOLDER
+			render(); //RENDER HERE - PLACEHOLDER
 
-		SDL_GL_SwapWindow(win);; //present the frame buffer to the display (swapBuffers)
+			SDL_GL_SwapWindow(win);; //present the frame buffer to the display (swapBuffers)
+		}
 
 	} //LOOP TO HERE
 
@@ -15,6 +15,8 @@ solution "graphicsExamplesInGitBranches"
 
       files { "**.h", "**.cpp" }
       excludes { "./graphics_dependencies/**" }
+      -- the game's software rasterizer, for --software
+      files { "../src/3D_matrices/softwareRasterizer.h", "../src/3D_matrices/softwareRasterizer.cpp" }
       
       -- where are header files?
       includedirs {
@@ -22,6 +24,10 @@ solution "graphicsExamplesInGitBranches"
                     "/usr/include/SDL2",
                     "./graphics_dependencies/glew-1.11.0/include",
                     "./graphics_dependencies/glm-0.9.5.4/glm",
+                    "./graphics_dependencies/SDL2/include",
+                    "./graphics_dependencies/glew/include",
+                    "./graphics_dependencies/glm",
+                    "../src/3D_matrices",
                   }
 
       -- what libraries need linking to
@@ -1,4 +1,16 @@
 
+-- copy every dll in a dependency's directory next to an executable - not all of them are vendored
+-- (see graphics_dependencies/README.asciidoc), so say which are missing instead of failing at startup
+function copyDlls(dllDir, targetDir)
+   local dlls = os.matchfiles(path.join(dllDir, "*.dll"))
+   if #dlls == 0 then
+      print("No dlls in " .. dllDir .. " - install them as in graphics_dependencies/README.asciidoc")
+   end
+   for _, dll in ipairs(dlls) do
+      os.copyfile(dll, path.join(targetDir, path.getname(dll)))
+   end
+end
+
 -- A solution contains projects, and defines the available configurations
 solution "graphicsByExample"
    configurations { "Debug", "Release"}
@@ -27,6 +39,13 @@ solution "graphicsByExample"
           files { path.join(projectName, "**.h"), path.join(projectName, "**.cpp") } -- build all .h and .cpp files recursively
           excludes { "./graphics_dependencies/**" }  -- don't build files in graphics_dependencies/
 
+          -- the benchmarks time the game's own code - everything in 3D_matrices but its main()
+          if path.getname(projectName) == "benchmarks" then
+             files { "src/3D_matrices/**.h", "src/3D_matrices/**.cpp" }
+             includedirs { "src/3D_matrices" }
+             defines { "PONG_BENCHMARKS" }
+          end
+
 
           -- where are header files?
           -- tag::headers[]
@@ -35,6 +54,10 @@ solution "graphicsByExample"
                         "./graphics_dependencies/SDL2/include",
                         "./graphics_dependencies/glew/include",
                         "./graphics_dependencies/glm",
+                        "./graphics_dependencies/SDL2_image/include",
+                        "./graphics_dependencies/SDL2_ttf/include",
+                        "./graphics_dependencies/ffmpeg/include",
+                        "./graphics_dependencies/assimp/include",
                       }
           configuration { "linux" }
           includedirs {
@@ -46,9 +69,14 @@ solution "graphicsByExample"
 
           -- what libraries need linking to
           configuration "windows"
-             links { "SDL2", "SDL2main", "opengl32", "glew32" }
+             links { "SDL2", "SDL2main", "SDL2_image", "SDL2_ttf", "opengl32", "glew32", "avcodec", "avutil", "swscale" }
+          -- assimp's lib has to match the configuration's C runtime - only the debug one is vendored
+          configuration { "windows", "*Debug" }
+             links { "assimp-vc130-mtd" }
+          configuration { "windows", "*Release" }
+             links { "assimp-vc130-mt" }
           configuration "linux"
-             links { "SDL2", "SDL2main", "GL", "GLEW" }
+             links { "SDL2", "SDL2main", "SDL2_image", "SDL2_ttf", "GL", "GLEW", "EGL", "avcodec", "avutil", "swscale", "assimp" } -- EGL for --headless rendering, libav* for --capture, assimp for models/
           configuration {}
 
 
@@ -56,7 +84,11 @@ solution "graphicsByExample"
           configuration "windows"
           libdirs {
                     "./graphics_dependencies/glew/lib/Release/Win32",
-                    "./graphics_dependencies/SDL2/lib/win32"
+                    "./graphics_dependencies/SDL2/lib/win32",
+                    "./graphics_dependencies/SDL2_image/lib/win32",
+                    "./graphics_dependencies/SDL2_ttf/lib/win32",
+                    "./graphics_dependencies/ffmpeg/lib",
+                    "./graphics_dependencies/assimp/lib"
                   }
           configuration "linux"
                    -- should be installed as in ./graphics_dependencies/README.asciidoc
@@ -80,5 +112,9 @@ solution "graphicsByExample"
           if os.get() == "windows" then
              os.copyfile("./graphics_dependencies/glew/bin/Release/Win32/glew32.dll", path.join(projectName, "glew32.dll"))
              os.copyfile("./graphics_dependencies/SDL2/lib/win32/SDL2.dll", path.join(projectName, "SDL2.dll"))
+             copyDlls("./graphics_dependencies/assimp/bin", projectName)
+             copyDlls("./graphics_dependencies/ffmpeg/bin", projectName) -- avcodec, avutil, swscale and what they load
+             copyDlls("./graphics_dependencies/SDL2_image/lib/win32", projectName) -- SDL2_image, libpng, libjpeg and zlib
+             copyDlls("./graphics_dependencies/SDL2_ttf/lib/win32", projectName) -- SDL2_ttf, freetype and zlib
           end
    end
@@ -0,0 +1,474 @@
+#include "batchTransforms.h"
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define BATCH_TRANSFORMS_SSE
+	#include <xmmintrin.h>
+#endif
+
+//AVX2 is only used if the CPU says so at run time - the build itself stays baseline (GCC and Clang need the
+//kernel marked to compile its intrinsics; MSVC compiles them anywhere)
+#if defined(BATCH_TRANSFORMS_SSE) && (defined(_M_X64) || defined(__x86_64__)) && (defined(_MSC_VER) || defined(__GNUC__))
+	#define BATCH_TRANSFORMS_AVX2
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define AVX2_TARGET
+	#else
+		#define AVX2_TARGET __attribute__((target("avx2")))
+	#endif
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::transformKernels[]
+static void buildWorldMatricesScalar(const TransformArrays &t, size_t first, size_t count, glm::mat4 *worldMatrices)
+{
+	for (size_t i = first; i < count; i++)
+	{
+		const glm::quat rotation(t.rotationW[i], t.rotationX[i], t.rotationY[i], t.rotationZ[i]);
+		worldMatrices[i] = glm::translate(glm::mat4(1.0f), glm::vec3(t.positionX[i], t.positionY[i], t.positionZ[i])) *
+		                   glm::mat4_cast(rotation) *
+		                   glm::scale(glm::mat4(1.0f), glm::vec3(t.scaleX[i], t.scaleY[i], t.scaleZ[i]));
+	}
+}
+
+#ifdef BATCH_TRANSFORMS_SSE
+//four objects at a time: the rotation terms are worked out for all four in each register, then each column is
+//transposed from (x of four objects, y of four, ...) to four objects' (x, y, z, w)
+//returns how far it got - the last few objects are left for a narrower kernel
+static size_t buildWorldMatricesSSE(const TransformArrays &t, size_t first, size_t count, glm::mat4 *worldMatrices)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	size_t i = first;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(t.rotationX + i);
+		const __m128 y = _mm_loadu_ps(t.rotationY + i);
+		const __m128 z = _mm_loadu_ps(t.rotationZ + i);
+		const __m128 w = _mm_loadu_ps(t.rotationW + i);
+		const __m128 sx = _mm_loadu_ps(t.scaleX + i);
+		const __m128 sy = _mm_loadu_ps(t.scaleY + i);
+		const __m128 sz = _mm_loadu_ps(t.scaleZ + i);
+
+		const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		//the same terms as glm::mat3_cast, each column scaled by its axis' scale
+		__m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		__m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		__m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		__m128 c0w = zero;
+		__m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		__m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		__m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		__m128 c1w = zero;
+		__m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		__m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		__m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		__m128 c2w = zero;
+		__m128 c3x = _mm_loadu_ps(t.positionX + i);
+		__m128 c3y = _mm_loadu_ps(t.positionY + i);
+		__m128 c3z = _mm_loadu_ps(t.positionZ + i);
+		__m128 c3w = one;
+
+		_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+		_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+		_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+		_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+		//after the transposes, cNx holds column N of the first object, cNy of the second, and so on
+		float *out = &worldMatrices[i][0][0];
+		_mm_storeu_ps(out + 0, c0x);  _mm_storeu_ps(out + 4, c1x);  _mm_storeu_ps(out + 8, c2x);  _mm_storeu_ps(out + 12, c3x);
+		_mm_storeu_ps(out + 16, c0y); _mm_storeu_ps(out + 20, c1y); _mm_storeu_ps(out + 24, c2y); _mm_storeu_ps(out + 28, c3y);
+		_mm_storeu_ps(out + 32, c0z); _mm_storeu_ps(out + 36, c1z); _mm_storeu_ps(out + 40, c2z); _mm_storeu_ps(out + 44, c3z);
+		_mm_storeu_ps(out + 48, c0w); _mm_storeu_ps(out + 52, c1w); _mm_storeu_ps(out + 56, c2w); _mm_storeu_ps(out + 60, c3w);
+	}
+	return i;
+}
+#endif
+
+#ifdef BATCH_TRANSFORMS_AVX2
+//(x, y, z, w) of eight objects -> each object's column, objects k and k + 4 sharing a register (low and high half)
+AVX2_TARGET static inline void transposeColumn(__m256 x, __m256 y, __m256 z, __m256 w, __m256 columns[4])
+{
+	const __m256 xy0 = _mm256_unpacklo_ps(x, y); //x0 y0 x1 y1 | x4 y4 x5 y5
+	const __m256 xy1 = _mm256_unpackhi_ps(x, y); //x2 y2 x3 y3 | x6 y6 x7 y7
+	const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+	const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+	columns[0] = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)); //objects 0 | 4
+	columns[1] = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)); //1 | 5
+	columns[2] = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)); //2 | 6
+	columns[3] = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)); //3 | 7
+}
+
+//eight objects at a time - as the SSE kernel, with each matrix written as two 32 byte halves
+AVX2_TARGET static size_t buildWorldMatricesAVX2(const TransformArrays &t, size_t first, size_t count, glm::mat4 *worldMatrices)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	size_t i = first;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(t.rotationX + i);
+		const __m256 y = _mm256_loadu_ps(t.rotationY + i);
+		const __m256 z = _mm256_loadu_ps(t.rotationZ + i);
+		const __m256 w = _mm256_loadu_ps(t.rotationW + i);
+		const __m256 sx = _mm256_loadu_ps(t.scaleX + i);
+		const __m256 sy = _mm256_loadu_ps(t.scaleY + i);
+		const __m256 sz = _mm256_loadu_ps(t.scaleZ + i);
+
+		const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		const __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		__m256 column0[4], column1[4], column2[4], column3[4];
+		transposeColumn(_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx),
+		                _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+		                _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+		                zero, column0);
+		transposeColumn(_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+		                _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+		                _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+		                zero, column1);
+		transposeColumn(_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+		                _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+		                _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz),
+		                zero, column2);
+		transposeColumn(_mm256_loadu_ps(t.positionX + i), _mm256_loadu_ps(t.positionY + i), _mm256_loadu_ps(t.positionZ + i),
+		                one, column3);
+
+		float *out = &worldMatrices[i][0][0];
+		for (int k = 0; k < 4; k++)
+		{
+			//columns 0 and 1, then 2 and 3, of objects k (low halves) and k + 4 (high halves)
+			_mm256_storeu_ps(out + 16 * k, _mm256_permute2f128_ps(column0[k], column1[k], 0x20));
+			_mm256_storeu_ps(out + 16 * k + 8, _mm256_permute2f128_ps(column2[k], column3[k], 0x20));
+			_mm256_storeu_ps(out + 16 * (k + 4), _mm256_permute2f128_ps(column0[k], column1[k], 0x31));
+			_mm256_storeu_ps(out + 16 * (k + 4) + 8, _mm256_permute2f128_ps(column2[k], column3[k], 0x31));
+		}
+	}
+	return i;
+}
+
+static bool cpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) //the OS must save the ymm registers too
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+// end::transformKernels[]
+
+// tag::buildWorldMatrices[]
+TransformKernel bestTransformKernel()
+{
+#if defined(BATCH_TRANSFORMS_AVX2)
+	static const TransformKernel best = cpuSupportsAvx2() ? TRANSFORM_KERNEL_AVX2 : TRANSFORM_KERNEL_SSE;
+	return best;
+#elif defined(BATCH_TRANSFORMS_SSE)
+	return TRANSFORM_KERNEL_SSE;
+#else
+	return TRANSFORM_KERNEL_SCALAR;
+#endif
+}
+
+const char *transformKernelName(TransformKernel kernel)
+{
+	switch (kernel)
+	{
+	case TRANSFORM_KERNEL_AVX2: return "AVX2";
+	case TRANSFORM_KERNEL_SSE: return "SSE";
+	default: return "scalar";
+	}
+}
+
+void buildWorldMatrices(TransformKernel kernel, const TransformArrays &transforms, size_t count, glm::mat4 *worldMatrices)
+{
+	if (kernel > bestTransformKernel())
+		kernel = bestTransformKernel();
+
+	size_t done = 0;
+#ifdef BATCH_TRANSFORMS_AVX2
+	if (kernel == TRANSFORM_KERNEL_AVX2)
+		done = buildWorldMatricesAVX2(transforms, done, count, worldMatrices);
+#endif
+#ifdef BATCH_TRANSFORMS_SSE
+	if (kernel >= TRANSFORM_KERNEL_SSE) //AVX2's leftovers too, if there are four or more
+		done = buildWorldMatricesSSE(transforms, done, count, worldMatrices);
+#endif
+	buildWorldMatricesScalar(transforms, done, count, worldMatrices); //remainder (or everything, without SSE)
+}
+
+void buildWorldMatrices(const TransformArrays &transforms, size_t count, glm::mat4 *worldMatrices)
+{
+	buildWorldMatrices(bestTransformKernel(), transforms, count, worldMatrices);
+}
+// end::buildWorldMatrices[]
+
+// tag::orientationKernels[]
+//the slerp correction: t nudged so that nlerp (which moves fastest mid-arc) keeps slerp's constant angular speed
+//a cubic in t, with coefficients fitted over the arc's cosine (from Arseny Kapoulkine's "Approximating slerp")
+static inline float correctedSlerpT(float t, float absCos)
+{
+	const float a = 1.0904f + absCos * (-3.2452f + absCos * (3.55645f - absCos * 1.43519f));
+	const float b = 0.848013f + absCos * (-1.06021f + absCos * 0.215638f);
+	const float k = a * (t - 0.5f) * (t - 0.5f) + b;
+	return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+void integrateOrientations(const OrientationArrays &q, const OrientationArrays &step, size_t count)
+{
+	size_t i = 0;
+#ifdef BATCH_TRANSFORMS_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(q.x + i), y = _mm_loadu_ps(q.y + i), z = _mm_loadu_ps(q.z + i), w = _mm_loadu_ps(q.w + i);
+		const __m128 sx = _mm_loadu_ps(step.x + i), sy = _mm_loadu_ps(step.y + i), sz = _mm_loadu_ps(step.z + i), sw = _mm_loadu_ps(step.w + i);
+		//the Hamilton product q * step
+		const __m128 rw = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(w, sw), _mm_mul_ps(x, sx)), _mm_add_ps(_mm_mul_ps(y, sy), _mm_mul_ps(z, sz)));
+		const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sx), _mm_mul_ps(x, sw)), _mm_sub_ps(_mm_mul_ps(y, sz), _mm_mul_ps(z, sy)));
+		const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sy), _mm_mul_ps(y, sw)), _mm_sub_ps(_mm_mul_ps(z, sx), _mm_mul_ps(x, sz)));
+		const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, sz), _mm_mul_ps(z, sw)), _mm_sub_ps(_mm_mul_ps(x, sy), _mm_mul_ps(y, sx)));
+		_mm_storeu_ps(q.x + i, rx);
+		_mm_storeu_ps(q.y + i, ry);
+		_mm_storeu_ps(q.z + i, rz);
+		_mm_storeu_ps(q.w + i, rw);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const glm::quat result = glm::quat(q.w[i], q.x[i], q.y[i], q.z[i]) * glm::quat(step.w[i], step.x[i], step.y[i], step.z[i]);
+		q.x[i] = result.x;
+		q.y[i] = result.y;
+		q.z[i] = result.z;
+		q.w[i] = result.w;
+	}
+}
+
+void renormalizeOrientations(const OrientationArrays &q, size_t count)
+{
+	size_t i = 0;
+#ifdef BATCH_TRANSFORMS_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(q.x + i), y = _mm_loadu_ps(q.y + i), z = _mm_loadu_ps(q.z + i), w = _mm_loadu_ps(q.w + i);
+		const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+		//a full precision divide - these are only ever slightly off unit length, and the point is to get them exact
+		const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+		_mm_storeu_ps(q.x + i, _mm_mul_ps(x, inverseLength));
+		_mm_storeu_ps(q.y + i, _mm_mul_ps(y, inverseLength));
+		_mm_storeu_ps(q.z + i, _mm_mul_ps(z, inverseLength));
+		_mm_storeu_ps(q.w + i, _mm_mul_ps(w, inverseLength));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const glm::quat result = glm::normalize(glm::quat(q.w[i], q.x[i], q.y[i], q.z[i]));
+		q.x[i] = result.x;
+		q.y[i] = result.y;
+		q.z[i] = result.z;
+		q.w[i] = result.w;
+	}
+}
+
+void slerpOrientations(const OrientationArrays &from, const OrientationArrays &to, float t, const OrientationArrays &result, size_t count)
+{
+	size_t i = 0;
+#ifdef BATCH_TRANSFORMS_SSE
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+	const __m128 tt = _mm_set1_ps(t);
+	const __m128 tHalf = _mm_set1_ps(t - 0.5f);
+	const __m128 tCubic = _mm_set1_ps(t * (t - 0.5f) * (t - 1.0f));
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 ax = _mm_loadu_ps(from.x + i), ay = _mm_loadu_ps(from.y + i), az = _mm_loadu_ps(from.z + i), aw = _mm_loadu_ps(from.w + i);
+		__m128 bx = _mm_loadu_ps(to.x + i), by = _mm_loadu_ps(to.y + i), bz = _mm_loadu_ps(to.z + i), bw = _mm_loadu_ps(to.w + i);
+		const __m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+		//the shorter arc: flip `to` where the cosine is negative
+		const __m128 sign = _mm_and_ps(cosine, signBit);
+		bx = _mm_xor_ps(bx, sign);
+		by = _mm_xor_ps(by, sign);
+		bz = _mm_xor_ps(bz, sign);
+		bw = _mm_xor_ps(bw, sign);
+		const __m128 d = _mm_andnot_ps(signBit, cosine);
+
+		//correctedSlerpT, four at a time
+		const __m128 a = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-3.2452f),
+		                 _mm_mul_ps(d, _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)))))));
+		const __m128 b = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)))));
+		const __m128 k = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(tHalf, tHalf)), b);
+		const __m128 u = _mm_add_ps(tt, _mm_mul_ps(tCubic, k));
+
+		const __m128 oneMinusU = _mm_sub_ps(one, u);
+		const __m128 x = _mm_add_ps(_mm_mul_ps(ax, oneMinusU), _mm_mul_ps(bx, u));
+		const __m128 y = _mm_add_ps(_mm_mul_ps(ay, oneMinusU), _mm_mul_ps(by, u));
+		const __m128 z = _mm_add_ps(_mm_mul_ps(az, oneMinusU), _mm_mul_ps(bz, u));
+		const __m128 w = _mm_add_ps(_mm_mul_ps(aw, oneMinusU), _mm_mul_ps(bw, u));
+		const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+		const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+		_mm_storeu_ps(result.x + i, _mm_mul_ps(x, inverseLength));
+		_mm_storeu_ps(result.y + i, _mm_mul_ps(y, inverseLength));
+		_mm_storeu_ps(result.z + i, _mm_mul_ps(z, inverseLength));
+		_mm_storeu_ps(result.w + i, _mm_mul_ps(w, inverseLength));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const glm::quat a(from.w[i], from.x[i], from.y[i], from.z[i]);
+		glm::quat b(to.w[i], to.x[i], to.y[i], to.z[i]);
+		float cosine = glm::dot(a, b);
+		if (cosine < 0.0f)
+		{
+			b = -b;
+			cosine = -cosine;
+		}
+		const float u = correctedSlerpT(t, cosine);
+		const glm::quat blended = glm::normalize(glm::quat(a.w * (1.0f - u) + b.w * u, a.x * (1.0f - u) + b.x * u,
+		                                                   a.y * (1.0f - u) + b.y * u, a.z * (1.0f - u) + b.z * u));
+		result.x[i] = blended.x;
+		result.y[i] = blended.y;
+		result.z[i] = blended.z;
+		result.w[i] = blended.w;
+	}
+}
+// end::orientationKernels[]
+
+// tag::verifyTransformKernels[]
+//largest difference in any component - q and -q are the same rotation, so it is the signs that match that count
+static float quaternionDifference(const glm::quat &a, glm::quat b)
+{
+	if (glm::dot(a, b) < 0.0f)
+		b = -b;
+	return std::max(std::max(std::fabs(a.x - b.x), std::fabs(a.y - b.y)), std::max(std::fabs(a.z - b.z), std::fabs(a.w - b.w)));
+}
+
+bool verifyTransformKernels(float tolerance)
+{
+	//odd sized, so every kernel's remainder path runs too
+	const size_t count = 67;
+	std::vector<float> values[10];
+	uint32_t random = 12345;
+	for (size_t i = 0; i < count; i++)
+	{
+		float unit[10];
+		for (int v = 0; v < 10; v++)
+		{
+			random = random * 1664525u + 1013904223u;
+			unit[v] = (random >> 8) * (1.0f / 16777216.0f) * 2.0f - 1.0f; //-1 to 1
+		}
+		const glm::quat rotation = glm::normalize(glm::quat(unit[6], unit[3], unit[4], unit[5]));
+		const float transform[10] = { unit[0] * 10.0f, unit[1] * 10.0f, unit[2] * 10.0f,
+		                              rotation.x, rotation.y, rotation.z, rotation.w,
+		                              1.0f + unit[7], 1.0f + unit[8], 1.0f + unit[9] };
+		for (int v = 0; v < 10; v++)
+			values[v].push_back(transform[v]);
+	}
+	const TransformArrays transforms = { &values[0][0], &values[1][0], &values[2][0], &values[3][0], &values[4][0],
+	                                     &values[5][0], &values[6][0], &values[7][0], &values[8][0], &values[9][0] };
+
+	std::vector<glm::mat4> expected(count), actual(count);
+	buildWorldMatricesScalar(transforms, 0, count, &expected[0]);
+	for (int kernel = TRANSFORM_KERNEL_SSE; kernel <= bestTransformKernel(); kernel++)
+	{
+		buildWorldMatrices((TransformKernel)kernel, transforms, count, &actual[0]);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					if (std::fabs(actual[i][column][row] - expected[i][column][row]) > tolerance)
+					{
+						cerr << "Batched transforms: the " << transformKernelName((TransformKernel)kernel) << " kernel differs from glm for object "
+						     << i << " at [" << column << "][" << row << "]: " << actual[i][column][row] << " vs " << expected[i][column][row] << endl;
+						return false;
+					}
+				}
+			}
+		}
+	}
+	//integration and renormalisation against glm's quaternion product, and slerp within its approximation
+	std::vector<float> orientation[4], step[4], target[4], blend[4];
+	for (int c = 0; c < 4; c++)
+	{
+		orientation[c].assign(values[3 + c].begin(), values[3 + c].end());
+		step[c].resize(count);
+		target[c].resize(count);
+		blend[c].resize(count);
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::quat spin = glm::angleAxis(0.02f * (i % 7 + 1), glm::normalize(glm::vec3(values[0][i], values[1][i], values[2][i]) + glm::vec3(0.0f, 0.0f, 20.0f)));
+		const glm::quat other = glm::normalize(glm::quat(values[7][i], values[8][i], values[9][i], values[0][i] * 0.1f));
+		const float spinValues[4] = { spin.x, spin.y, spin.z, spin.w };
+		const float otherValues[4] = { other.x, other.y, other.z, other.w };
+		for (int c = 0; c < 4; c++)
+		{
+			step[c][i] = spinValues[c];
+			target[c][i] = otherValues[c];
+		}
+	}
+	const OrientationArrays orientations = { &orientation[0][0], &orientation[1][0], &orientation[2][0], &orientation[3][0] };
+	const OrientationArrays steps = { &step[0][0], &step[1][0], &step[2][0], &step[3][0] };
+	const OrientationArrays targets = { &target[0][0], &target[1][0], &target[2][0], &target[3][0] };
+	const OrientationArrays blends = { &blend[0][0], &blend[1][0], &blend[2][0], &blend[3][0] };
+	const int integrationSteps = 100;
+	for (int n = 0; n < integrationSteps; n++)
+		integrateOrientations(orientations, steps, count);
+	renormalizeOrientations(orientations, count);
+	const float t = 0.3f;
+	slerpOrientations(orientations, targets, t, blends, count);
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::quat expected(values[6][i], values[3][i], values[4][i], values[5][i]);
+		const glm::quat spin(step[3][i], step[0][i], step[1][i], step[2][i]);
+		for (int n = 0; n < integrationSteps; n++)
+			expected = expected * spin;
+		expected = glm::normalize(expected);
+		const glm::quat actual(orientation[3][i], orientation[0][i], orientation[1][i], orientation[2][i]);
+		const glm::quat other(target[3][i], target[0][i], target[1][i], target[2][i]);
+		const glm::quat expectedBlend = glm::slerp(actual, glm::dot(actual, other) < 0.0f ? -other : other, t);
+		const glm::quat actualBlend(blend[3][i], blend[0][i], blend[1][i], blend[2][i]);
+		//a hundred steps of rounding, in a different order to glm's, is allowed a little more than one matrix
+		if (quaternionDifference(actual, expected) > tolerance * 10.0f || quaternionDifference(actualBlend, expectedBlend) > 1e-3f)
+		{
+			cerr << "Batched transforms: the orientation kernels differ from glm for object " << i << endl;
+			return false;
+		}
+	}
+
+	cout << "Batched transforms (" << transformKernelName(bestTransformKernel()) << ") match glm OK!" << endl;
+	return true;
+}
+// end::verifyTransformKernels[]
@@ -0,0 +1,76 @@
+#ifndef BATCH_TRANSFORMS_H
+#define BATCH_TRANSFORMS_H
+
+#include <cstddef>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::transformArrays[]
+//many objects' transforms, structure-of-arrays - element i of every array is object i
+//rotations are unit quaternions (x, y, z, w), as glm::quat stores them
+struct TransformArrays
+{
+	const float *positionX;
+	const float *positionY;
+	const float *positionZ;
+	const float *rotationX;
+	const float *rotationY;
+	const float *rotationZ;
+	const float *rotationW;
+	const float *scaleX;
+	const float *scaleY;
+	const float *scaleZ;
+};
+// end::transformArrays[]
+
+// tag::buildWorldMatrices[]
+enum TransformKernel
+{
+	TRANSFORM_KERNEL_SCALAR, //glm, one object at a time
+	TRANSFORM_KERNEL_SSE, //four objects at a time
+	TRANSFORM_KERNEL_AVX2, //eight
+};
+
+//the widest kernel this CPU runs - checked once, on first use
+TransformKernel bestTransformKernel();
+const char *transformKernelName(TransformKernel kernel);
+
+//translate * rotate * scale for `count` objects, written packed (e.g. straight into an instance buffer)
+//with the best kernel the CPU supports - worldMatrices needn't be aligned
+void buildWorldMatrices(const TransformArrays &transforms, size_t count, glm::mat4 *worldMatrices);
+
+//the same, with a particular kernel - one the CPU doesn't support falls back to the next narrower
+void buildWorldMatrices(TransformKernel kernel, const TransformArrays &transforms, size_t count, glm::mat4 *worldMatrices);
+
+//build a batch of random transforms with every supported kernel and compare them with glm's
+//translate * mat4_cast * scale - and the orientation kernels below with glm's quaternion functions.
+//Returns false (and says where) if any element is off by more than tolerance. It is left to the benchmarks
+//(and their --verify, for CI) rather than run at every game startup
+bool verifyTransformKernels(float tolerance = 1e-5f);
+// end::buildWorldMatrices[]
+
+// tag::orientationArrays[]
+//unit quaternions, structure-of-arrays - the same layout as TransformArrays' rotation
+struct OrientationArrays
+{
+	float *x;
+	float *y;
+	float *z;
+	float *w;
+};
+
+//spin each orientation by its own step, about its local axes: orientation = orientation * step, as glm::rotate on
+//a matrix does. A constant spin's step is angleAxis(speed * tickLength, axis), worked out once rather than every tick
+void integrateOrientations(const OrientationArrays &orientations, const OrientationArrays &steps, size_t count);
+
+//back to unit length - rounding in each integration step drifts them off it, slowly
+//every few dozen steps is plenty; there's no need to do it every one
+void renormalizeOrientations(const OrientationArrays &orientations, size_t count);
+
+//from[i] towards to[i] by t (0 to 1), along the shorter arc, into result (which may be from or to)
+//nlerp with t corrected for the arc's angle - within 1e-3 of glm::slerp, without a trig function per object
+void slerpOrientations(const OrientationArrays &from, const OrientationArrays &to, float t, const OrientationArrays &result, size_t count);
+// end::orientationArrays[]
+
+#endif
@@ -0,0 +1,245 @@
+#include "clusteredLighting.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define CLUSTERED_LIGHTING_SSE
+	#include <xmmintrin.h>
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::clusterBounds[]
+void initializeLightClusters(LightClusters &clusters)
+{
+	clusters.minX.assign(clusterCount, 0.0f);
+	clusters.minY.assign(clusterCount, 0.0f);
+	clusters.minZ.assign(clusterCount, 0.0f);
+	clusters.maxX.assign(clusterCount, 0.0f);
+	clusters.maxY.assign(clusterCount, 0.0f);
+	clusters.maxZ.assign(clusterCount, 0.0f);
+	clusters.boundsProjection = glm::mat4(0.0f);
+	clusters.nearPlane = 0.0f;
+	clusters.farPlane = 0.0f;
+	clusters.depthScale = 0.0f;
+	clusters.depthBias = 0.0f;
+	clusters.ranges.assign(clusterCount * 2, 0);
+	clusters.lightCount = 0;
+	clusters.assignedCount = 0;
+	clusters.lightBuffer = 0;
+	clusters.lightTexture = 0;
+	clusters.rangeBuffer = 0;
+	clusters.rangeTexture = 0;
+	clusters.indexBuffer = 0;
+	clusters.indexTexture = 0;
+}
+
+//each cluster is a frustum-shaped cell - bound it by the corners of its tile at the slice's near and far depths
+static void buildClusterBounds(LightClusters &clusters, const glm::mat4 &projectionMatrix, float nearPlane, float farPlane)
+{
+	//for glm::perspective, view x = ndc x * distance / P[0][0], and the same for y with P[1][1]
+	const float inverseScaleX = 1.0f / projectionMatrix[0][0];
+	const float inverseScaleY = 1.0f / projectionMatrix[1][1];
+	const float depthRatio = std::log(farPlane / nearPlane);
+
+	for (int slice = 0; slice < clusterSlices; slice++)
+	{
+		const float sliceNear = nearPlane * std::exp(depthRatio * slice / clusterSlices);
+		const float sliceFar = nearPlane * std::exp(depthRatio * (slice + 1) / clusterSlices);
+		for (int tileY = 0; tileY < clusterTilesY; tileY++)
+		{
+			const float ndcY0 = -1.0f + 2.0f * tileY / clusterTilesY;
+			const float ndcY1 = -1.0f + 2.0f * (tileY + 1) / clusterTilesY;
+			for (int tileX = 0; tileX < clusterTilesX; tileX++)
+			{
+				const float ndcX0 = -1.0f + 2.0f * tileX / clusterTilesX;
+				const float ndcX1 = -1.0f + 2.0f * (tileX + 1) / clusterTilesX;
+				const int cluster = (slice * clusterTilesY + tileY) * clusterTilesX + tileX;
+				clusters.minX[cluster] = std::min(ndcX0 * sliceNear, ndcX0 * sliceFar) * inverseScaleX;
+				clusters.maxX[cluster] = std::max(ndcX1 * sliceNear, ndcX1 * sliceFar) * inverseScaleX;
+				clusters.minY[cluster] = std::min(ndcY0 * sliceNear, ndcY0 * sliceFar) * inverseScaleY;
+				clusters.maxY[cluster] = std::max(ndcY1 * sliceNear, ndcY1 * sliceFar) * inverseScaleY;
+				clusters.minZ[cluster] = -sliceFar; //view space looks down -z
+				clusters.maxZ[cluster] = -sliceNear;
+			}
+		}
+	}
+
+	clusters.boundsProjection = projectionMatrix;
+	clusters.nearPlane = nearPlane;
+	clusters.farPlane = farPlane;
+	clusters.depthScale = clusterSlices / depthRatio;
+	clusters.depthBias = -clusterSlices * std::log(nearPlane) / depthRatio;
+}
+// end::clusterBounds[]
+
+// tag::assignLights[]
+#ifndef CLUSTERED_LIGHTING_SSE
+static bool sphereTouchesBox(const LightClusters &clusters, int cluster, const glm::vec3 &center, float radiusSquared)
+{
+	float dx = std::max(std::max(clusters.minX[cluster] - center.x, center.x - clusters.maxX[cluster]), 0.0f);
+	float dy = std::max(std::max(clusters.minY[cluster] - center.y, center.y - clusters.maxY[cluster]), 0.0f);
+	float dz = std::max(std::max(clusters.minZ[cluster] - center.z, center.z - clusters.maxZ[cluster]), 0.0f);
+	return dx * dx + dy * dy + dz * dz <= radiusSquared;
+}
+#endif
+
+//test one light against every tile of one slice, recording a pair for each cluster it touches
+static void assignLightToSlice(LightClusters &clusters, int slice, int light, const glm::vec3 &center, float radius)
+{
+	const int tilesPerSlice = clusterTilesX * clusterTilesY;
+	const int first = slice * tilesPerSlice;
+	const float radiusSquared = radius * radius;
+#ifdef CLUSTERED_LIGHTING_SSE
+	//squared distance from the centre to each box (0 inside), four boxes at a time
+	static_assert((clusterTilesX * clusterTilesY) % 4 == 0, "a slice must be a whole number of SSE vectors");
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 x = _mm_set1_ps(center.x);
+	const __m128 y = _mm_set1_ps(center.y);
+	const __m128 z = _mm_set1_ps(center.z);
+	const __m128 limit = _mm_set1_ps(radiusSquared);
+	for (int tile = 0; tile < tilesPerSlice; tile += 4)
+	{
+		const int cluster = first + tile;
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters.minX[cluster]), x), _mm_sub_ps(x, _mm_loadu_ps(&clusters.maxX[cluster]))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters.minY[cluster]), y), _mm_sub_ps(y, _mm_loadu_ps(&clusters.maxY[cluster]))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&clusters.minZ[cluster]), z), _mm_sub_ps(z, _mm_loadu_ps(&clusters.maxZ[cluster]))), zero);
+		__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distanceSquared, limit));
+		for (; mask; mask &= mask - 1)
+		{
+			int lane = 0;
+			while (!((mask >> lane) & 1))
+				lane++;
+			clusters.pairs.push_back((uint32_t)(cluster + lane) << 16 | (uint32_t)light);
+		}
+	}
+#else
+	for (int tile = 0; tile < tilesPerSlice; tile++)
+	{
+		if (sphereTouchesBox(clusters, first + tile, center, radiusSquared))
+			clusters.pairs.push_back((uint32_t)(first + tile) << 16 | (uint32_t)light);
+	}
+#endif
+}
+
+void buildLightClusters(LightClusters &clusters, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
+                        float nearPlane, float farPlane, const PointLight *lights, int lightCount)
+{
+	if (projectionMatrix != clusters.boundsProjection || nearPlane != clusters.nearPlane || farPlane != clusters.farPlane)
+		buildClusterBounds(clusters, projectionMatrix, nearPlane, farPlane);
+
+	lightCount = std::min(lightCount, maxPointLights);
+	clusters.lightCount = lightCount;
+	clusters.lightData.resize(lightCount * 2);
+	clusters.pairs.clear();
+	for (int light = 0; light < lightCount; light++)
+	{
+		const PointLight &pointLight = lights[light];
+		clusters.lightData[light * 2 + 0] = glm::vec4(pointLight.position, pointLight.radius);
+		clusters.lightData[light * 2 + 1] = glm::vec4(pointLight.color, 0.0f);
+
+		//only the slices the sphere's depth range overlaps need testing
+		const glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(pointLight.position, 1.0f));
+		const float nearest = -center.z - pointLight.radius;
+		const float farthest = -center.z + pointLight.radius;
+		if (farthest < nearPlane || nearest > farPlane)
+			continue;
+		int firstSlice = nearest <= nearPlane ? 0 : (int)(std::log(nearest) * clusters.depthScale + clusters.depthBias);
+		int lastSlice = (int)(std::log(std::min(farthest, farPlane)) * clusters.depthScale + clusters.depthBias);
+		firstSlice = std::min(std::max(firstSlice, 0), clusterSlices - 1);
+		lastSlice = std::min(std::max(lastSlice, 0), clusterSlices - 1);
+		for (int slice = firstSlice; slice <= lastSlice; slice++)
+			assignLightToSlice(clusters, slice, light, center, pointLight.radius);
+	}
+
+	//group the pairs by cluster - a counting sort, since the cluster is the top 16 bits
+	std::fill(clusters.ranges.begin(), clusters.ranges.end(), 0);
+	const size_t pairCount = std::min(clusters.pairs.size(), (size_t)maxClusterLightIndices);
+	for (size_t i = 0; i < pairCount; i++)
+		clusters.ranges[(clusters.pairs[i] >> 16) * 2 + 1]++;
+	uint32_t offset = 0;
+	for (int cluster = 0; cluster < clusterCount; cluster++)
+	{
+		clusters.ranges[cluster * 2] = offset;
+		offset += clusters.ranges[cluster * 2 + 1];
+		clusters.ranges[cluster * 2 + 1] = 0; //counted again as the indices are filled in
+	}
+	clusters.indices.resize(pairCount);
+	for (size_t i = 0; i < pairCount; i++)
+	{
+		const uint32_t cluster = clusters.pairs[i] >> 16;
+		clusters.indices[clusters.ranges[cluster * 2] + clusters.ranges[cluster * 2 + 1]++] = clusters.pairs[i] & 0xFFFF;
+	}
+	clusters.assignedCount = (int)pairCount;
+}
+// end::assignLights[]
+
+// tag::lightClusterBuffers[]
+static void createTextureBuffer(GLuint &buffer, GLuint &texture, GLenum format)
+{
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW); //resized by every upload
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+bool createLightClusterBuffers(LightClusters &clusters)
+{
+	createTextureBuffer(clusters.lightBuffer, clusters.lightTexture, GL_RGBA32F);
+	createTextureBuffer(clusters.rangeBuffer, clusters.rangeTexture, GL_RG32UI);
+	createTextureBuffer(clusters.indexBuffer, clusters.indexTexture, GL_R32UI);
+	if (glGetError() != GL_NO_ERROR)
+	{
+		cerr << "Clustered lighting: texture buffers could not be created." << endl;
+		return false;
+	}
+	cout << "Clustered lighting: " << clusterTilesX << "x" << clusterTilesY << "x" << clusterSlices << " clusters created OK!" << endl;
+	return true;
+}
+
+void destroyLightClusterBuffers(LightClusters &clusters)
+{
+	GLuint textures[] = { clusters.lightTexture, clusters.rangeTexture, clusters.indexTexture };
+	GLuint buffers[] = { clusters.lightBuffer, clusters.rangeBuffer, clusters.indexBuffer };
+	glDeleteTextures(3, textures);
+	glDeleteBuffers(3, buffers);
+	clusters.lightTexture = clusters.rangeTexture = clusters.indexTexture = 0;
+	clusters.lightBuffer = clusters.rangeBuffer = clusters.indexBuffer = 0;
+}
+
+//orphan and refill - the driver hands back fresh storage rather than waiting for last frame's draws
+static void uploadTextureBuffer(GLuint buffer, const void *data, size_t size)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(size, (size_t)16), nullptr, GL_STREAM_DRAW); //never zero-sized, even with no lights
+	if (size > 0)
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+}
+
+void uploadLightClusters(LightClusters &clusters, GLuint firstUnit)
+{
+	uploadTextureBuffer(clusters.lightBuffer, clusters.lightData.empty() ? nullptr : clusters.lightData.data(),
+	                    clusters.lightData.size() * sizeof(glm::vec4));
+	uploadTextureBuffer(clusters.rangeBuffer, clusters.ranges.data(), clusters.ranges.size() * sizeof(uint32_t));
+	uploadTextureBuffer(clusters.indexBuffer, clusters.indices.empty() ? nullptr : clusters.indices.data(),
+	                    clusters.indices.size() * sizeof(uint32_t));
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	const GLuint textures[] = { clusters.lightTexture, clusters.rangeTexture, clusters.indexTexture };
+	for (GLuint i = 0; i < 3; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+// end::lightClusterBuffers[]
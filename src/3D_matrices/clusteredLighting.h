@@ -0,0 +1,77 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::pointLights[]
+const int maxPointLights = 256; //per frame - any more are dropped
+
+//a light that only reaches `radius` - falls off smoothly to nothing there, so it can be assigned to clusters
+struct PointLight
+{
+	glm::vec3 position; //world space
+	float radius;
+	glm::vec3 color;
+};
+// end::pointLights[]
+
+// tag::lightClusters[]
+//the view frustum is divided into clusterTilesX x clusterTilesY screen tiles, each cut into clusterSlices
+//slices exponentially spaced in depth (so near and far clusters are roughly cube shaped)
+const int clusterTilesX = 16;
+const int clusterTilesY = 16;
+const int clusterSlices = 24;
+const int clusterCount = clusterTilesX * clusterTilesY * clusterSlices;
+const int maxClusterLightIndices = 65536; //light references across all clusters - any more are dropped
+
+//which lights touch each cluster - a fragment only shades the lights of the cluster it falls in
+struct LightClusters
+{
+	//view-space bounds of every cluster, tile-major within each slice - structure-of-arrays, so four can be
+	//tested against a light per SSE instruction. Only rebuilt when the projection changes
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	glm::mat4 boundsProjection;
+	float nearPlane;
+	float farPlane;
+	float depthScale; //slice = log(view distance) * depthScale + depthBias
+	float depthBias;
+
+	//built each frame by buildLightClusters
+	std::vector<uint32_t> ranges; //per cluster: first index, count
+	std::vector<uint32_t> indices; //into lightData
+	std::vector<glm::vec4> lightData; //per light: (position, radius), (color, 0)
+	std::vector<uint32_t> pairs; //scratch - (cluster << 16 | light) for every hit, before they are grouped
+	int lightCount;
+	int assignedCount; //light/cluster pairs - the total fragments would shade is around this, not clusterCount * lightCount
+
+	//texture buffers (samplerBuffer/usamplerBuffer in the shader)
+	GLuint lightBuffer;
+	GLuint lightTexture;
+	GLuint rangeBuffer;
+	GLuint rangeTexture;
+	GLuint indexBuffer;
+	GLuint indexTexture;
+};
+
+//CPU side only - call createLightClusterBuffers too before uploading
+void initializeLightClusters(LightClusters &clusters);
+
+//assign lights to clusters for this camera. projection must be a symmetric perspective (glm::perspective)
+void buildLightClusters(LightClusters &clusters, const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
+                        float nearPlane, float farPlane, const PointLight *lights, int lightCount);
+
+bool createLightClusterBuffers(LightClusters &clusters);
+void destroyLightClusterBuffers(LightClusters &clusters);
+
+//upload the last build, and bind the light, range and index textures to units firstUnit to firstUnit + 2
+//GL_TEXTURE0 is left active
+void uploadLightClusters(LightClusters &clusters, GLuint firstUnit);
+// end::lightClusters[]
+
+#endif
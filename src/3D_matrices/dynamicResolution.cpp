@@ -0,0 +1,90 @@
+#include "dynamicResolution.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+bool createDynamicResolution(DynamicResolution &resolution, float budgetMs)
+{
+	resolution.width = 0;
+	resolution.height = 0;
+	resolution.budgetMs = budgetMs;
+	resolution.scale = maxRenderScale;
+	resolution.sceneMs = 0.0;
+	resolution.framesAtScale = 0;
+	resolution.framesIssued = 0;
+	glGenQueries(sceneTimerCount, resolution.timers);
+	return true;
+}
+
+void destroyDynamicResolution(DynamicResolution &resolution)
+{
+	glDeleteQueries(sceneTimerCount, resolution.timers);
+}
+
+// tag::adjustRenderScale[]
+//the scene's cost is close to proportional to its pixel count, so to scale squared - drop straight to the
+//scale that fits the budget when over it, but only creep back up a step at a time (with 20% headroom),
+//so the resolution doesn't oscillate around the budget
+static void adjustRenderScale(DynamicResolution &resolution, double sceneMs)
+{
+	resolution.sceneMs = (resolution.sceneMs == 0.0) ? sceneMs : resolution.sceneMs * 0.8 + sceneMs * 0.2;
+	resolution.framesAtScale++;
+	if (resolution.framesAtScale < sceneTimerCount) //give the average time to settle after each change
+		return;
+
+	float scale = resolution.scale;
+	if (resolution.sceneMs > resolution.budgetMs)
+		scale = resolution.scale * (float)std::sqrt(resolution.budgetMs / resolution.sceneMs);
+	else if (resolution.sceneMs < resolution.budgetMs * 0.8f * 0.8f)
+		scale = resolution.scale + renderScaleStep;
+	scale = std::min(std::max(scale, minRenderScale), maxRenderScale);
+
+	if (std::fabs(scale - resolution.scale) >= renderScaleStep * 0.5f)
+	{
+		resolution.scale = scale;
+		resolution.sceneMs = 0.0;
+		resolution.framesAtScale = 0;
+	}
+}
+// end::adjustRenderScale[]
+
+// tag::beginScene[]
+void beginScene(DynamicResolution &resolution, int drawableWidth, int drawableHeight)
+{
+	//the oldest query is sceneTimerCount frames old - normally done by now, and if not, it's just skipped
+	const GLuint timer = resolution.timers[resolution.framesIssued % sceneTimerCount];
+	if (resolution.framesIssued >= sceneTimerCount)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(timer, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &nanoseconds);
+			adjustRenderScale(resolution, nanoseconds / 1000000.0);
+		}
+	}
+
+	resolution.width = std::max((int)(drawableWidth * resolution.scale + 0.5f), 1);
+	resolution.height = std::max((int)(drawableHeight * resolution.scale + 0.5f), 1);
+	glViewport(0, 0, resolution.width, resolution.height);
+	glBeginQuery(GL_TIME_ELAPSED, timer);
+}
+
+void resolveScene(DynamicResolution &resolution, GLuint sceneFramebuffer, int drawableWidth, int drawableHeight)
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	resolution.framesIssued++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+	const bool native = resolution.width == drawableWidth && resolution.height == drawableHeight;
+	glBlitFramebuffer(0, 0, resolution.width, resolution.height, 0, 0, drawableWidth, drawableHeight,
+	                  GL_COLOR_BUFFER_BIT, native ? GL_NEAREST : GL_LINEAR);
+	glViewport(0, 0, drawableWidth, drawableHeight);
+}
+// end::beginScene[]
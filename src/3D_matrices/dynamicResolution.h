@@ -0,0 +1,41 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cstdint>
+
+#include <GL/glew.h>
+
+// tag::dynamicResolution[]
+const float minRenderScale = 0.5f; //of the drawable's width and height
+const float maxRenderScale = 1.0f;
+const float renderScaleStep = 0.05f;
+const int sceneTimerCount = 4; //GPU timer queries in flight - each is read back sceneTimerCount frames later, so it never stalls
+
+//the 3D scene is drawn into an offscreen target at a fraction of the drawable size, chosen to keep the
+//scene's GPU time within budgetMs, and then upscaled into the window - the HUD goes on top at full resolution
+//the target itself is the drawable's size (so changing the scale never reallocates it), and comes from the render graph
+struct DynamicResolution
+{
+	int width; //the corner of the target drawn into this frame
+	int height;
+
+	float budgetMs;
+	float scale;
+	double sceneMs; //scene GPU time, smoothed - 0 until measured at the current scale
+	int framesAtScale;
+	GLuint timers[sceneTimerCount];
+	uint64_t framesIssued;
+};
+
+bool createDynamicResolution(DynamicResolution &resolution, float budgetMs);
+void destroyDynamicResolution(DynamicResolution &resolution);
+
+//pick this frame's scale from the timings so far, set the viewport to the corner of the target it
+//covers and start timing - draw the scene, into a drawable-sized target, after this
+void beginScene(DynamicResolution &resolution, int drawableWidth, int drawableHeight);
+
+//stop timing, and upscale the scene from sceneFramebuffer into the bound draw framebuffer, with a viewport covering the drawable
+void resolveScene(DynamicResolution &resolution, GLuint sceneFramebuffer, int drawableWidth, int drawableHeight);
+// end::dynamicResolution[]
+
+#endif
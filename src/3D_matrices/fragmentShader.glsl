@@ -1,23 +1,103 @@
 #version 330
-in vec3 fragmentColor;
+//permutations: LIT, TEXTURED and MULTIVIEW are #defined (after #version) by initializeProgram
+in vec3 fragmentColor; //the albedo
+in vec3 fragmentNormal;
 in vec3 fragmentPosition;
 in vec2 Texture;
+in float fragmentViewDepth; //distance along the view direction - picks the cluster slice
 
+#ifdef TEXTURED
 uniform sampler2D tex;
+#endif
+#ifdef LIT
 uniform vec3 lightPosition; 
 uniform vec3 cameraPosition;
 uniform vec3 lightColor;
-uniform int texBool;
+
+//the main light's shadow map (see shadowMap.h) - compared in hardware, which filters 2x2 texels per lookup
+uniform sampler2DShadow shadowMap;
+uniform mat4 shadowMatrix; //world -> shadow map texture coordinates and depth
+uniform float shadowTexelScale; //a texel's width in world units, per unit of w
+
+//the lookup is moved off the surface along its normal - further the more the surface slopes away from the light,
+//where one texel's depth covers the most of it - so a surface doesn't shadow itself with the depth it wrote
+float shadowFactor(vec3 normal, vec3 lightDirection) //1 lit, 0 in shadow
+{
+	float facing = dot(normal, lightDirection);
+	if (facing <= 0.0)
+		return 0.0; //turned away from the light - shadowed by itself, whatever the map says
+	vec4 shadowPosition = shadowMatrix * vec4(fragmentPosition, 1.0);
+	if (shadowPosition.w <= 0.0)
+		return 1.0; //behind the light - outside its frustum
+	float offset = 1.5 * shadowTexelScale * shadowPosition.w * (1.0 - facing);
+	shadowPosition += shadowMatrix * vec4(normal * offset, 0.0);
+	vec3 coord = shadowPosition.xyz / shadowPosition.w;
+	if (coord.z >= 1.0)
+		return 1.0;
+	vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0));
+	float lit = texture(shadowMap, coord + vec3(-0.5 * texel.x, -0.5 * texel.y, 0.0));
+	lit += texture(shadowMap, coord + vec3(0.5 * texel.x, -0.5 * texel.y, 0.0));
+	lit += texture(shadowMap, coord + vec3(-0.5 * texel.x, 0.5 * texel.y, 0.0));
+	lit += texture(shadowMap, coord + vec3(0.5 * texel.x, 0.5 * texel.y, 0.0));
+	return lit * 0.25;
+}
+
+#ifndef MULTIVIEW
+//clustered point lights - the view frustum is cut into tiles x slices clusters, and each fragment
+//only loops over the lights listed for its own cluster (see clusteredLighting.h). The clusters are
+//built for one camera, so the multi-view layout goes without them
+uniform samplerBuffer clusterLightData; //two texels per light: (position, radius), (color, 0)
+uniform usamplerBuffer clusterRanges; //per cluster: first index, count
+uniform usamplerBuffer clusterLightIndices;
+uniform int clusterTilesX;
+uniform int clusterTilesY;
+uniform int clusterSlices;
+uniform vec2 clusterTileSize; //pixels
+uniform vec2 clusterDepthParams; //slice = log(view distance) * x + y
+
+vec3 pointLighting(vec3 normal, vec3 viewDirection)
+{
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), ivec2(clusterTilesX - 1, clusterTilesY - 1));
+	int slice = clamp(int(log(max(fragmentViewDepth, 1e-4)) * clusterDepthParams.x + clusterDepthParams.y), 0, clusterSlices - 1);
+	uvec2 range = texelFetch(clusterRanges, (slice * clusterTilesY + tile.y) * clusterTilesX + tile.x).xy;
+
+	vec3 total = vec3(0.0);
+	for (uint i = 0u; i < range.y; i++)
+	{
+		int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+		vec4 positionRadius = texelFetch(clusterLightData, light * 2);
+		vec3 color = texelFetch(clusterLightData, light * 2 + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - fragmentPosition;
+		float distance = length(toLight);
+		float falloff = clamp(1.0 - (distance * distance) / (positionRadius.w * positionRadius.w), 0.0, 1.0);
+		falloff *= falloff; //smooth, and exactly 0 at the radius, so cutting the light off there doesn't show
+		vec3 lightDirection = toLight / max(distance, 1e-4);
+		float diff = max(dot(normal, lightDirection), 0.0);
+		float spec = pow(max(dot(viewDirection, reflect(-lightDirection, normal)), 0.0), 32);
+		total += (diff + 0.9 * spec) * falloff * color;
+	}
+	return total;
+}
+#endif
+#endif
 
 out vec4 outputColor;
 void main()
 {
+#ifdef TEXTURED
+	vec4 baseColor = texture(tex, Texture);
+#else
+	vec4 baseColor = vec4(1.0);
+#endif
+
+#ifdef LIT
 	//ambient light
 	float ambientStrength = 0.6f;
 	vec3 ambient = ambientStrength * lightColor;
 	
 	//Diffuse lighting
-	vec3 normal = normalize(fragmentColor);
+	vec3 normal = normalize(fragmentNormal);
 	vec3 lightDirection = normalize(lightPosition - fragmentPosition);
 	float diff = max(dot(normal, lightDirection), 0.0);
 	vec3 diffuse = diff * lightColor;
@@ -29,8 +109,18 @@ void main()
 	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0), 32);
 	vec3 specular = specularStrength * spec * lightColor;
 	
-	vec3 result = (ambient + diffuse + specular) * fragmentColor;
-
-		outputColor = texture(tex, Texture) * vec4(result, 1.0f);
+	vec3 result = (ambient + shadowFactor(normal, lightDirection) * (diffuse + specular)) * fragmentColor;
+#ifndef MULTIVIEW
+	result += pointLighting(normal, viewDirection);
+#endif
 
+		outputColor = baseColor * vec4(result, 1.0f);
+#else
+	//unlit - HUD quads and the skybox only need the texture
+	#ifdef TEXTURED
+		outputColor = baseColor;
+	#else
+		outputColor = vec4(fragmentColor, 1.0f);
+	#endif
+#endif
 }
@@ -0,0 +1,157 @@
+#include "framePacing.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::presentMode[]
+const char *presentModeName(PresentMode mode)
+{
+	switch (mode)
+	{
+	case PRESENT_VSYNC: return "vsync";
+	case PRESENT_ADAPTIVE: return "adaptive";
+	case PRESENT_UNCAPPED: return "uncapped";
+	default: return "unknown";
+	}
+}
+
+bool parsePresentMode(const char *name, PresentMode &mode)
+{
+	for (int i = 0; i < PRESENT_MODE_COUNT; i++)
+	{
+		if (strcmp(name, presentModeName((PresentMode)i)) == 0)
+		{
+			mode = (PresentMode)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+PresentMode applyPresentMode(PresentMode mode)
+{
+	const int intervals[PRESENT_MODE_COUNT] = { 1, -1, 0 };
+	if (SDL_GL_SetSwapInterval(intervals[mode]) != 0)
+	{
+		if (mode != PRESENT_ADAPTIVE)
+		{
+			cerr << "SDL_GL_SetSwapInterval(" << intervals[mode] << ") Error: " << SDL_GetError() << endl;
+			return mode;
+		}
+		cerr << "Adaptive vsync is not supported - using vsync" << endl;
+		return applyPresentMode(PRESENT_VSYNC);
+	}
+	cout << "Present mode " << presentModeName(mode) << " OK!" << endl;
+	return mode;
+}
+// end::presentMode[]
+
+// tag::frameLimiter[]
+void createFrameLimiter(FrameLimiter &limiter, double framesPerSecond)
+{
+	limiter.period = framesPerSecond > 0.0 ? (Uint64)(SDL_GetPerformanceFrequency() / framesPerSecond) : 0;
+	limiter.next = SDL_GetPerformanceCounter();
+}
+
+void waitForNextFrame(FrameLimiter &limiter)
+{
+	if (limiter.period == 0)
+		return;
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 spinTicks = (Uint64)(frameLimiterSpinMs * frequency / 1000.0);
+
+	//sleep off most of the wait - the last couple of milliseconds are spun, as a sleep could overshoot them
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now + spinTicks < limiter.next)
+		SDL_Delay((Uint32)((limiter.next - now - spinTicks) * 1000 / frequency));
+	while ((now = SDL_GetPerformanceCounter()) < limiter.next)
+		;
+
+	//deadlines are on a fixed grid, so the average rate is exact - unless we've fallen more than a frame
+	//behind, in which case start the grid again rather than rushing frames out to catch up
+	limiter.next += limiter.period;
+	if (now > limiter.next)
+		limiter.next = now + limiter.period;
+}
+// end::frameLimiter[]
+
+// tag::framesInFlight[]
+void resetInputLatency(InputLatency &latency)
+{
+	latency.latencyMs = 0.0;
+	latency.maxLatencyMs = 0.0;
+	latency.totalLatencyMs = 0.0;
+	latency.samples = 0;
+}
+
+void recordInputLatency(InputLatency &latency, Uint64 inputCounter)
+{
+	if (inputCounter == 0)
+		return;
+	const double milliseconds = (SDL_GetPerformanceCounter() - inputCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+	latency.latencyMs = (latency.samples == 0) ? milliseconds : latency.latencyMs * 0.9 + milliseconds * 0.1;
+	latency.maxLatencyMs = std::max(latency.maxLatencyMs, milliseconds);
+	latency.totalLatencyMs += milliseconds;
+	latency.samples++;
+}
+
+void createFramesInFlight(FramesInFlight &frames, int maxFrames)
+{
+	frames.maxFrames = std::min(std::max(maxFrames, 1), maxFramesInFlightLimit);
+	for (int i = 0; i < maxFramesInFlightLimit; i++)
+	{
+		frames.fences[i] = 0;
+		frames.inputCounters[i] = 0;
+	}
+	frames.oldest = 0;
+	frames.count = 0;
+	resetInputLatency(frames.latency);
+}
+
+void destroyFramesInFlight(FramesInFlight &frames)
+{
+	for (int i = 0; i < frames.count; i++)
+		glDeleteSync(frames.fences[(frames.oldest + i) % maxFramesInFlightLimit]);
+	frames.count = 0;
+}
+
+//retire the oldest frame - wait for it if `block`, otherwise only if it is already done
+static bool retireOldestFrame(FramesInFlight &frames, bool block)
+{
+	GLsync fence = frames.fences[frames.oldest];
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (block && result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms
+	if (result == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	recordInputLatency(frames.latency, frames.inputCounters[frames.oldest]);
+	glDeleteSync(fence);
+	frames.oldest = (frames.oldest + 1) % maxFramesInFlightLimit;
+	frames.count--;
+	return true;
+}
+
+void waitForFramesInFlight(FramesInFlight &frames)
+{
+	while (frames.count > 0 && retireOldestFrame(frames, false))
+		;
+	while (frames.count >= frames.maxFrames)
+		retireOldestFrame(frames, true);
+}
+
+void fenceFrame(FramesInFlight &frames, Uint64 inputCounter)
+{
+	if (frames.count == maxFramesInFlightLimit) //only if waitForFramesInFlight wasn't called
+		retireOldestFrame(frames, true);
+	const int slot = (frames.oldest + frames.count) % maxFramesInFlightLimit;
+	frames.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frames.inputCounters[slot] = inputCounter;
+	frames.count++;
+}
+// end::framesInFlight[]
@@ -0,0 +1,86 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <cstdint>
+
+#include <GL/glew.h>
+#include <SDL.h>
+
+// tag::presentMode[]
+enum PresentMode
+{
+	PRESENT_VSYNC, //swap interval 1 - wait for vertical blank
+	PRESENT_ADAPTIVE, //swap interval -1 - vsync, but late frames are shown straight away (tears instead of stutters)
+	PRESENT_UNCAPPED, //swap interval 0 - as fast as possible, tearing
+	PRESENT_MODE_COUNT
+};
+
+const char *presentModeName(PresentMode mode);
+
+//parse "vsync", "adaptive" or "uncapped" - returns false for anything else
+bool parsePresentMode(const char *name, PresentMode &mode);
+
+//SDL_GL_SetSwapInterval for the current context - adaptive falls back to vsync where it isn't supported
+//returns the mode actually in use
+PresentMode applyPresentMode(PresentMode mode);
+// end::presentMode[]
+
+// tag::frameLimiter[]
+const double frameLimiterSpinMs = 2.0; //sleep until this close to the deadline, then spin - SDL_Delay can overshoot by a scheduler tick
+
+//caps the frame rate on the performance counter (a monotonic clock), independently of the swap interval
+struct FrameLimiter
+{
+	Uint64 period; //counter ticks per frame - 0 for no limit
+	Uint64 next; //when the next frame may start
+};
+
+//framesPerSecond of 0 or less doesn't limit at all
+void createFrameLimiter(FrameLimiter &limiter, double framesPerSecond);
+
+//block until the next frame is due - call once per frame, before rendering
+void waitForNextFrame(FrameLimiter &limiter);
+// end::frameLimiter[]
+
+// tag::framesInFlight[]
+const int maxFramesInFlightLimit = 4;
+
+//input-to-present latency: from the newest input a frame shows to that frame being finished
+struct InputLatency
+{
+	double latencyMs; //smoothed
+	double maxLatencyMs;
+	double totalLatencyMs;
+	uint64_t samples;
+};
+
+void resetInputLatency(InputLatency &latency);
+
+//add a sample, from inputCounter (SDL_GetPerformanceCounter) until now - 0 means the frame showed no new input
+void recordInputLatency(InputLatency &latency, Uint64 inputCounter);
+
+//the frames the GPU hasn't finished yet, each with the moment of the newest input it shows (or 0) -
+//capping how many can be queued is what keeps input latency down when the GPU is the bottleneck
+struct FramesInFlight
+{
+	int maxFrames; //1 to maxFramesInFlightLimit
+	GLsync fences[maxFramesInFlightLimit];
+	Uint64 inputCounters[maxFramesInFlightLimit];
+	int oldest;
+	int count;
+	InputLatency latency; //measured when each frame's fence signals
+};
+
+void createFramesInFlight(FramesInFlight &frames, int maxFrames);
+void destroyFramesInFlight(FramesInFlight &frames);
+
+//collect finished frames (for the latency), and block until fewer than maxFrames are still queued
+//call before starting to render a frame
+void waitForFramesInFlight(FramesInFlight &frames);
+
+//fence the frame just submitted - call straight after the swap. inputCounter is when the newest input
+//this frame is the first to show happened (SDL_GetPerformanceCounter), or 0
+void fenceFrame(FramesInFlight &frames, Uint64 inputCounter);
+// end::framesInFlight[]
+
+#endif
@@ -0,0 +1,115 @@
+#include "frustumCulling.h"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define FRUSTUM_CULLING_SSE
+	#include <xmmintrin.h>
+#endif
+
+// tag::extractFrustum[]
+Frustum extractFrustum(const glm::mat4 &viewProjection)
+{
+	//glm is column-major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = row3 + row0; //left
+	frustum.planes[1] = row3 - row0; //right
+	frustum.planes[2] = row3 + row1; //bottom
+	frustum.planes[3] = row3 - row1; //top
+	frustum.planes[4] = row3 + row2; //near
+	frustum.planes[5] = row3 - row2; //far
+
+	//normalise, so plane distances are in world units and can be compared to radii
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(frustum.planes[i]));
+		if (length > 0.0f)
+			frustum.planes[i] /= length;
+	}
+	return frustum;
+}
+// end::extractFrustum[]
+
+// tag::boundingVolumes[]
+BoundingBox boundingBoxOf(const float *positions, size_t vertexCount, size_t stride)
+{
+	BoundingBox box;
+	box.minimum = glm::vec3(0.0f);
+	box.maximum = glm::vec3(0.0f);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 p(positions[i * stride + 0], positions[i * stride + 1], positions[i * stride + 2]);
+		box.minimum = i == 0 ? p : glm::min(box.minimum, p);
+		box.maximum = i == 0 ? p : glm::max(box.maximum, p);
+	}
+	return box;
+}
+
+BoundingSphere boundingSphereOf(const BoundingBox &box)
+{
+	BoundingSphere sphere;
+	sphere.center = (box.minimum + box.maximum) * 0.5f;
+	sphere.radius = glm::length(box.maximum - sphere.center);
+	return sphere;
+}
+// end::boundingVolumes[]
+
+// tag::cullSpheresImpl[]
+static bool sphereVisible(const Frustum &frustum, float x, float y, float z, float r)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4 &plane = frustum.planes[p];
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < -r)
+			return false;
+	}
+	return true;
+}
+
+void cullSpheres(const Frustum &frustum, const float *centerX, const float *centerY, const float *centerZ,
+                 const float *radius, size_t count, uint8_t *visible)
+{
+	size_t i = 0;
+#ifdef FRUSTUM_CULLING_SSE
+	//splat each plane once, then test four spheres at a time
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(centerX + i);
+		__m128 y = _mm_loadu_ps(centerY + i);
+		__m128 z = _mm_loadu_ps(centerZ + i);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+		__m128 inside = _mm_cmpeq_ps(x, x); //all ones (centres are never NaN)
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+			                             _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		visible[i + 0] = (mask >> 0) & 1;
+		visible[i + 1] = (mask >> 1) & 1;
+		visible[i + 2] = (mask >> 2) & 1;
+		visible[i + 3] = (mask >> 3) & 1;
+	}
+#endif
+	//remainder (or everything, without SSE)
+	for (; i < count; i++)
+		visible[i] = sphereVisible(frustum, centerX[i], centerY[i], centerZ[i], radius[i]) ? 1 : 0;
+}
+// end::cullSpheresImpl[]
@@ -0,0 +1,47 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::frustum[]
+//six planes (left, right, bottom, top, near, far) as (normal, distance), normals point inwards
+//a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+//Gribb/Hartmann plane extraction - works for any projection * view matrix
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+// end::frustum[]
+
+// tag::bounds[]
+struct BoundingBox
+{
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center;
+	float radius;
+};
+
+//local-space bounds of tightly packed xyz positions, `stride` floats apart
+BoundingBox boundingBoxOf(const float *positions, size_t vertexCount, size_t stride);
+BoundingSphere boundingSphereOf(const BoundingBox &box);
+// end::bounds[]
+
+// tag::cullSpheres[]
+//world-space spheres, structure-of-arrays so four can be tested per SSE instruction
+//visible[i] is set to 1 if sphere i touches the frustum, 0 if it is entirely outside a plane
+void cullSpheres(const Frustum &frustum, const float *centerX, const float *centerY, const float *centerZ,
+                 const float *radius, size_t count, uint8_t *visible);
+// end::cullSpheres[]
+
+#endif
@@ -0,0 +1,39 @@
+#version 330
+#extension GL_ARB_viewport_array : require
+//MULTIVIEW variants only - each triangle is submitted once and fanned out here to every view's viewport
+//the vertex shader leaves positions in world space, and its outputs renamed geometry* (see vertexShader.glsl)
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 15) out; //3 * maxViews
+
+in vec3 geometryPosition[];
+in vec3 geometryColor[];
+in vec3 geometryNormal[];
+in vec2 geometryTexture[];
+
+out vec3 fragmentPosition;
+out vec3 fragmentColor;
+out vec3 fragmentNormal;
+out vec2 Texture;
+out float fragmentViewDepth;
+
+uniform int viewCount;
+uniform mat4 viewProjections[5]; //maxViews in shaderVariants.h
+
+void main()
+{
+	for (int view = 0; view < viewCount; view++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			gl_ViewportIndex = view;
+			gl_Position = viewProjections[view] * gl_in[i].gl_Position;
+			fragmentPosition = geometryPosition[i];
+			fragmentColor = geometryColor[i];
+			fragmentNormal = geometryNormal[i];
+			Texture = geometryTexture[i];
+			fragmentViewDepth = 0.0; //no point light clusters with several views
+			EmitVertex();
+		}
+		EndPrimitive();
+	}
+}
@@ -0,0 +1,221 @@
+#include "headless.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <SDL.h>
+
+#if defined(__linux__)
+	#define HEADLESS_EGL
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::createHeadlessContext[]
+bool createHeadlessContext(HeadlessContext &headless, int width, int height)
+{
+	headless.display = nullptr;
+	headless.context = nullptr;
+	headless.width = width;
+	headless.height = height;
+	headless.framebuffer = 0;
+	headless.colorRenderbuffer = 0;
+	headless.depthRenderbuffer = 0;
+
+#ifdef HEADLESS_EGL
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay == nullptr)
+	{
+		cerr << "Headless: eglGetPlatformDisplayEXT is not available." << endl;
+		return false;
+	}
+
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		cerr << "Headless: could not initialise a surfaceless EGL display (EGL error 0x" << std::hex << eglGetError() << std::dec << ")." << endl;
+		return false;
+	}
+	cout << "Headless: EGL " << major << "." << minor << " initialised OK!\n";
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		cerr << "Headless: desktop OpenGL is not supported by this EGL." << endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+	//same version and profile as setGLAttributes asks SDL for
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, configCount > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		cerr << "Headless: could not create a GL 3.3 core context (EGL error 0x" << std::hex << eglGetError() << std::dec << ")." << endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	headless.display = display;
+	headless.context = context;
+	cout << "Headless: created OpenGL context OK!\n";
+	return true;
+#else
+	cerr << "Headless rendering needs EGL, which this build doesn't have." << endl;
+	return false;
+#endif
+}
+// end::createHeadlessContext[]
+
+// tag::createHeadlessFramebuffer[]
+bool createHeadlessFramebuffer(HeadlessContext &headless)
+{
+	glGenRenderbuffers(1, &headless.colorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, headless.colorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, headless.width, headless.height);
+
+	glGenRenderbuffers(1, &headless.depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, headless.depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, headless.width, headless.height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &headless.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, headless.framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless.colorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headless.depthRenderbuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		cerr << "Headless: framebuffer is incomplete." << endl;
+		return false;
+	}
+	//left bound - everything render() draws now lands in the FBO
+	cout << "Headless: framebuffer created OK! GLUint is: " << headless.framebuffer << endl;
+	return true;
+}
+// end::createHeadlessFramebuffer[]
+
+void destroyHeadlessContext(HeadlessContext &headless)
+{
+	if (headless.framebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &headless.framebuffer);
+		glDeleteRenderbuffers(1, &headless.colorRenderbuffer);
+		glDeleteRenderbuffers(1, &headless.depthRenderbuffer);
+	}
+#ifdef HEADLESS_EGL
+	if (headless.display)
+	{
+		eglMakeCurrent((EGLDisplay)headless.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)headless.display, (EGLContext)headless.context);
+		eglTerminate((EGLDisplay)headless.display);
+	}
+#endif
+	headless.display = nullptr;
+	headless.context = nullptr;
+}
+
+// tag::readHeadlessFrame[]
+std::vector<unsigned char> readHeadlessFrame(const HeadlessContext &headless)
+{
+	const size_t rowSize = headless.width * 4;
+	std::vector<unsigned char> pixels(rowSize * headless.height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, headless.framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, headless.width, headless.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	//GL reads bottom row first - flip so row 0 is the top, like the image files
+	std::vector<unsigned char> row(rowSize);
+	for (int y = 0; y < headless.height / 2; y++)
+	{
+		unsigned char *top = &pixels[y * rowSize];
+		unsigned char *bottom = &pixels[(headless.height - 1 - y) * rowSize];
+		std::copy(top, top + rowSize, row.begin());
+		std::copy(bottom, bottom + rowSize, top);
+		std::copy(row.begin(), row.end(), bottom);
+	}
+	return pixels;
+}
+// end::readHeadlessFrame[]
+
+// tag::goldenImagesImpl[]
+bool saveFrameBMP(const std::string &filePath, const std::vector<unsigned char> &pixels, int width, int height)
+{
+	SDL_Surface *surface = SDL_CreateRGBSurfaceFrom((void *)pixels.data(), width, height, 32, width * 4,
+	                                                0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000); //RGBA bytes, little endian
+	if (surface == nullptr)
+	{
+		cerr << "Could not wrap frame for saving: " << SDL_GetError() << endl;
+		return false;
+	}
+	bool saved = SDL_SaveBMP(surface, filePath.c_str()) == 0;
+	SDL_FreeSurface(surface);
+	if (!saved)
+		cerr << "Could not save " << filePath << ": " << SDL_GetError() << endl;
+	return saved;
+}
+
+double compareWithGolden(const std::string &filePath, const std::vector<unsigned char> &pixels, int width, int height, int tolerance)
+{
+	SDL_Surface *loaded = SDL_LoadBMP(filePath.c_str());
+	if (loaded == nullptr)
+	{
+		cerr << "Golden image " << filePath << " could not be loaded: " << SDL_GetError() << endl;
+		return 1.0;
+	}
+	SDL_Surface *golden = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ABGR8888, 0); //RGBA byte order
+	SDL_FreeSurface(loaded);
+	if (golden == nullptr || golden->w != width || golden->h != height)
+	{
+		cerr << "Golden image " << filePath << " is not " << width << "x" << height << endl;
+		if (golden)
+			SDL_FreeSurface(golden);
+		return 1.0;
+	}
+
+	size_t mismatched = 0;
+	SDL_LockSurface(golden);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char *goldenRow = (const unsigned char *)golden->pixels + y * golden->pitch;
+		const unsigned char *frameRow = &pixels[y * width * 4];
+		for (int x = 0; x < width; x++)
+		{
+			//alpha isn't stored in the BMP, so only compare RGB
+			for (int c = 0; c < 3; c++)
+			{
+				if (std::abs((int)goldenRow[x * 4 + c] - (int)frameRow[x * 4 + c]) > tolerance)
+				{
+					mismatched++;
+					break;
+				}
+			}
+		}
+	}
+	SDL_UnlockSurface(golden);
+	SDL_FreeSurface(golden);
+
+	return (double)mismatched / ((double)width * height);
+}
+// end::goldenImagesImpl[]
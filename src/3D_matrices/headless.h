@@ -0,0 +1,45 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// tag::headless[]
+//a GL 3.3 core context with no window and no display - rendering goes into an FBO instead
+//uses EGL with EGL_MESA_platform_surfaceless, so it works on build boxes with Mesa (llvmpipe)
+//and no X server or GPU. Only available on Linux, elsewhere createHeadlessContext returns false.
+struct HeadlessContext
+{
+	void *display; //EGLDisplay
+	void *context; //EGLContext
+	int width;
+	int height;
+	GLuint framebuffer;
+	GLuint colorRenderbuffer;
+	GLuint depthRenderbuffer;
+};
+
+//create and make current the context - call before initGlew
+bool createHeadlessContext(HeadlessContext &headless, int width, int height);
+
+//create and bind the FBO everything is rendered into - call after initGlew
+bool createHeadlessFramebuffer(HeadlessContext &headless);
+
+void destroyHeadlessContext(HeadlessContext &headless);
+
+//read back the FBO as tightly packed RGBA, top row first
+std::vector<unsigned char> readHeadlessFrame(const HeadlessContext &headless);
+// end::headless[]
+
+// tag::goldenImages[]
+//write RGBA pixels (top row first) as a BMP
+bool saveFrameBMP(const std::string &filePath, const std::vector<unsigned char> &pixels, int width, int height);
+
+//compare against a golden BMP - returns the fraction of pixels with any channel more than
+//`tolerance` away from the golden image (1.0 if the golden image is missing or the wrong size)
+double compareWithGolden(const std::string &filePath, const std::vector<unsigned char> &pixels, int width, int height, int tolerance);
+// end::goldenImages[]
+
+#endif
@@ -0,0 +1,141 @@
+#include "imageLoader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+
+#include <SDL.h>
+#include <SDL_image.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::findImage[]
+std::string findImage(const std::string &name)
+{
+	//compressed first - the .bmp is only there for assets that haven't been converted
+	const char *extensions[] = { ".png", ".jpg", ".bmp" };
+	for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+	{
+		SDL_RWops *file = SDL_RWFromFile((name + extensions[i]).c_str(), "rb");
+		if (file)
+		{
+			SDL_RWclose(file);
+			return name + extensions[i];
+		}
+	}
+	return "";
+}
+// end::findImage[]
+
+// tag::decodeImage[]
+bool convertDecodedSurface(DecodedImage &image, SDL_Surface *surface)
+{
+	//whatever the file held (paletted, RGB, RGBA, BGR for a .bmp), it comes out as the one format every renderer takes
+	SDL_Surface *rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0);
+	if (rgba == nullptr)
+	{
+		cerr << "Image " << image.filePath << " could not be converted: " << SDL_GetError() << endl;
+		return false;
+	}
+
+	image.width = rgba->w;
+	image.height = rgba->h;
+	image.texels.resize(image.width * image.height);
+	for (int y = 0; y < image.height; y++)
+	{
+		const uint32_t *row = (const uint32_t *)((const char *)rgba->pixels + y * rgba->pitch);
+		std::copy(row, row + image.width, image.texels.begin() + y * image.width);
+	}
+	SDL_FreeSurface(rgba);
+	return true;
+}
+
+static bool decodeImage(DecodedImage &image, const std::string &name)
+{
+	image.width = 0;
+	image.height = 0;
+	image.texels.clear();
+	image.filePath = findImage(name);
+	if (image.filePath.empty())
+	{
+		cerr << "Image " << name << " (.png, .jpg or .bmp) could not be found" << endl;
+		return false;
+	}
+
+	SDL_Surface *surface = IMG_Load(image.filePath.c_str());
+	if (surface == nullptr)
+	{
+		cerr << "Image could not be loaded from " << image.filePath << ": " << IMG_GetError() << endl;
+		return false;
+	}
+	const bool converted = convertDecodedSurface(image, surface);
+	SDL_FreeSurface(surface);
+	return converted;
+}
+// end::decodeImage[]
+
+// tag::decodeImages[]
+//shared by the pool - each thread takes the next image until there are none left
+struct DecodeJob
+{
+	const std::vector<std::string> *names;
+	std::vector<DecodedImage> *images;
+	std::atomic<size_t> next;
+	std::atomic<bool> failed;
+};
+
+static int decodeThreadMain(void *data)
+{
+	DecodeJob &job = *(DecodeJob *)data;
+	for (size_t i = job.next++; i < job.names->size(); i = job.next++)
+	{
+		if (!decodeImage((*job.images)[i], (*job.names)[i]))
+			job.failed = true;
+	}
+	return 0;
+}
+
+bool decodeImages(const std::vector<std::string> &names, std::vector<DecodedImage> &images)
+{
+	images.resize(names.size());
+	if (names.empty())
+		return true;
+
+	//loads the PNG and JPEG libraries up front, rather than racing to on the first image of each kind
+	const int formats = IMG_INIT_PNG | IMG_INIT_JPG;
+	if ((IMG_Init(formats) & formats) != formats)
+		cerr << "IMG_Init: " << IMG_GetError() << " - only the formats that loaded can be decoded" << endl;
+
+	DecodeJob job;
+	job.names = &names;
+	job.images = &images;
+	job.next = 0;
+	job.failed = false;
+
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const int threadCount = (int)std::min<size_t>(std::max(SDL_GetCPUCount(), 1), names.size());
+	std::vector<SDL_Thread *> threads;
+	for (int i = 1; i < threadCount; i++) //the calling thread is the last one
+	{
+		SDL_Thread *thread = SDL_CreateThread(decodeThreadMain, "imageDecode", &job);
+		if (thread == nullptr)
+		{
+			cerr << "Image decode: SDL_CreateThread Error: " << SDL_GetError() << " - decoding on fewer threads" << endl;
+			break;
+		}
+		threads.push_back(thread);
+	}
+	decodeThreadMain(&job);
+	for (size_t i = 0; i < threads.size(); i++)
+		SDL_WaitThread(threads[i], nullptr);
+	IMG_Quit();
+
+	if (job.failed)
+		return false;
+	const double milliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	cout << "Decoded " << names.size() << " images on " << threads.size() + 1 << " threads in " << milliseconds << " ms OK!" << endl;
+	return true;
+}
+// end::decodeImages[]
@@ -0,0 +1,33 @@
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SDL_Surface;
+
+// tag::decodedImage[]
+//an image decoded to RGBA8, top row first - texels are packed as SDL_PIXELFORMAT_ABGR8888, so in memory
+//they are GL_RGBA / GL_UNSIGNED_BYTE, and they are already in the software rasterizer's SoftwareTexture format
+struct DecodedImage
+{
+	std::string filePath; //empty if no file was found
+	int width;
+	int height;
+	std::vector<uint32_t> texels;
+};
+
+//the first of name.png, name.jpg or name.bmp that exists - empty if there are none
+std::string findImage(const std::string &name);
+
+//find and decode each of names into the same slot of images, on a pool of threads (one per core, but
+//no more than there are images). Returns false if any failed, with the reason on cerr.
+//No GL calls - the upload stays on the GL thread
+bool decodeImages(const std::vector<std::string> &names, std::vector<DecodedImage> &images);
+
+//the last step of decoding: swizzle a loaded surface, of any format, into image's texels - the surface is left alone
+bool convertDecodedSurface(DecodedImage &image, SDL_Surface *surface);
+// end::decodedImage[]
+
+#endif
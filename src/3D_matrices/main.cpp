@@ -15,15 +15,41 @@
 #include <algorithm>
 #include <string>
 #include <cassert>
+#include <atomic>
+#include <cmath>
+#include <cstring>
 
 
 #include <GL/glew.h>
 #include <SDL.h>
+#include <SDL_ttf.h>
 
 #define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "shaderVariants.h"
+#include "renderQueue.h"
+#include "frustumCulling.h"
+#include "renderSnapshot.h"
+#include "tripleBuffer.h"
+#include "spscQueue.h"
+#include "headless.h"
+#include "softwareRasterizer.h"
+#include "videoCapture.h"
+#include "textRenderer.h"
+#include "meshCache.h"
+#include "imageLoader.h"
+#include "dynamicResolution.h"
+#include "framePacing.h"
+#include "clusteredLighting.h"
+#include "shadowMap.h"
+#include "renderGraph.h"
+#include "transform.h"
+#include "vertexPacking.h"
+#include "batchTransforms.h"
 // end::includes[]
 
 // tag::using[]
@@ -65,7 +91,7 @@ std::string loadShader(const string filePath) {
 // end::loadShader[]
 
 //our variables
-bool done = false;
+std::atomic<bool> done(false); //set by the input (main) thread, read by the sim and render threads
 
 // tag::vertexData[]
 //the data about our geometry
@@ -379,198 +405,111 @@ GLfloat cubeVertexData[]{
 	-0.1f,  0.1f, -0.1f
 };
 
+//a unit cube, so it packs as normalized positions - skyBoxTransform scales it out to skyboxSize
 GLfloat skyboxVertexData[]{
-	-10.0f, -10.0f, -10.0,		
-	10.0f, -10.0f, -10.0f,
-	10.0f,  10.0f, -10.0f,
-	10.0f,  10.0f, -10.0f,
-	-10.0f,  10.0f, -10.0f,
-	-10.0f, -10.0f, -10.0f,
-
-	-10.0f, -10.0f,  10.0f,
-	10.0f, -10.0f,  10.0f,
-	10.0f,  10.0f,  10.0f,
-	10.0f,  10.0f,  10.0f,
-	-10.0f,  10.0f,  10.0f,
-	-10.0f, -10.0f,  10.0f,
-
-	-10.0f,  10.0f,  10.0f,
-	-10.0f,  10.0f, -10.0f,
-	-10.0f, -10.0f, -10.0f,
-	-10.0f, -10.0f, -10.0f,
-	-10.0f, -10.0f,  10.0f,
-	-10.0f,  10.0f,  10.0f,
-
-	10.0f,  10.0f,  10.0f,
-	10.0f,  10.0f, -10.0f,
-	10.0f, -10.0f, -10.0f,
-	10.0f, -10.0f, -10.0f,
-	10.0f, -10.0f,  10.0f,
-	10.0f,  10.0f, 10.0f,
-
-	-10.0f, -10.0f, -10.0f,
-	10.0f, -10.0f, -10.0f,
-	10.0f, -10.0f,  10.0f,
-	10.0f, -10.0f,  10.0f,
-	-10.0f, -10.0f,  10.0f,
-	-10.0f, -10.0f, -10.0f,
-
-	-10.0f,  10.0f, -10.0f,
-	10.0f,  10.0f, -10.0f,
-	10.0f,  10.0f,  10.0f,
-	10.0f,  10.0f,  10.0f,
-	-10.0f,  10.0f,  10.0f,
-	-10.0f,  10.0f, -10.0f
-};
+	-1.0f, -1.0f, -1.0f,
+	1.0f, -1.0f, -1.0f,
+	1.0f,  1.0f, -1.0f,
+	1.0f,  1.0f, -1.0f,
+	-1.0f,  1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f,
 
-GLfloat cubeColorData[]{
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
-	1.0f,  1.0f,  1.0f,
+	-1.0f, -1.0f,  1.0f,
+	1.0f, -1.0f,  1.0f,
 	1.0f,  1.0f,  1.0f,
 	1.0f,  1.0f,  1.0f,
+	-1.0f,  1.0f,  1.0f,
+	-1.0f, -1.0f,  1.0f,
+
+	-1.0f,  1.0f,  1.0f,
+	-1.0f,  1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f,
+	-1.0f, -1.0f,  1.0f,
+	-1.0f,  1.0f,  1.0f,
+
 	1.0f,  1.0f,  1.0f,
+	1.0f,  1.0f, -1.0f,
+	1.0f, -1.0f, -1.0f,
+	1.0f, -1.0f, -1.0f,
+	1.0f, -1.0f,  1.0f,
+	1.0f,  1.0f, 1.0f,
+
+	-1.0f, -1.0f, -1.0f,
+	1.0f, -1.0f, -1.0f,
+	1.0f, -1.0f,  1.0f,
+	1.0f, -1.0f,  1.0f,
+	-1.0f, -1.0f,  1.0f,
+	-1.0f, -1.0f, -1.0f,
+
+	-1.0f,  1.0f, -1.0f,
+	1.0f,  1.0f, -1.0f,
 	1.0f,  1.0f,  1.0f,
 	1.0f,  1.0f,  1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-		1.0f, 1.0f, 1.0f,
-	1.0f,  1.0f,  1.0f
+	-1.0f,  1.0f,  1.0f,
+	-1.0f,  1.0f, -1.0f
+};
 
+//every built-in mesh has the same vertexColor - so it's the attribute's current value (glVertexAttrib3fv,
+//with the array disabled) rather than an array of copies. Imported models read the default colour too
+const GLfloat defaultVertexColor[] = { 1.0f, 1.0f, 1.0f };
+
+//the built-in meshes are boxes, six vertices (two triangles) to a face - one outward normal per face, in the
+//order the vertex data above lists them. The triangles aren't wound consistently, so they're given rather than worked out
+const GLfloat boxFaceNormals[]{ //the paddles and the cube (ball)
+	 0.0f,  0.0f, -1.0f,
+	 0.0f,  0.0f,  1.0f,
+	-1.0f,  0.0f,  0.0f,
+	 1.0f,  0.0f,  0.0f,
+	 0.0f, -1.0f,  0.0f,
+	 0.0f,  1.0f,  0.0f,
 };
 
+const GLfloat boundsFaceNormals[]{ //four walls, a box each - not all with their faces in the same order
+	//left
+	 0.0f,  0.0f, -1.0f,
+	 0.0f,  0.0f,  1.0f,
+	-1.0f,  0.0f,  0.0f,
+	 1.0f,  0.0f,  0.0f,
+	 0.0f, -1.0f,  0.0f,
+	 0.0f,  1.0f,  0.0f,
+	//right
+	 0.0f,  0.0f, -1.0f,
+	 0.0f,  0.0f,  1.0f,
+	 1.0f,  0.0f,  0.0f,
+	-1.0f,  0.0f,  0.0f,
+	 0.0f, -1.0f,  0.0f,
+	 0.0f,  1.0f,  0.0f,
+	//top
+	 0.0f,  0.0f, -1.0f,
+	 0.0f,  0.0f,  1.0f,
+	 1.0f,  0.0f,  0.0f,
+	-1.0f,  0.0f,  0.0f,
+	 0.0f, -1.0f,  0.0f,
+	 0.0f,  1.0f,  0.0f,
+	//bottom
+	 0.0f,  0.0f, -1.0f,
+	 0.0f,  0.0f,  1.0f,
+	 1.0f,  0.0f,  0.0f,
+	-1.0f,  0.0f,  0.0f,
+	 0.0f,  1.0f,  0.0f,
+	 0.0f, -1.0f,  0.0f,
+};
+
+//each face's normal repeated for its six vertices - the layout the VAOs and the software renderer read
+std::vector<GLfloat> vertexNormalsOf(const GLfloat *faceNormals, size_t faceCount)
+{
+	std::vector<GLfloat> normals;
+	normals.reserve(faceCount * 6 * 3);
+	for (size_t face = 0; face < faceCount; face++)
+		for (int vertex = 0; vertex < 6; vertex++)
+			normals.insert(normals.end(), faceNormals + face * 3, faceNormals + face * 3 + 3);
+	return normals;
+}
+
+const std::vector<GLfloat> boxVertexNormals = vertexNormalsOf(boxFaceNormals, sizeof(boxFaceNormals) / (3 * sizeof(GLfloat)));
+const std::vector<GLfloat> boundsVertexNormals = vertexNormalsOf(boundsFaceNormals, sizeof(boundsFaceNormals) / (3 * sizeof(GLfloat)));
+
 GLfloat cubeTextureData[]{
 	0.75f, 0.666f,
 	0.99f, 0.666f,
@@ -615,27 +554,6 @@ GLfloat cubeTextureData[]{
 	0.25f, 0.000f,
 };
 
-GLfloat rightUIvertexData[]{
-	0.9f, 0.7f,		1.0f, 0.0f,
-	0.7f, 0.9f,		0.0f, 1.0f,
-	0.9f, 0.9f,		1.0f, 1.0f,
-
-	0.7f, 0.9f,		0.0f, 1.0f,
-	0.9f, 0.7f,		1.0f, 0.0f,
-	0.7f, 0.7f,		0.0f, 0.0f
-
-};
-GLfloat leftUIvertexData[]{
-	-0.9f, 0.7f,	1.0f, 0.0f,
-	-0.7f, 0.9f,	0.0f, 1.0f,
-	-0.9f, 0.9f,	1.0f, 1.0f,
-
-	-0.7f, 0.9f,	0.0f, 1.0f,
-	-0.9f, 0.7f,	1.0f, 0.0f,
-	-0.7f, 0.7f,	0.0f, 0.0f
-
-};
-
 // end::vertexData[]
 
 // tag::gameState[]
@@ -653,13 +571,8 @@ GLfloat radius = 10.0f;
 GLfloat camX = 0.0f;
 GLfloat camZ = 0.0f;
 
-glm::mat4 view;
-glm::mat4 view1;
-glm::mat4 view2;
-glm::mat4 view3;
-glm::mat4 view4;
-
 glm::vec3 skyBoxPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+const float skyboxSize = 10.0f; //half the width of the skybox cube
 
 GLfloat cameraSpeed = 0.05f;
 glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, -2.0f);
@@ -673,36 +586,62 @@ glm::vec3 lightPosition(0.0f, 1.0f, -1.0f);
 float lightMove = 0.01f;
 float lightColor[] = { 0.8f, 0.8f, 0.4f };
 
-
-glm::mat4 rotateMatrix; // the transformation matrix for our object - which is the identity matrix by default
+//point lights, on top of the main light - the ball glows, paddles flash when they return it, and every
+//bounce throws off a few sparks. --lights N adds N more circling the arena, to load the clustered path
+struct Spark
+{
+	glm::vec3 position;
+	glm::vec3 velocity;
+	glm::vec3 color;
+	float life; //1 when spawned, gone at 0
+};
+const int maxSparks = 128;
+Spark sparks[maxSparks];
+int sparkCount = 0;
+uint32_t sparkRandom = 12345; //a fixed seed, so headless runs stay reproducible
+float padLflash = 0.0f; //1 on a hit, fading to 0
+float padRflash = 0.0f;
+int orbitLightCount = 0; //--lights
+
+
+//the orientations of the ball and paddles, structure-of-arrays, so the batched kernels step them all at once
+//only the ball spins - the paddles' step is the identity. The arrays are padded to the SSE width; the spare lane stays put
+enum Orientation { BALL_ORIENTATION, LEFT_PADDLE_ORIENTATION, RIGHT_PADDLE_ORIENTATION, ORIENTATION_LANES = 4 };
+float orientationX[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float orientationY[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float orientationZ[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float orientationW[ORIENTATION_LANES] = { 1.0f, 1.0f, 1.0f, 1.0f };
+float spinStepX[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float spinStepY[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float spinStepZ[ORIENTATION_LANES] = { 0.0f, 0.0f, 0.0f, 0.0f };
+float spinStepW[ORIENTATION_LANES] = { 1.0f, 1.0f, 1.0f, 1.0f };
+const OrientationArrays orientations = { orientationX, orientationY, orientationZ, orientationW };
+const OrientationArrays spinSteps = { spinStepX, spinStepY, spinStepZ, spinStepW };
+const uint64_t orientationRenormalizeTicks = 60; //how often the orientations are put back to unit length, as rounding drifts them
 float rotateSpeed = 1.0f; //rate of change of the rotate - in radians per second
 
-glm::mat4 padLmatrix;
-glm::mat4 padRmatrix;
-glm::mat4 ballMatrix;
-glm::mat4 lightMatrix;
-glm::mat4 skyBoxmatrix;
+//world matrices - cached, and only rebuilt on the ticks their positions change
+//(the arena's, ball's and paddles' are built afresh each frame, all at once - see WorldTransforms)
+Transform lightTransform = makeTransform(lightPosition);
+Transform skyBoxTransform = makeTransform(skyBoxPosition);
 glm::mat4 skyBoxRotatematrix;
 
 // tag::GLVariables[]
 //our GL and GLSL variables
 //programIDs
-GLuint theProgram; //GLuint that we'll fill in to refer to the GLSL program (only have 1 at this point)
-
-//attribute locations
-GLint positionLocation; //GLuint that we'll fill in with the location of the `position` attribute in the GLSL
-GLint vertexColorLocation; //GLuint that we'll fill in with the location of the `vertexColor` attribute in the GLSL
-GLint textureLocation;
-
-//uniform location
-GLint modelMatrixLocation;
-GLint viewMatrixLocation;
-GLint projectionMatrixLocation;
-GLint rotateMatrixLocation;
-GLint lightPositionLocation;
-GLint lightColorLocation;
-GLint cameraPositionLocation;
-GLint textureBool;
+ShaderVariant shaderVariants[shaderVariantCount]; //indexed by ShaderFeature bits
+bool multiviewSupported = false; //the MULTIVIEW variants need GL_ARB_viewport_array - without it they aren't built
+
+RenderQueue renderQueue; //draws are submitted here, sorted by state, then issued
+StreamBuffer instanceStreamBuffer; //per-frame instance matrices for the render queue's instanced batches
+const GLsizeiptr instanceStreamSegmentSize = 4096 * sizeof(glm::mat4); //instances per frame
+
+//local-space bounds, worked out from the vertex data at load time
+BoundingSphere LeftPaddleBoundingSphere;
+BoundingSphere RightPaddleBoundingSphere;
+BoundingSphere boundsBoundingSphere;
+BoundingSphere cubeBoundingSphere;
+int culledObjectCount = 0;
 
 GLuint LeftPaddleVertexDataBufferObject;
 GLuint LeftPaddleVertexArrayObject;
@@ -721,12 +660,6 @@ GLuint cubeVertexArrayObject;
 //light uses cube data cos lazyness
 GLuint lightVertexArrayObject;
 
-GLuint rightUIVertexDataBufferObject;
-GLuint rightUIVertexArrayObject;
-
-GLuint leftUIVertexDataBufferObject;
-GLuint leftUIVertexArrayObject;
-
 GLuint BallVertexDataBufferObject;
 GLuint BallVertexArrayObject;
 GLuint ballTexture;
@@ -735,26 +668,69 @@ GLuint skyboxTex;
 GLuint skyboxVertexDataBufferObject;
 GLuint skyboxVertexArrayObject;
 
-GLuint ColorDataBufferObject;
-GLuint ColorArrayObject;
-
 GLuint TextureDataBufferObject;
 GLuint TextureArrayObject;
 
-GLuint Rscore0Texture;
-GLuint Rscore1Texture;
-GLuint Rscore2Texture;
-GLuint RloserTexture;
-GLuint RwinnerTexture;
+GLuint boxNormalBufferObject; //the paddles and the cube share one - their faces are in the same order
+GLuint boundsNormalBufferObject;
+
+size_t packedVertexBytes = 0; //the built-in meshes' positions, normals and texture coordinates on the GPU, and the same data as GLfloat arrays
+size_t unpackedVertexBytes = 0;
 
-GLuint Lscore0Texture;
-GLuint Lscore1Texture;
-GLuint Lscore2Texture;
-GLuint LloserTexture;
-GLuint LwinnerTexture;
+TextRenderer textRenderer; //the HUD - scores and stats
+
+//the scene is rendered at a resolution that adapts to hold the frame budget, then upscaled - see --frame-budget
+float frameBudgetMs = 12.0f; //0 renders straight into the window at full resolution
+bool dynamicResolutionEnabled = false;
+DynamicResolution dynamicResolution;
+
+RenderGraph renderGraph; //rebuilt each frame - owns the offscreen targets, pooled and aliased across passes
+
+LightClusters lightClusters; //which point lights each cluster of the view frustum has to shade
+ShadowMap shadowMap; //the main light's - the arena's depth is cached, the ball and paddles are added each frame
 
 // end::GLVariables[]
 
+// tag::softwareVariables[]
+//the same scene for the CPU renderer (--software) - meshes point at the vertex data above
+bool softwareRendering = false;
+SoftwareRasterizer softwareRasterizer;
+
+SoftwareMesh LeftPaddleMesh;
+SoftwareMesh RightPaddleMesh;
+SoftwareMesh boundsMesh;
+SoftwareMesh cubeMesh;
+SoftwareMesh skyboxMesh;
+
+SoftwareTexture LeftPaddleImage;
+SoftwareTexture RightPaddleImage;
+SoftwareTexture boundsImage;
+SoftwareTexture ballImage;
+SoftwareTexture skyboxImage;
+// end::softwareVariables[]
+
+// tag::modelVariables[]
+//models/<name>.obj (or .fbx, .gltf, .glb) replace the built-in meshes when they exist - see loadModels
+ModelMesh boundsModel;
+ModelMesh ballModel;
+ModelMesh LeftPaddleModel;
+ModelMesh RightPaddleModel;
+// end::modelVariables[]
+
+// tag::hudVariables[]
+//HUD text - one glyph atlas, shared by the GL and software renderers
+const std::string hudFontPath = "SourceCodePro-Regular.ttf";
+const int scoreFont = 0; //index into glyphAtlas.fonts
+const int statsFont = 1;
+GlyphAtlas glyphAtlas;
+TextBatch hudText; //rebuilt by the render thread every frame
+
+bool showStats = false; //F3
+bool spectatorLayout = false; //F5 (or --spectator) - all five camera views at once
+double frameTimeMs = 0.0; //smoothed, for the stats line
+Uint64 lastFrameCounter = 0;
+// end::hudVariables[]
+
 bool go = false;
 bool gameOver = false;
 
@@ -763,8 +739,15 @@ bool rpDown = false;
 bool lpUp = false;
 bool lpDown = false;
 
+//how much of the current tick each paddle key has been held for - so a tap shorter than a tick still moves
+float rpUpHeld = 0.0f;
+float rpDownHeld = 0.0f;
+float lpUpHeld = 0.0f;
+float lpDownHeld = 0.0f;
+
 int RPscore = 0;
 int LPscore = 0;
+const int winningScore = 3;
 
 bool cameraForward = false;
 bool cameraBackward = false;
@@ -778,6 +761,54 @@ float lasty;
 
 int cameraStyle = 0;
 
+//sim -> render hand-over
+TripleBuffer<RenderSnapshot> renderSnapshots;
+uint64_t simulationTick = 0;
+const double simTickLength = 1.0 / 60.0; //seconds of wall-clock time per updateSimulation call
+SDL_Thread *renderThread = nullptr;
+SDL_Thread *simulationThread = nullptr;
+
+//--capture: gameplay video, one frame per simulation tick
+std::string capturePath;
+bool capturing = false;
+VideoCapture videoCapture;
+
+//frame pacing - the present mode can be changed while running (F4), so the sim thread asks and the render thread applies it
+std::atomic<int> requestedPresentMode(PRESENT_VSYNC);
+PresentMode presentMode = PRESENT_VSYNC; //render thread - what is actually in use
+double frameLimit = 0.0; //frames per second, 0 for no limit - see --fps-limit
+int maxFramesInFlight = 2;
+FrameLimiter frameLimiter;
+FramesInFlight framesInFlight;
+InputLatency softwareLatency; //the software renderer has no fences - it is measured at the blit
+//input - key transitions, timestamped on the main thread and applied by the sim thread
+struct InputEvent
+{
+	Uint64 counter; //when it happened, on SDL_GetPerformanceCounter
+	SDL_Keycode key;
+	bool pressed;
+};
+SpscQueue<InputEvent, 256> inputEvents;
+uint64_t inputSerial = 0; //sim thread
+uint64_t inputCounter = 0;
+uint64_t shownInputSerial = 0; //render thread - the newest input already on screen
+
+//the window can be resized - this is its drawable size, tracked by the sim thread and passed on in the snapshots
+std::atomic<int> drawableWidth(600);
+std::atomic<int> drawableHeight(600);
+
+//--on-demand: only draw frames that differ from the one on screen - paused and game over screens settle, and then
+//all three threads sleep until there is input
+bool renderOnDemand = false;
+const Uint32 idleWakeMs = 250; //how long an idle thread sleeps before looking again anyway
+SDL_sem *simulationWake = nullptr; //posted by the input thread when there is something for the sim to apply
+SDL_sem *renderWake = nullptr; //posted when a snapshot is published, or the window needs a redraw
+std::atomic<bool> simulationIdle(false); //the last tick changed nothing, and the sim is waiting for input
+std::atomic<bool> redrawRequested(false); //the window's contents were lost (e.g. uncovered) - draw the last snapshot again
+RenderSnapshot publishedSnapshot; //sim thread - the last snapshot handed over, to compare the next with
+bool snapshotPublished = false;
+double animationTime = 0.0; //seconds the ambient animation has run for - it holds still out of play with --on-demand
+
 // end Global Variables
 /////////////////////////
 
@@ -802,8 +833,12 @@ void createWindow()
 	std::string exeNameEnd = exeName.substr(beginIdx + 1);
 	const char *exeNameCStr = exeNameEnd.c_str();
 
-	//create window
-	win = SDL_CreateWindow(exeNameCStr, 100, 100, 600, 600, SDL_WINDOW_OPENGL); //same height and width makes the window square ...
+	//create window - resizable, and at the display's full resolution on high-DPI screens
+	//but while recording, fixed at 600x600 pixels, since that is the size the video was started at
+	Uint32 flags = capturePath.empty() ? (SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI) : 0;
+	if (!softwareRendering)
+		flags |= SDL_WINDOW_OPENGL;
+	win = SDL_CreateWindow(exeNameCStr, 100, 100, 600, 600, flags);
 
 	//error handling
 	if (win == nullptr)
@@ -814,6 +849,21 @@ void createWindow()
 	}
 	cout << "SDL CreatedWindow OK!\n";
 }
+
+//in pixels - call whenever the window changes size
+void updateDrawableSize()
+{
+	int width, height;
+	if (softwareRendering)
+		SDL_GetWindowSize(win, &width, &height);
+	else
+		SDL_GL_GetDrawableSize(win, &width, &height);
+	if (width > 0 && height > 0) //0 while minimized - keep the last real size
+	{
+		drawableWidth = width;
+		drawableHeight = height;
+	}
+}
 // end::createWindow[]
 
 // tag::setGLAttributes[]
@@ -852,6 +902,15 @@ void initGlew()
 	GLenum rev;
 	glewExperimental = GL_TRUE; //GLEW isn't perfect - see https://www.opengl.org/wiki/OpenGL_Loading_Library#GLEW
 	rev = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	//a GLX build of GLEW 2.x loads GLX's entry points after GL's, and fails there with no X display - as under
+	//the EGL surfaceless context of --headless. GL itself is fine as long as its entry points resolved
+	if (rev == GLEW_ERROR_NO_GLX_DISPLAY && glCreateProgram && glGenVertexArrays && glBindFramebuffer && glBlitFramebuffer)
+	{
+		cout << "GLEW: no GLX display, using the GL entry points it did load" << std::endl;
+		rev = GLEW_OK;
+	}
+#endif
 	if (GLEW_OK != rev){
 		std::cerr << "GLEW Error: " << glewGetErrorString(rev) << std::endl;
 		SDL_Quit();
@@ -907,6 +966,13 @@ GLuint createProgram(const std::vector<GLuint> &shaderList)
 	for (size_t iLoop = 0; iLoop < shaderList.size(); iLoop++)
 		glAttachShader(program, shaderList[iLoop]);
 
+	//fix attribute locations, so VAOs work with any program variant
+	glBindAttribLocation(program, positionLocation, "position");
+	glBindAttribLocation(program, vertexColorLocation, "vertexColor");
+	glBindAttribLocation(program, textureLocation, "texture");
+	glBindAttribLocation(program, instanceMatrixLocation, "instanceMatrix");
+	glBindAttribLocation(program, normalLocation, "normal");
+
 	glLinkProgram(program);
 
 	GLint status;
@@ -932,51 +998,94 @@ GLuint createProgram(const std::vector<GLuint> &shaderList)
 // tag::initializeProgram[]
 void initializeProgram()
 {
-	std::vector<GLuint> shaderList;
+	std::string vertexSource = loadShader("vertexShader.glsl");
+	std::string fragmentSource = loadShader("fragmentShader.glsl");
+	std::string geometrySource = loadShader("geometryShader.glsl");
 
-	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader("vertexShader.glsl")));
-	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader("fragmentShader.glsl")));
+	multiviewSupported = GLEW_ARB_viewport_array != 0;
+	if (!multiviewSupported)
+		cout << "GL_ARB_viewport_array is not supported - the spectator layout (F5) is unavailable" << std::endl;
 
-	theProgram = createProgram(shaderList);
-	if (theProgram == 0)
+	//build every permutation up front, so draws never wait on a compile
+	for (unsigned features = 0; features < shaderVariantCount; features++)
 	{
-		cerr << "GLSL program creation error." << std::endl;
-		SDL_Quit();
-		exit(1);
+		if ((features & SHADER_MULTIVIEW) && !multiviewSupported)
+		{
+			shaderVariants[features].program = 0;
+			continue;
+		}
+		std::vector<GLuint> shaderList;
+
+		shaderList.push_back(createShader(GL_VERTEX_SHADER, applyShaderFeatures(vertexSource, features)));
+		if (features & SHADER_MULTIVIEW)
+			shaderList.push_back(createShader(GL_GEOMETRY_SHADER, applyShaderFeatures(geometrySource, features)));
+		shaderList.push_back(createShader(GL_FRAGMENT_SHADER, applyShaderFeatures(fragmentSource, features)));
+
+		GLuint program = createProgram(shaderList);
+		if (program == 0)
+		{
+			cerr << "GLSL program creation error." << std::endl;
+			SDL_Quit();
+			exit(1);
+		}
+		else {
+			cout << "GLSL program variant " << features << " creation OK! GLUint is: " << program << std::endl;
+		}
+
+		ShaderVariant &variant = shaderVariants[features];
+		variant.program = program;
+
+		// tag::glGetUniformLocation[]
+		//enumerate what the linker kept, then resolve the parameter structs against it once
+		variant.reflection = reflectProgram(program);
+		std::vector<std::string> missing;
+		variant.frameLayout = bindParameters(variant.reflection, frameParameterFields, frameParameterFieldCount, missing);
+		variant.objectLayout = bindParameters(variant.reflection, objectParameterFields, objectParameterFieldCount, missing);
+
+		//the attribute locations were bound before linking - check the linker agreed
+		for (auto &attribute : variant.reflection.attributes)
+		{
+			GLint expected = -1;
+			if (attribute.first == "position") expected = positionLocation;
+			if (attribute.first == "vertexColor") expected = vertexColorLocation;
+			if (attribute.first == "texture") expected = textureLocation;
+			if (attribute.first == "instanceMatrix") expected = instanceMatrixLocation;
+			if (attribute.first == "normal") expected = normalLocation;
+			if (attribute.second.location != expected)
+			{
+				cerr << "GLSL attribute " << attribute.first << " is at location " << attribute.second.location
+				     << ", expected " << expected << std::endl;
+				SDL_Quit();
+				exit(1);
+			}
+		}
+
+		//uniforms compiled out of this variant are fine, anything else missing is a broken shader
+		bool failed = false;
+		for (size_t i = 0; i < missing.size(); i++)
+		{
+			if (shaderVariantUses(missing[i], features))
+			{
+				cerr << "GLSL program variant " << features << " is missing uniform " << missing[i] << std::endl;
+				failed = true;
+			}
+		}
+		if (failed)
+		{
+			SDL_Quit();
+			exit(1);
+		}
+		// end::glGetUniformLocation[]
+
+		//clean up shaders (we don't need them anymore as they are no in the program
+		for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
 	}
-	else {
-		cout << "GLSL program creation OK! GLUint is: " << theProgram << std::endl;
-	}
-
-	// tag::glGetAttribLocation[]
-	positionLocation = glGetAttribLocation(theProgram, "position");
-	vertexColorLocation = glGetAttribLocation(theProgram, "vertexColor");
-	textureLocation = glGetAttribLocation(theProgram, "texture");
-	// end::glGetAttribLocation[]
-
-	// tag::glGetUniformLocation[]
-	modelMatrixLocation = glGetUniformLocation(theProgram, "modelMatrix");
-	viewMatrixLocation = glGetUniformLocation(theProgram, "viewMatrix");
-	projectionMatrixLocation = glGetUniformLocation(theProgram, "projectionMatrix");
-	rotateMatrixLocation = glGetUniformLocation(theProgram, "rotateMatrix");
-	lightColorLocation = glGetUniformLocation(theProgram, "lightColor");
-	lightPositionLocation = glGetUniformLocation(theProgram, "lightPosition");
-	cameraPositionLocation = glGetUniformLocation(theProgram, "cameraPosition");
-	textureBool = glGetUniformLocation(theProgram, "texBool");
-
-	//only generates runtime code in debug mode
-	assert( modelMatrixLocation != -1);
-	assert( viewMatrixLocation != -1);
-	assert( projectionMatrixLocation != -1);
-	// end::glGetUniformLocation[]
-
-	//clean up shaders (we don't need them anymore as they are no in theProgram
-	for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
 }
 // end::initializeProgram[]
 
 // tag::initializeVertexArrayObject[]
 //setup a GL object (a VertexArrayObject) that stores how to access data and from where
+//vertexColor is left disabled in all of them - it reads defaultVertexColor. The skybox and the light are unlit, so have no normals
 void initializeVertexArrayObject()
 {
 
@@ -986,7 +1095,7 @@ void initializeVertexArrayObject()
 	glBindVertexArray(lightVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, cubeVertexDataBufferObject); //bind vertexDataBufferObjec
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0);
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 	//bounds
 	glGenVertexArrays(1, &boundsVertexArrayObject); //create a Vertex Array Object
@@ -994,10 +1103,10 @@ void initializeVertexArrayObject()
 	glBindVertexArray(boundsVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, boundsVertexDataBufferObject); //bind vertexDataBufferObject
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0); //specify that position data is packed (see vertexPacking.h), and goes into attribute index positionLocation
+	glBindBuffer(GL_ARRAY_BUFFER, boundsNormalBufferObject);
+	glEnableVertexAttribArray(normalLocation);
+	packedNormalPointer(normalLocation, 0, 0); //10:10:10:2, like the positions - see vertexPacking.h
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 
 	//cuuuube
@@ -1006,40 +1115,13 @@ void initializeVertexArrayObject()
 	glBindVertexArray(cubeVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, cubeVertexDataBufferObject); //bind vertexDataBufferObjec
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, boxNormalBufferObject);
+	glEnableVertexAttribArray(normalLocation);
+	packedNormalPointer(normalLocation, 0, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, TextureDataBufferObject);
 	glEnableVertexAttribArray(textureLocation);
-	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-	//ui
-	glGenVertexArrays(1, &rightUIVertexArrayObject); //create a Vertex Array Object
-	cout << "Vertex Array Object created OK! GLUint is: " << boundsVertexArrayObject << std::endl;
-	glBindVertexArray(rightUIVertexArrayObject); //make the just created vertexArrayObject the active one
-	glBindBuffer(GL_ARRAY_BUFFER, rightUIVertexDataBufferObject); //bind vertexDataBufferObjec
-	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, (4 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-	glEnableVertexAttribArray(textureLocation);
-	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, (4 * sizeof(GL_FLOAT)), (GLvoid *)(2 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
-
-	glGenVertexArrays(1, &leftUIVertexArrayObject); //create a Vertex Array Object
-	cout << "Vertex Array Object created OK! GLUint is: " << boundsVertexArrayObject << std::endl;
-	glBindVertexArray(leftUIVertexArrayObject); //make the just created vertexArrayObject the active one
-	glBindBuffer(GL_ARRAY_BUFFER, leftUIVertexDataBufferObject); //bind vertexDataBufferObjec
-	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, (4 * sizeof(GL_FLOAT)), (GLvoid *)(0 * sizeof(GLfloat))); //specify that position data contains four floats per vertex, and goes into attribute index positionLocation
-	glEnableVertexAttribArray(textureLocation);
-	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, (4 * sizeof(GL_FLOAT)), (GLvoid *)(2 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	packedTextureCoordinatePointer(textureLocation, 0, 0);
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 
 	glGenVertexArrays(1, &skyboxVertexArrayObject); //create a Vertex Array Object
@@ -1047,13 +1129,10 @@ void initializeVertexArrayObject()
 	glBindVertexArray(skyboxVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, skyboxVertexDataBufferObject); //bind vertexDataBufferObject
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, TextureDataBufferObject);
 	glEnableVertexAttribArray(textureLocation);
-	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedTextureCoordinatePointer(textureLocation, 0, 0);
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 
 						  //Left Paddle
@@ -1062,13 +1141,13 @@ void initializeVertexArrayObject()
 	glBindVertexArray(LeftPaddleVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, LeftPaddleVertexDataBufferObject); //bind vertexDataBufferObject
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, boxNormalBufferObject);
+	glEnableVertexAttribArray(normalLocation);
+	packedNormalPointer(normalLocation, 0, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, TextureDataBufferObject);
 	glEnableVertexAttribArray(textureLocation);
-	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedTextureCoordinatePointer(textureLocation, 0, 0);
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 
 						  //Right Paddle
@@ -1077,270 +1156,296 @@ void initializeVertexArrayObject()
 	glBindVertexArray(RightPaddleVertexArrayObject); //make the just created vertexArrayObject the active one
 	glBindBuffer(GL_ARRAY_BUFFER, RightPaddleVertexDataBufferObject); //bind vertexDataBufferObject
 	glEnableVertexAttribArray(positionLocation); //enable attribute at index positionLocation
-	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
-	glEnableVertexAttribArray(vertexColorLocation);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glVertexAttribPointer(vertexColorLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	packedPositionPointer(positionLocation, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, boxNormalBufferObject);
+	glEnableVertexAttribArray(normalLocation);
+	packedNormalPointer(normalLocation, 0, 0);
 	glBindVertexArray(0); //unbind the vertexArrayObject so we can't change it
 
-	glGenTextures(1, &skyboxTex);
-	glBindTexture(GL_TEXTURE_2D, skyboxTex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* skybox = SDL_LoadBMP("skybox.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, skybox->w, skybox->h, 0, GL_BGR, GL_UNSIGNED_BYTE, skybox->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(skybox);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	//cleanup
+	glDisableVertexAttribArray(positionLocation); //disable vertex attribute at index positionLocation
+	glDisableVertexAttribArray(normalLocation);
+	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbind array buffer
 
-	//left paddle texture
-	glGenTextures(1, &LeftPaddleTexture);
-	glBindTexture(GL_TEXTURE_2D, LeftPaddleTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* lpImage = SDL_LoadBMP("Lpaddle.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, lpImage->w, lpImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, lpImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(lpImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
+}
+// end::initializeVertexArrayObject[]
 
-	// bounds texture
-	glGenTextures(1, &boundsTexture);
-	glBindTexture(GL_TEXTURE_2D, boundsTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* boundsImage = SDL_LoadBMP("bounds.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, boundsImage->w, boundsImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, boundsImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(boundsImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
+// tag::loadModels[]
+//GL copies the model into buffers and lets the mapping go - the software renderer reads the mapping directly, so keeps it
+void loadModel(ModelMesh &model, const std::string &name)
+{
+	if (!loadModelMesh(model, "models/" + name))
+		return;
+	if (!softwareRendering)
+	{
+		uploadModelMesh(model);
+		unmapModelMesh(model);
+	}
+}
 
-	glGenTextures(1, &ballTexture);
-	glBindTexture(GL_TEXTURE_2D, ballTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* ballImage = SDL_LoadBMP("ball.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ballImage->w, ballImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, ballImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(ballImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
+void loadModels()
+{
+	loadModel(boundsModel, "arena");
+	loadModel(ballModel, "ball");
+	loadModel(LeftPaddleModel, "leftPaddle");
+	loadModel(RightPaddleModel, "rightPaddle");
+}
 
+void destroyModels()
+{
+	destroyModelMesh(boundsModel);
+	destroyModelMesh(ballModel);
+	destroyModelMesh(LeftPaddleModel);
+	destroyModelMesh(RightPaddleModel);
+}
+// end::loadModels[]
 
-	//right paddle texture
-	glGenTextures(1, &RightPaddleTexture);
-	glBindTexture(GL_TEXTURE_2D, RightPaddleTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* rpImage = SDL_LoadBMP("Rpaddle.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, rpImage->w, rpImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, rpImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(rpImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	//background textures
-	// right score 0
-	glGenTextures(1, &Rscore0Texture);
-	glBindTexture(GL_TEXTURE_2D, Rscore0Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Rscore0Image = SDL_LoadBMP("rs0.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Rscore0Image->w, Rscore0Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Rscore0Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Rscore0Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// right score 1
-	glGenTextures(1, &Rscore1Texture);
-	glBindTexture(GL_TEXTURE_2D, Rscore1Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Rscore1Image = SDL_LoadBMP("rs1.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Rscore1Image->w, Rscore1Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Rscore1Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Rscore1Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// right score 2
-	glGenTextures(1, &Rscore2Texture);
-	glBindTexture(GL_TEXTURE_2D, Rscore2Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Rscore2Image = SDL_LoadBMP("rs2.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Rscore2Image->w, Rscore2Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Rscore2Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Rscore2Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// right loser texture
-	glGenTextures(1, &RloserTexture);
-	glBindTexture(GL_TEXTURE_2D, RloserTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* RloserImage = SDL_LoadBMP("Rloser.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, RloserImage->w, RloserImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, RloserImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(RloserImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// right winner texture
-	glGenTextures(1, &RwinnerTexture);
-	glBindTexture(GL_TEXTURE_2D, RwinnerTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* RwinnerImage = SDL_LoadBMP("Rwinner.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, RwinnerImage->w, RwinnerImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, RwinnerImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(RwinnerImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// left score 0 texture
-	glGenTextures(1, &Lscore0Texture);
-	glBindTexture(GL_TEXTURE_2D, Lscore0Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Lscore0Image = SDL_LoadBMP("ls0.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Lscore0Image->w, Lscore0Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Lscore0Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Lscore0Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// left score 1 texture
-	glGenTextures(1, &Lscore1Texture);
-	glBindTexture(GL_TEXTURE_2D, Lscore1Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Lscore1Image = SDL_LoadBMP("ls1.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Lscore1Image->w, Lscore1Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Lscore1Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Lscore1Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	//left score 2 texture
-	glGenTextures(1, &Lscore2Texture);
-	glBindTexture(GL_TEXTURE_2D, Lscore2Texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* Lscore2Image = SDL_LoadBMP("ls2.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Lscore2Image->w, Lscore2Image->h, 0, GL_BGR, GL_UNSIGNED_BYTE, Lscore2Image->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(Lscore2Image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// left loser texture
-	glGenTextures(1, &LloserTexture);
-	glBindTexture(GL_TEXTURE_2D, LloserTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* LloserImage = SDL_LoadBMP("Lloser.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, LloserImage->w, LloserImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, LloserImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(LloserImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	// left winner texture
-	glGenTextures(1, &LwinnerTexture);
-	glBindTexture(GL_TEXTURE_2D, LwinnerTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	SDL_Surface* LwinnerImage = SDL_LoadBMP("Lwinner.bmp");
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, LwinnerImage->w, LwinnerImage->h, 0, GL_BGR, GL_UNSIGNED_BYTE, LwinnerImage->pixels);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	SDL_FreeSurface(LwinnerImage);
-	glBindTexture(GL_TEXTURE_2D, 0);
+// tag::initializeVertexBuffer[]
+//a box's given normals against its triangles - each perpendicular to both of its triangle's edges, and
+//pointing away from the box's centre. Boxes are 36 vertices, one after another
+bool verifyFaceNormals(const char *name, const GLfloat *positions, const GLfloat *normals, size_t vertexCount)
+{
+	for (size_t box = 0; box < vertexCount / 36; box++)
+	{
+		glm::vec3 centre(0.0f);
+		for (size_t vertex = box * 36; vertex < box * 36 + 36; vertex++)
+			centre += glm::make_vec3(positions + vertex * 3) / 36.0f;
+		for (size_t vertex = box * 36; vertex < box * 36 + 36; vertex += 3)
+		{
+			const glm::vec3 a = glm::make_vec3(positions + vertex * 3);
+			const glm::vec3 b = glm::make_vec3(positions + vertex * 3 + 3);
+			const glm::vec3 c = glm::make_vec3(positions + vertex * 3 + 6);
+			const glm::vec3 normal = glm::make_vec3(normals + vertex * 3);
+			if (std::abs(glm::dot(normal, b - a)) > 1e-4f || std::abs(glm::dot(normal, c - a)) > 1e-4f
+			    || glm::dot(normal, (a + b + c) / 3.0f - centre) <= 0.0f)
+			{
+				cerr << "Built-in mesh " << name << ": the normal of the triangle at vertex " << vertex << " isn't its face's outward normal." << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
 
+//pack every built-in mesh's positions without GL - the benchmarks' --verify runs this, so a mesh that
+//doesn't fit in -1..1 (or a face normal that doesn't match its face) is caught without a GL driver, not just when the game starts
+bool verifyBuiltInMeshes()
+{
+	const struct { const char *name; const GLfloat *positions; size_t bytes; } meshes[] = {
+		{ "left paddle", LeftvertexData, sizeof(LeftvertexData) },
+		{ "right paddle", RightvertexData, sizeof(RightvertexData) },
+		{ "bounds", boundsVertexData, sizeof(boundsVertexData) },
+		{ "cube", cubeVertexData, sizeof(cubeVertexData) },
+		{ "skybox", skyboxVertexData, sizeof(skyboxVertexData) },
+	};
+	std::vector<PackedPosition> packed;
+	for (size_t i = 0; i < sizeof(meshes) / sizeof(meshes[0]); i++)
+	{
+		packed.clear();
+		if (!packPositions(packed, meshes[i].positions, meshes[i].bytes / (3 * sizeof(GLfloat)), 3))
+		{
+			cerr << "Built-in mesh " << meshes[i].name << " doesn't fit in -1..1." << std::endl;
+			return false;
+		}
+	}
+	if (!verifyFaceNormals("left paddle", LeftvertexData, boxVertexNormals.data(), sizeof(LeftvertexData) / (3 * sizeof(GLfloat)))
+	    || !verifyFaceNormals("right paddle", RightvertexData, boxVertexNormals.data(), sizeof(RightvertexData) / (3 * sizeof(GLfloat)))
+	    || !verifyFaceNormals("bounds", boundsVertexData, boundsVertexNormals.data(), sizeof(boundsVertexData) / (3 * sizeof(GLfloat)))
+	    || !verifyFaceNormals("cube", cubeVertexData, boxVertexNormals.data(), sizeof(cubeVertexData) / (3 * sizeof(GLfloat))))
+		return false;
+	cout << "Built-in meshes verified OK!" << std::endl;
+	return true;
+}
 
-	//cleanup
-	glDisableVertexAttribArray(positionLocation); //disable vertex attribute at index positionLocation
-	glBindBuffer(GL_ARRAY_BUFFER, 0); //unbind array buffer
+//a buffer of a built-in mesh's positions, packed (see vertexPacking.h) - they all fit in -1..1, so not fitting is a bug
+GLuint createPositionBuffer(const GLfloat *positions, size_t bytes)
+{
+	const size_t count = bytes / (3 * sizeof(GLfloat));
+	std::vector<PackedPosition> packed;
+	if (!packPositions(packed, positions, count, 3))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedPosition), packed.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	cout << "vertexDataBufferObject created OK! GLUint is: " << buffer << std::endl;
 
+	packedVertexBytes += packed.size() * sizeof(PackedPosition);
+	unpackedVertexBytes += bytes;
+	return buffer;
 }
-// end::initializeVertexArrayObject[]
 
-// tag::initializeVertexBuffer[]
-void initializeVertexBuffer()
+//a buffer of a built-in mesh's normals, packed 10:10:10:2 (see vertexPacking.h)
+GLuint createNormalBuffer(const std::vector<GLfloat> &normals)
 {
-	//Left Paddle
-	glGenBuffers(1, &LeftPaddleVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, LeftPaddleVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(LeftvertexData), LeftvertexData, GL_STATIC_DRAW);
+	std::vector<PackedNormal> packed;
+	packNormals(packed, normals.data(), normals.size() / 3, 3);
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedNormal), packed.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << LeftPaddleVertexDataBufferObject << std::endl;
+	cout << "normalBufferObject created OK! GLUint is: " << buffer << std::endl;
 
-	//Right Paddle
-	glGenBuffers(1, &RightPaddleVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, RightPaddleVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(RightvertexData), RightvertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << RightPaddleVertexDataBufferObject << std::endl;
+	packedVertexBytes += packed.size() * sizeof(PackedNormal);
+	unpackedVertexBytes += normals.size() * sizeof(GLfloat);
+	return buffer;
+}
 
-	// Bounds
-	glGenBuffers(1, &boundsVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, boundsVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(boundsVertexData), boundsVertexData, GL_STATIC_DRAW);
+void initializeVertexBuffer()
+{
+	LeftPaddleVertexDataBufferObject = createPositionBuffer(LeftvertexData, sizeof(LeftvertexData));
+	RightPaddleVertexDataBufferObject = createPositionBuffer(RightvertexData, sizeof(RightvertexData));
+	boundsVertexDataBufferObject = createPositionBuffer(boundsVertexData, sizeof(boundsVertexData));
+	cubeVertexDataBufferObject = createPositionBuffer(cubeVertexData, sizeof(cubeVertexData));
+	skyboxVertexDataBufferObject = createPositionBuffer(skyboxVertexData, sizeof(skyboxVertexData));
+	boxNormalBufferObject = createNormalBuffer(boxVertexNormals);
+	boundsNormalBufferObject = createNormalBuffer(boundsVertexNormals);
+
+	//bounding volumes for frustum culling
+	LeftPaddleBoundingSphere = boundingSphereOf(boundingBoxOf(LeftvertexData, sizeof(LeftvertexData) / (3 * sizeof(GLfloat)), 3));
+	RightPaddleBoundingSphere = boundingSphereOf(boundingBoxOf(RightvertexData, sizeof(RightvertexData) / (3 * sizeof(GLfloat)), 3));
+	boundsBoundingSphere = boundingSphereOf(boundingBoxOf(boundsVertexData, sizeof(boundsVertexData) / (3 * sizeof(GLfloat)), 3));
+	cubeBoundingSphere = boundingSphereOf(boundingBoxOf(cubeVertexData, sizeof(cubeVertexData) / (3 * sizeof(GLfloat)), 3));
+
+	loadModels(); //any imported models that replace the meshes above
+
+	std::vector<PackedTextureCoordinate> packedTextureData;
+	packTextureCoordinates(packedTextureData, cubeTextureData, sizeof(cubeTextureData) / (2 * sizeof(GLfloat)), 2);
+	glGenBuffers(1, &TextureDataBufferObject);
+	glBindBuffer(GL_ARRAY_BUFFER, TextureDataBufferObject);
+	glBufferData(GL_ARRAY_BUFFER, packedTextureData.size() * sizeof(PackedTextureCoordinate), packedTextureData.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << boundsVertexDataBufferObject << std::endl;
+	packedVertexBytes += packedTextureData.size() * sizeof(PackedTextureCoordinate);
+	unpackedVertexBytes += sizeof(cubeTextureData);
+	cout << "Vertex data packed OK! " << packedVertexBytes << " bytes (" << unpackedVertexBytes << " as GLfloat)" << std::endl;
 
-	// cube
-	glGenBuffers(1, &cubeVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, cubeVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertexData), cubeVertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << boundsVertexDataBufferObject << std::endl;
 
-	// ui
-	glGenBuffers(1, &rightUIVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, rightUIVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(rightUIvertexData), rightUIvertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << boundsVertexDataBufferObject << std::endl;
+	//dynamic per-frame data
+	if (createStreamBuffer(instanceStreamBuffer, GL_ARRAY_BUFFER, instanceStreamSegmentSize))
+		renderQueue.instanceStream = &instanceStreamBuffer;
 
-	glGenBuffers(1, &leftUIVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, leftUIVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(leftUIvertexData), leftUIvertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << boundsVertexDataBufferObject << std::endl;
+	initializeVertexArrayObject();
+}
+// end::initializeVertexBuffer[]
 
-	//skybox
-	glGenBuffers(1, &skyboxVertexDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVertexDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertexData), skyboxVertexData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	cout << "vertexDataBufferObject created OK! GLUint is: " << skyboxVertexDataBufferObject << std::endl;
+// tag::loadHudFont[]
+//rasterize the HUD font once, at every size the HUD uses - no GL, so the software renderer shares it
+void loadHudFont()
+{
+	if (TTF_Init() != 0)
+	{
+		cerr << "TTF_Init Error: " << TTF_GetError() << std::endl;
+		SDL_Quit();
+		exit(1);
+	}
+	std::vector<int> pixelSizes(2);
+	pixelSizes[scoreFont] = 48;
+	pixelSizes[statsFont] = 16;
+	if (!createGlyphAtlas(glyphAtlas, hudFontPath, pixelSizes))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+}
 
-	glGenBuffers(1, &ColorDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, ColorDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeColorData), cubeColorData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+void initializeTextRenderer()
+{
+	std::vector<GLuint> shaderList;
+	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader("textVertexShader.glsl")));
+	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader("textFragmentShader.glsl")));
+	GLuint program = createProgram(shaderList);
+	for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
 
-	glGenBuffers(1, &TextureDataBufferObject);
-	glBindBuffer(GL_ARRAY_BUFFER, TextureDataBufferObject);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeTextureData), cubeTextureData, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (!createTextRenderer(textRenderer, glyphAtlas, program))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+}
+// end::loadHudFont[]
 
+// tag::initializeShadowMap[]
+void initializeShadowMap()
+{
+	std::vector<GLuint> shaderList;
+	shaderList.push_back(createShader(GL_VERTEX_SHADER, loadShader("shadowVertexShader.glsl")));
+	shaderList.push_back(createShader(GL_FRAGMENT_SHADER, loadShader("shadowFragmentShader.glsl")));
+	GLuint program = createProgram(shaderList);
+	for_each(shaderList.begin(), shaderList.end(), glDeleteShader);
 
-	initializeVertexArrayObject();
+	if (!createShadowMap(shadowMap, program))
+	{
+		SDL_Quit();
+		exit(1);
+	}
 }
-// end::initializeVertexBuffer[]
+// end::initializeShadowMap[]
+
+// tag::loadTextures[]
+enum TextureImage { SKYBOX_IMAGE, LEFT_PADDLE_IMAGE, RIGHT_PADDLE_IMAGE, BOUNDS_IMAGE, BALL_IMAGE, TEXTURE_IMAGE_COUNT };
+const char *textureImageNames[TEXTURE_IMAGE_COUNT] = { "cube", "Lpaddle", "Rpaddle", "bounds", "ball" }; //.png, .jpg or .bmp - the skybox wears cube
+
+//decode every texture at once, in parallel - exits if any is missing or broken
+void decodeTextureImages(std::vector<DecodedImage> &images)
+{
+	std::vector<std::string> names(textureImageNames, textureImageNames + TEXTURE_IMAGE_COUNT);
+	if (!decodeImages(names, images))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+}
+
+GLuint uploadTexture(const DecodedImage &image)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.texels.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+void loadTextures()
+{
+	std::vector<DecodedImage> images;
+	decodeTextureImages(images);
+	skyboxTex = uploadTexture(images[SKYBOX_IMAGE]);
+	LeftPaddleTexture = uploadTexture(images[LEFT_PADDLE_IMAGE]);
+	RightPaddleTexture = uploadTexture(images[RIGHT_PADDLE_IMAGE]);
+	boundsTexture = uploadTexture(images[BOUNDS_IMAGE]);
+	ballTexture = uploadTexture(images[BALL_IMAGE]);
+}
+
+//the decoded texels are already the software rasterizer's format - they are moved, not copied
+void setSoftwareTexture(SoftwareTexture &texture, DecodedImage &image)
+{
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.texels.swap(image.texels);
+}
+
+void loadSoftwareTextures()
+{
+	std::vector<DecodedImage> images;
+	decodeTextureImages(images);
+	setSoftwareTexture(skyboxImage, images[SKYBOX_IMAGE]);
+	setSoftwareTexture(LeftPaddleImage, images[LEFT_PADDLE_IMAGE]);
+	setSoftwareTexture(RightPaddleImage, images[RIGHT_PADDLE_IMAGE]);
+	setSoftwareTexture(boundsImage, images[BOUNDS_IMAGE]);
+	setSoftwareTexture(ballImage, images[BALL_IMAGE]);
+}
+// end::loadTextures[]
 
 // tag::loadAssets[]
 void loadAssets()
@@ -1349,11 +1454,123 @@ void loadAssets()
 
 	initializeVertexBuffer(); //load data into a vertex buffer
 
+	loadTextures(); //decode the images in parallel, then upload them
+
+	loadHudFont();
+	initializeTextRenderer(); //upload the glyph atlas, and build the text program
+
+	initializeShadowMap();
+
+	initializeLightClusters(lightClusters);
+	if (!createLightClusterBuffers(lightClusters))
+	{
+		cerr << "Light cluster buffers could not be created." << endl;
+		SDL_Quit();
+		exit(1);
+	}
+
 	cout << "Loaded Assets OK!\n";
 }
 // end::loadAssets[]
 
+// tag::loadSoftwareAssets[]
+//mirrors a VAO from initializeVertexArrayObject - strides in floats, a null pointer for a disabled attribute
+SoftwareMesh softwareMesh(const GLfloat *positions, int positionSize, int positionStride, const GLfloat *uvs, int uvStride,
+                          const GLfloat *colors, int colorSize, int vertexCount)
+{
+	SoftwareMesh mesh;
+	mesh.positions = positions;
+	mesh.positionSize = positionSize;
+	mesh.positionStride = positionStride;
+	mesh.uvs = uvs;
+	mesh.uvStride = uvStride;
+	mesh.colors = colors;
+	mesh.colorSize = colorSize;
+	mesh.colorStride = colorSize;
+	mesh.normals = nullptr;
+	mesh.normalStride = 0;
+	mesh.vertexCount = vertexCount;
+	mesh.indices = nullptr;
+	mesh.indexCount = 0;
+	return mesh;
+}
+
+//the built-in meshes read defaultVertexColor for every vertex - the GL side's disabled array, with a current value
+SoftwareMesh builtInSoftwareMesh(const GLfloat *positions, const GLfloat *uvs, const GLfloat *normals, int vertexCount)
+{
+	SoftwareMesh mesh = softwareMesh(positions, 3, 3, uvs, 2, defaultVertexColor, 3, vertexCount);
+	mesh.colorStride = 0;
+	mesh.normals = normals;
+	mesh.normalStride = 3;
+	return mesh;
+}
+
+//an imported model's mesh, if there is one - it points straight into the mapped cache file
+SoftwareMesh softwareMeshOf(const ModelMesh &model, const SoftwareMesh &builtIn)
+{
+	if (model.indexCount == 0)
+		return builtIn;
+	const int stride = sizeof(MeshVertex) / sizeof(float);
+	SoftwareMesh mesh = softwareMesh(model.vertices[0].position, 3, stride, model.vertices[0].uv, stride,
+	                                 defaultVertexColor, 3, (int)model.header->vertexCount);
+	mesh.colorStride = 0;
+	mesh.normals = model.vertices[0].normal;
+	mesh.normalStride = stride;
+	mesh.indices = model.indices;
+	mesh.indexCount = (int)model.indexCount;
+	return mesh;
+}
+
+void loadSoftwareAssets()
+{
+	if (!createSoftwareRasterizer(softwareRasterizer, 600, 600))
+	{
+		SDL_Quit();
+		exit(1);
+	}
+
+	LeftPaddleMesh = builtInSoftwareMesh(LeftvertexData, cubeTextureData, boxVertexNormals.data(), 36);
+	RightPaddleMesh = builtInSoftwareMesh(RightvertexData, nullptr, boxVertexNormals.data(), 36);
+	boundsMesh = builtInSoftwareMesh(boundsVertexData, nullptr, boundsVertexNormals.data(), 144);
+	cubeMesh = builtInSoftwareMesh(cubeVertexData, cubeTextureData, boxVertexNormals.data(), 36);
+	skyboxMesh = builtInSoftwareMesh(skyboxVertexData, cubeTextureData, nullptr, 36);
+
+	loadModels();
+	boundsMesh = softwareMeshOf(boundsModel, boundsMesh);
+	cubeMesh = softwareMeshOf(ballModel, cubeMesh);
+	LeftPaddleMesh = softwareMeshOf(LeftPaddleModel, LeftPaddleMesh);
+	RightPaddleMesh = softwareMeshOf(RightPaddleModel, RightPaddleMesh);
+
+	loadSoftwareTextures();
+	loadHudFont();
+	cout << "Loaded Software Assets OK!\n";
+}
+// end::loadSoftwareAssets[]
+
 // tag::handleInput[]
+//with --on-demand the sim and render threads sleep when there is nothing to do - these wake them
+void wakeSimulation()
+{
+	if (simulationWake)
+		SDL_SemPost(simulationWake);
+}
+
+void wakeRenderer()
+{
+	if (renderWake)
+		SDL_SemPost(renderWake);
+}
+
+//event timestamps are SDL_GetTicks milliseconds - rebase them onto the performance counter the ticks are timed with
+Uint64 inputCounterOf(Uint32 timestamp)
+{
+	const Uint64 now = SDL_GetPerformanceCounter();
+	const Uint64 age = (Uint64)(SDL_GetTicks() - timestamp) * SDL_GetPerformanceFrequency() / 1000;
+	return age < now ? now - age : now;
+}
+
+//runs on the main thread (SDL only pumps events there), about once a millisecond - it only samples:
+//key transitions are queued with their timestamps for the sim thread, which applies each in the tick it happened in
 void handleInput()
 {
 	//Event-based input handling
@@ -1377,88 +1594,214 @@ void handleInput()
 							//  - such as window close, or SIGINT
 			break;
 
-			//keydown handling - we should to the opposite on key-up for direction controls (generally)
-		case SDL_KEYDOWN:
-			event.key.repeat = true;
-			if (event.key.repeat)
-				switch (event.key.keysym.sym)
-				{
-					//hit escape to exit
-				case SDLK_ESCAPE: done = true;
-					break;
-				case SDLK_SPACE: go = true;		// make game go
-												// statement resets game
-												//positions reset as well as ball velocity and scores
-					if (gameOver == true) {
-						go = false;
-						gameOver = false;
-						ballPos[0] = 0.0f;
-						ballPos[1] = 0.0f;
-						ballVel[0] = 0.02f;
-						ballVel[1] = 0.01f;
-						RPscore = 0;
-						LPscore = 0;
-					}
-					break;
-				case SDLK_w: rpUp = true;
-					break;
-				case SDLK_s: rpDown = true;
-					break;
-				case SDLK_o: lpUp = true;
-					break;
-				case SDLK_l: lpDown = true;
-					break;
-				case SDLK_1: cameraStyle = 0;
-					break;
-				case SDLK_2: cameraStyle = 1;
-					break;
-				case SDLK_3: cameraStyle = 2;
-					break;
-				case SDLK_4: cameraStyle = 3;
-					break;
-				case SDLK_5: cameraStyle = 4;
-					break;
-				case SDLK_UP: cameraForward = true;
-					break;
-				case SDLK_DOWN: cameraBackward = true;
-					break;
-				case SDLK_LEFT: cameraLeft = true;
-					break;
-				case SDLK_RIGHT: cameraRight = true;
-					break;
-				}
+		case SDL_WINDOWEVENT:
+			if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+			{
+				updateDrawableSize();
+				wakeSimulation(); //the new size goes out in the next snapshot
+			}
+			if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+			{
+				redrawRequested = true;
+				wakeRenderer();
+			}
 			break;
+
+		case SDL_KEYDOWN:
 		case SDL_KEYUP:
-			event.key.repeat = true;
 			if (event.key.repeat)
-				switch (event.key.keysym.sym)
-				{
-				case SDLK_w: rpUp = false;
-					break;
-				case SDLK_s: rpDown = false;
-					break;
-				case SDLK_o: lpUp = false;
-					break;
-				case SDLK_l: lpDown = false;
-					break;
-				case SDLK_UP: cameraForward = false;
-					break;
-				case SDLK_DOWN: cameraBackward = false;
-					break;
-				case SDLK_LEFT: cameraLeft = false;
-					break;
-				case SDLK_RIGHT: cameraRight = false;
-					break;
-				}
-			break;			
+				break; //auto-repeat isn't a transition - a held key is already held
+			//hit escape to exit
+			if (event.key.keysym.sym == SDLK_ESCAPE)
+			{
+				done = true;
+				break;
+			}
+			if (event.key.keysym.sym == SDLK_F4 && event.type == SDL_KEYDOWN)
+			{
+				requestedPresentMode = (requestedPresentMode + 1) % PRESENT_MODE_COUNT; //for the render thread
+				break;
+			}
+			InputEvent input;
+			input.counter = inputCounterOf(event.key.timestamp);
+			input.key = event.key.keysym.sym;
+			input.pressed = (event.type == SDL_KEYDOWN);
+			while (!inputEvents.push(input) && !done)
+				SDL_Delay(1); //full - the sim thread has stalled, wait for it rather than lose a key-up
+			wakeSimulation();
+			break;
+		}
+	}
+}
+
+//a key that moves something while held - `held` is the fraction of the current tick it has been down for
+void setHeldKey(bool &down, float &held, bool pressed, float tickFraction)
+{
+	if (pressed == down)
+		return;
+	held += (pressed ? 1.0f : -1.0f) * (1.0f - tickFraction);
+	down = pressed;
+}
+
+//sim thread - tickFraction is how far through the tick the event happened, 0 to 1
+void applyInputEvent(const InputEvent &input, float tickFraction)
+{
+	inputCounter = input.counter; //for the latency measurement
+	inputSerial++;
+
+	if (input.pressed)
+	{
+		//keydown handling - we should to the opposite on key-up for direction controls (generally)
+		switch (input.key)
+		{
+		case SDLK_SPACE: go = true;		// make game go
+										// statement resets game
+										//positions reset as well as ball velocity and scores
+			if (gameOver == true) {
+				go = false;
+				gameOver = false;
+				ballPos[0] = 0.0f;
+				ballPos[1] = 0.0f;
+				ballVel[0] = 0.02f;
+				ballVel[1] = 0.01f;
+				RPscore = 0;
+				LPscore = 0;
+			}
+			break;
+		case SDLK_1: cameraStyle = 0;
+			break;
+		case SDLK_2: cameraStyle = 1;
+			break;
+		case SDLK_3: cameraStyle = 2;
+			break;
+		case SDLK_4: cameraStyle = 3;
+			break;
+		case SDLK_5: cameraStyle = 4;
+			break;
+		case SDLK_F3: showStats = !showStats;
+			break;
+		case SDLK_F5: spectatorLayout = !spectatorLayout;
+			break;
 		}
 	}
+
+	switch (input.key)
+	{
+	case SDLK_w: setHeldKey(rpUp, rpUpHeld, input.pressed, tickFraction);
+		break;
+	case SDLK_s: setHeldKey(rpDown, rpDownHeld, input.pressed, tickFraction);
+		break;
+	case SDLK_o: setHeldKey(lpUp, lpUpHeld, input.pressed, tickFraction);
+		break;
+	case SDLK_l: setHeldKey(lpDown, lpDownHeld, input.pressed, tickFraction);
+		break;
+	case SDLK_UP: cameraForward = input.pressed;
+		break;
+	case SDLK_DOWN: cameraBackward = input.pressed;
+		break;
+	case SDLK_LEFT: cameraLeft = input.pressed;
+		break;
+	case SDLK_RIGHT: cameraRight = input.pressed;
+		break;
+	}
+}
+
+//sim thread - apply everything that happened before tickEnd, at the point in the tick it happened
+void applyInputEvents(Uint64 tickStart, Uint64 tickEnd)
+{
+	rpUpHeld = rpUp ? 1.0f : 0.0f;
+	rpDownHeld = rpDown ? 1.0f : 0.0f;
+	lpUpHeld = lpUp ? 1.0f : 0.0f;
+	lpDownHeld = lpDown ? 1.0f : 0.0f;
+
+	for (const InputEvent *input = inputEvents.front(); input && input->counter < tickEnd; input = inputEvents.front())
+	{
+		float tickFraction = input->counter > tickStart ? (float)(input->counter - tickStart) / (float)(tickEnd - tickStart) : 0.0f;
+		applyInputEvent(*input, tickFraction);
+		inputEvents.pop();
+	}
 }
 // end::handleInput[]
 
 
 
+// tag::pointLights[]
+float sparkRandomUnit() //0 to 1
+{
+	sparkRandom = sparkRandom * 1664525u + 1013904223u;
+	return (sparkRandom >> 8) * (1.0f / 16777216.0f);
+}
+
+void spawnSparks(const glm::vec3 &position, const glm::vec3 &color, int count)
+{
+	for (int i = 0; i < count && sparkCount < maxSparks; i++)
+	{
+		const float angle = sparkRandomUnit() * 6.2831853f;
+		const float speed = 0.01f + 0.02f * sparkRandomUnit();
+		Spark &spark = sparks[sparkCount++];
+		spark.position = position;
+		spark.velocity = glm::vec3(std::cos(angle) * speed, std::sin(angle) * speed, 0.01f + 0.02f * sparkRandomUnit());
+		spark.color = color;
+		spark.life = 1.0f;
+	}
+}
+
+//one tick of sparks and flashes
+void updatePointLights()
+{
+	for (int i = 0; i < sparkCount; )
+	{
+		Spark &spark = sparks[i];
+		spark.position += spark.velocity;
+		spark.velocity *= 0.92f;
+		spark.life -= 1.0f / 40.0f;
+		if (spark.life <= 0.0f)
+			spark = sparks[--sparkCount]; //order doesn't matter
+		else
+			i++;
+	}
+	padLflash = std::max(padLflash - 1.0f / 20.0f, 0.0f);
+	padRflash = std::max(padRflash - 1.0f / 20.0f, 0.0f);
+}
+
+//every point light for this tick - at most maxPointLights, the ones nearest the play first
+int gatherPointLights(PointLight *lights)
+{
+	int count = 0;
+	lights[count++] = { ballPos, 0.6f, glm::vec3(1.0f, 0.6f, 0.2f) };
+	if (padLflash > 0.0f)
+		lights[count++] = { padLpos, 0.9f, glm::vec3(0.3f, 0.5f, 1.0f) * (2.0f * padLflash) };
+	if (padRflash > 0.0f)
+		lights[count++] = { padRpos, 0.9f, glm::vec3(1.0f, 0.3f, 0.3f) * (2.0f * padRflash) };
+	for (int i = 0; i < sparkCount && count < maxPointLights; i++)
+		lights[count++] = { sparks[i].position, 0.25f, sparks[i].color * sparks[i].life };
+
+	//circling the arena at a few heights, in a spread of hues
+	const float time = (float)animationTime;
+	for (int i = 0; i < orbitLightCount && count < maxPointLights; i++)
+	{
+		const float angle = time * 0.5f + i * 2.3999632f; //the golden angle, so they never bunch up
+		const float ring = 0.3f + 0.9f * (float)(i % 7) / 6.0f;
+		const float hue = (float)i / (float)orbitLightCount * 6.2831853f;
+		lights[count++] = { glm::vec3(std::cos(angle) * ring, std::sin(angle) * ring, 0.1f + 0.1f * (i % 3)), 0.35f,
+		                    glm::vec3(0.5f + 0.5f * std::cos(hue), 0.5f + 0.5f * std::cos(hue - 2.0944f), 0.5f + 0.5f * std::cos(hue + 2.0944f)) };
+	}
+	return count;
+}
+// end::pointLights[]
+
 // tag::updateSimulation[]
+//is the ball level with the paddle? - whether it has reached the paddle's x is checked separately
+bool ballOnPaddle(const glm::vec3 &ball, const glm::vec3 &paddle)
+{
+	return ball[1] <= paddle[1] + 0.15f && ball[1] >= paddle[1] - 0.15f;
+}
+
+glm::quat orientationOf(int lane)
+{
+	return glm::quat(orientationW[lane], orientationX[lane], orientationY[lane], orientationZ[lane]);
+}
+
 void updateSimulation(double simLength = 0.02) //update simulation with an amount of time to simulate for (in seconds)
 {
 	//WARNING - we should calculate an appropriate amount of time to simulate - not always use a constant amount of time
@@ -1467,34 +1810,46 @@ void updateSimulation(double simLength = 0.02) //update simulation with an amoun
 		ballPos += ballVel;
 	}
 
+	//with --on-demand the spinning ball and sweeping light hold still out of play, so the screen can settle
+	const bool animating = go || !renderOnDemand;
+
 	float rotate = (float)simLength * rotateSpeed; //simlength is a double for precision, but rotateSpeedVector in a vector of float, alternatively use glm::dvec3
 
-												   //modify the rotateMatrix with the rotate, as a rotate, around the z-axis
+												   //spin the ball about its own 45 degree axis - a quaternion product, rather than a 4x4 one
 	const glm::vec3 unitX = glm::vec3(1, 0, 0);
 	const glm::vec3 unitY = glm::vec3(0, 1, 0);
 	const glm::vec3 unitZ = glm::vec3(0, 0, 1);
 	const glm::vec3 unit45 = glm::normalize(glm::vec3(0, 1, 1));
-	rotateMatrix = glm::rotate(rotateMatrix, rotate, unit45);
+	const glm::quat ballStep = glm::angleAxis(rotate, unit45);
+	spinStepX[BALL_ORIENTATION] = ballStep.x;
+	spinStepY[BALL_ORIENTATION] = ballStep.y;
+	spinStepZ[BALL_ORIENTATION] = ballStep.z;
+	spinStepW[BALL_ORIENTATION] = ballStep.w;
+	if (animating)
+		integrateOrientations(orientations, spinSteps, ORIENTATION_LANES);
+	if (simulationTick % orientationRenormalizeTicks == 0)
+		renormalizeOrientations(orientations, ORIENTATION_LANES);
 	camZ += 0.001f * radius;
 	camX += 0.001f * radius;
 
 	skyBoxUp = glm::vec3(cameraUp.x / 10, cameraUp.y / 10, cameraUp.z / 10);
 	skyBoxRotatematrix = glm::rotate(skyBoxRotatematrix, 0.0f, cameraUp);
-	padLmatrix = glm::translate(glm::mat4(1.0f), padLpos);
-	padRmatrix = glm::translate(glm::mat4(1.0f), padRpos);
-	ballMatrix = glm::translate(glm::mat4(1.0f), ballPos);
 
-	lightPosition = glm::vec3(lightPosition.x, lightPosition.y, lightPosition.z + lightMove);
-	
-	if (lightPosition.z >= 1.0)
+	if (animating)
 	{
-		lightMove = lightMove * -1;
-	}
-	if (lightPosition.z <= -1.0)
-	{
-		lightMove = lightMove * -1;
+		lightPosition = glm::vec3(lightPosition.x, lightPosition.y, lightPosition.z + lightMove);
+
+		if (lightPosition.z >= 1.0)
+		{
+			lightMove = lightMove * -1;
+		}
+		if (lightPosition.z <= -1.0)
+		{
+			lightMove = lightMove * -1;
+		}
+		animationTime += simTickLength;
 	}
-	lightMatrix = glm::translate(glm::mat4(1.0f), lightPosition);
+	setPosition(lightTransform, lightPosition);
 
 	if (cameraForward == true) {
 		cameraPosition -= cameraSpeed * cameraFront;
@@ -1509,22 +1864,10 @@ void updateSimulation(double simLength = 0.02) //update simulation with an amoun
 		cameraPosition += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
 	}
 
-	if (rpDown == true)
-	{
-		padRpos[1] -= 0.02f;
-	}
-	if (rpUp == true)
-	{
-		padRpos[1] += 0.02f;
-	}
-	if (lpDown == true)
-	{
-		padLpos[1] -= 0.02f;
-	}
-	if (lpUp == true)
-	{
-		padLpos[1] += 0.02f;
-	}
+	padRpos[1] -= 0.02f * rpDownHeld;
+	padRpos[1] += 0.02f * rpUpHeld;
+	padLpos[1] -= 0.02f * lpDownHeld;
+	padLpos[1] += 0.02f * lpUpHeld;
 	if (padRpos[1] >= 0.80) {
 		padRpos[1] = 0.80;
 	}
@@ -1539,9 +1882,11 @@ void updateSimulation(double simLength = 0.02) //update simulation with an amoun
 	}
 	if (ballPos[1] >= 0.90) {
 		ballVel[1] = ballVel[1] * -1;
+		spawnSparks(ballPos, glm::vec3(1.0f, 0.8f, 0.4f), 6);
 	}
 	if (ballPos[1] <= -0.90) {
 		ballVel[1] = ballVel[1] * -1;
+		spawnSparks(ballPos, glm::vec3(1.0f, 0.8f, 0.4f), 6);
 	}
 	if (ballPos[0] >= 0.90) {
 		ballPos[0] = 0.0f;
@@ -1555,227 +1900,983 @@ void updateSimulation(double simLength = 0.02) //update simulation with an amoun
 		LPscore++;
 		go = false;
 	}
-	if (ballPos[0] >= 0.75f && ballPos[1] <= padRpos[1] + 0.15f && ballPos[1] >= padRpos[1] - 0.15f) {
+	if (ballPos[0] >= 0.75f && ballOnPaddle(ballPos, padRpos)) {
 		ballVel[0] = -ballVel[0];
+		if (ballVel[0] < 0.0f) { //sent back into play (not turned round again while still inside the paddle)
+			padRflash = 1.0f;
+			spawnSparks(ballPos, glm::vec3(1.0f, 0.4f, 0.3f), 12);
+		}
 	}
-	if (ballPos[0] <= -0.75f && ballPos[1] <= padLpos[1] + 0.15f && ballPos[1] >= padLpos[1] - 0.15f) {
+	if (ballPos[0] <= -0.75f && ballOnPaddle(ballPos, padLpos)) {
 		ballVel[0] = -ballVel[0];
+		if (ballVel[0] > 0.0f) {
+			padLflash = 1.0f;
+			spawnSparks(ballPos, glm::vec3(0.4f, 0.6f, 1.0f), 12);
+		}
 	}
+	updatePointLights();
 
 
 
 	skyBoxPosition = cameraPosition;
-	skyBoxmatrix = glm::translate(glm::mat4(1.0f), skyBoxPosition);
+	setPosition(skyBoxTransform, skyBoxPosition);
+	setScale(skyBoxTransform, glm::vec3(skyboxSize)); //only dirties the matrix the first time
+
+	//each camera style has its own up direction
+	if (cameraStyle == 0 || cameraStyle == 1) {
+		cameraUp = glm::vec3(-1.0f, 0.0f, 0.0f);
+	}
+	if (cameraStyle == 2) {
+		cameraUp = glm::vec3(1.0f, 0.0f, 0.0f);
+	}
+	if (cameraStyle == 3 || cameraStyle == 4) {
+		cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	if (RPscore >= winningScore || LPscore >= winningScore) {
+		gameOver = true;
+	}
+	simulationTick++;
 }
 // end::updateSimulation[]
 
+// tag::publishRenderSnapshot[]
+//would the two snapshots draw the same frame? - everything but the tick and the input bookkeeping
+bool sameFrame(const RenderSnapshot &a, const RenderSnapshot &b)
+{
+	if (memcmp(&a.world, &b.world, sizeof(WorldTransforms)) != 0 ||
+	    a.lightMatrix != b.lightMatrix || a.skyBoxmatrix != b.skyBoxmatrix || a.skyBoxRotatematrix != b.skyBoxRotatematrix)
+		return false;
+	if (a.cameraStyle != b.cameraStyle || a.cameraPosition != b.cameraPosition || a.cameraFront != b.cameraFront ||
+	    a.cameraUp != b.cameraUp || a.ballPos != b.ballPos)
+		return false;
+	if (a.lightPosition != b.lightPosition || a.lightColor != b.lightColor || a.pointLightCount != b.pointLightCount)
+		return false;
+	for (int i = 0; i < a.pointLightCount; i++)
+	{
+		const PointLight &la = a.pointLights[i];
+		const PointLight &lb = b.pointLights[i];
+		if (la.position != lb.position || la.radius != lb.radius || la.color != lb.color)
+			return false;
+	}
+	return a.drawableWidth == b.drawableWidth && a.drawableHeight == b.drawableHeight &&
+	       a.RPscore == b.RPscore && a.LPscore == b.LPscore &&
+	       a.showStats == b.showStats && a.spectatorLayout == b.spectatorLayout;
+}
+
+void setWorldTransform(WorldTransforms &world, WorldTransform object, const glm::vec3 &position, const glm::quat &rotation)
+{
+	world.positionX[object] = position.x;
+	world.positionY[object] = position.y;
+	world.positionZ[object] = position.z;
+	world.rotationX[object] = rotation.x;
+	world.rotationY[object] = rotation.y;
+	world.rotationZ[object] = rotation.z;
+	world.rotationW[object] = rotation.w;
+	world.scaleX[object] = 1.0f;
+	world.scaleY[object] = 1.0f;
+	world.scaleZ[object] = 1.0f;
+}
+
+//copy what render() needs into the snapshot the render thread will pick up next
+//returns false if, with --on-demand, it would draw the same frame as the last one - then nothing is handed over
+bool publishRenderSnapshot()
+{
+	RenderSnapshot &snapshot = renderSnapshots.writeSlot();
+	snapshot.tick = simulationTick;
+
+	setWorldTransform(snapshot.world, ARENA_TRANSFORM, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	setWorldTransform(snapshot.world, BALL_TRANSFORM, ballPos, orientationOf(BALL_ORIENTATION));
+	setWorldTransform(snapshot.world, LEFT_PADDLE_TRANSFORM, padLpos, orientationOf(LEFT_PADDLE_ORIENTATION));
+	setWorldTransform(snapshot.world, RIGHT_PADDLE_TRANSFORM, padRpos, orientationOf(RIGHT_PADDLE_ORIENTATION));
+	snapshot.lightMatrix = worldMatrixOf(lightTransform);
+	snapshot.skyBoxmatrix = worldMatrixOf(skyBoxTransform);
+	snapshot.skyBoxRotatematrix = skyBoxRotatematrix;
+
+	snapshot.cameraStyle = cameraStyle;
+	snapshot.cameraPosition = cameraPosition;
+	snapshot.cameraFront = cameraFront;
+	snapshot.cameraUp = cameraUp;
+	snapshot.ballPos = ballPos;
+
+	snapshot.lightPosition = lightPosition;
+	snapshot.lightColor = glm::vec3(lightColor[0], lightColor[1], lightColor[2]);
+	snapshot.pointLightCount = gatherPointLights(snapshot.pointLights);
+
+	snapshot.drawableWidth = drawableWidth;
+	snapshot.drawableHeight = drawableHeight;
+
+	snapshot.inputSerial = inputSerial;
+	snapshot.inputCounter = inputCounter;
+
+	snapshot.RPscore = RPscore;
+	snapshot.LPscore = LPscore;
+	snapshot.showStats = showStats;
+	snapshot.spectatorLayout = spectatorLayout;
+
+	if (renderOnDemand)
+	{
+		if (snapshotPublished && sameFrame(snapshot, publishedSnapshot))
+			return false;
+		publishedSnapshot = snapshot;
+		snapshotPublished = true;
+	}
+	renderSnapshots.publish();
+	wakeRenderer();
+	return true;
+}
+// end::publishRenderSnapshot[]
+
 // tag::preRender[]
-void preRender()
+void preRender(int width, int height)
 {
-	glViewport(0, 0, 600, 600); //set viewpoint
+	glViewport(0, 0, width, height); //set viewpoint
 	glClearColor(1.0f, 0.0f, 0.0f, 1.0f); //set clear colour
 	glClear(GL_COLOR_BUFFER_BIT); //clear the window (technical the scissor box bounds)
 }
 // end::preRender[]
 
 // tag::render[]
-void render()
+//distance from the camera along its view direction, used to sort opaque draws front-to-back
+float viewDepthOf(const glm::mat4 &viewMatrix, const glm::mat4 &modelMatrix)
+{
+	return -(viewMatrix * modelMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z;
+}
+
+//the arena's, ball's and paddles' world matrices, indexed by WorldTransform - one batched call for all of them
+void buildWorldObjectMatrices(const RenderSnapshot &snapshot, glm::mat4 worldMatrices[WORLD_TRANSFORM_COUNT])
 {
-	glUseProgram(theProgram);
-	glEnable(GL_DEPTH_TEST);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const WorldTransforms &world = snapshot.world;
+	const TransformArrays transforms = { world.positionX, world.positionY, world.positionZ,
+	                                     world.rotationX, world.rotationY, world.rotationZ, world.rotationW,
+	                                     world.scaleX, world.scaleY, world.scaleZ };
+	buildWorldMatrices(transforms, WORLD_TRANSFORM_COUNT, worldMatrices);
+}
 
-	glUniform3f(lightColorLocation, lightColor[0], lightColor[1], lightColor[2]);
-	glUniform3f(lightPositionLocation, lightPosition.x, lightPosition.y, lightPosition.z);
-	glUniform3f(cameraPositionLocation, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-	/////////
+ObjectParameters objectParameters(const glm::mat4 &modelMatrix, const glm::mat4 &rotateMatrix)
+{
+	ObjectParameters object;
+	object.modelMatrix = modelMatrix;
+	object.rotateMatrix = rotateMatrix;
+	return object;
+}
 
-	if (RPscore == 0) {
-		glBindTexture(GL_TEXTURE_2D, Rscore0Texture);
-	}
-	if (RPscore == 1) {
-		glBindTexture(GL_TEXTURE_2D, Rscore1Texture);
+// tag::hudText[]
+//time between presents, smoothed over roughly ten frames - call once per frame
+void updateFrameTime()
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (lastFrameCounter != 0)
+	{
+		double milliseconds = (now - lastFrameCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+		frameTimeMs = (frameTimeMs == 0.0) ? milliseconds : frameTimeMs * 0.9 + milliseconds * 0.1;
 	}
-	if (RPscore == 2) {
-		glBindTexture(GL_TEXTURE_2D, Rscore2Texture);
+	lastFrameCounter = now;
+}
+
+//scores in the top corners, and (with F3) frame stats along the bottom - in pixels, for a width x height screen
+void buildHudText(const RenderSnapshot &snapshot, const std::string &stats, int width, int height)
+{
+	clearText(hudText);
+	const glm::vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+	const float margin = 30.0f;
+
+	std::string leftScore = std::to_string(snapshot.LPscore);
+	std::string rightScore = std::to_string(snapshot.RPscore);
+	addText(hudText, glyphAtlas, scoreFont, leftScore, margin, margin, white);
+	addText(hudText, glyphAtlas, scoreFont, rightScore, width - margin - measureText(glyphAtlas, scoreFont, rightScore), margin, white);
+
+	if (snapshot.LPscore >= winningScore || snapshot.RPscore >= winningScore)
+	{
+		const float resultY = margin + glyphAtlas.fonts[scoreFont].lineHeight;
+		std::string leftResult = snapshot.LPscore >= winningScore ? "WINNER" : "LOSER";
+		std::string rightResult = snapshot.RPscore >= winningScore ? "WINNER" : "LOSER";
+		addText(hudText, glyphAtlas, scoreFont, leftResult, margin, resultY, white);
+		addText(hudText, glyphAtlas, scoreFont, rightResult, width - margin - measureText(glyphAtlas, scoreFont, rightResult), resultY, white);
 	}
-	if (RPscore == 3) {
-		glBindTexture(GL_TEXTURE_2D, RwinnerTexture);
+
+	if (snapshot.showStats)
+	{
+		const glm::vec4 yellow(1.0f, 1.0f, 0.4f, 1.0f);
+		const float lineHeight = (float)glyphAtlas.fonts[statsFont].lineHeight;
+		int fps = frameTimeMs > 0.0 ? (int)(1000.0 / frameTimeMs + 0.5) : 0;
+		const InputLatency &latency = softwareRendering ? softwareLatency : framesInFlight.latency;
+		char timing[128];
+		snprintf(timing, sizeof(timing), "FPS: %d (%.1f ms) Present: %s Latency: %.1f ms", fps, frameTimeMs,
+		         softwareRendering ? "software" : presentModeName(presentMode), latency.latencyMs);
+		addText(hudText, glyphAtlas, statsFont, timing, 10.0f, height - 10.0f - 2.0f * lineHeight, yellow);
+		addText(hudText, glyphAtlas, statsFont, stats, 10.0f, height - 10.0f - lineHeight, yellow);
 	}
-	if (LPscore == 3) {
-		glBindTexture(GL_TEXTURE_2D, RloserTexture);
-		gameOver = true;
+}
+// end::hudText[]
+
+// tag::cameraMatrices[]
+//render thread - camera matrices are kept from frame to frame, and only recomputed when what they are built from changes
+const float cameraFov = 45.0f;
+const float cameraNearPlane = 0.1f; //also the depth range the render queue's sort key and the light clusters cover
+const float cameraFarPlane = 100.0f;
+CachedLookAt cameraViews[maxViews] = {}; //one per camera style
+CachedProjection sceneProjection = {};
+CachedProjection spectatorProjections[2] = {}; //the spectator layout's top view, and the four along the bottom
+
+const glm::mat4 &projectionMatrixOf(CachedProjection &cache, float aspect)
+{
+	return perspectiveOf(cache, cameraFov, aspect, cameraNearPlane, cameraFarPlane);
+}
+
+//the view for one of the camera styles (keys 1 to 5) - only that style's lookAt is worked out
+const glm::mat4 &viewMatrixOf(const RenderSnapshot &snapshot, int cameraStyle)
+{
+	const glm::vec3 &cameraPosition = snapshot.cameraPosition;
+	const glm::vec3 &cameraUp = snapshot.cameraUp;
+	const glm::vec3 arenaCenter(0.0f, 0.0f, 0.0f);
+	CachedLookAt &view = cameraViews[cameraStyle];
+	switch (cameraStyle)
+	{
+	case 0: return lookAtOf(view, glm::vec3(0.0f, 0.0f, 1.0f) + cameraPosition, glm::vec3(snapshot.ballPos.x, snapshot.ballPos.y, 0.0f), cameraUp);
+	case 1: return lookAtOf(view, glm::vec3(2.0f, 0.0f, 1.0f) + cameraPosition, arenaCenter, cameraUp);
+	case 2: return lookAtOf(view, glm::vec3(-2.0f, 0.0f, 1.0f) + cameraPosition, arenaCenter, cameraUp);
+	case 3: return lookAtOf(view, glm::vec3(0.0f, 0.0f, 3.0f) + cameraPosition, arenaCenter, cameraUp);
+	default: return lookAtOf(view, cameraPosition, cameraPosition - snapshot.cameraFront, cameraUp);
 	}
-	glBindVertexArray(rightUIVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
+}
+// end::cameraMatrices[]
 
+//camera and lighting for the world pass
+FrameParameters frameParametersOf(const RenderSnapshot &snapshot, float aspect)
+{
+	FrameParameters frame;
+	frame.lightPosition = snapshot.lightPosition;
+	frame.lightColor = snapshot.lightColor;
+	frame.cameraPosition = snapshot.cameraPosition;
+	frame.viewMatrix = viewMatrixOf(snapshot, snapshot.cameraStyle);
+	frame.projectionMatrix = projectionMatrixOf(sceneProjection, aspect);
+
+	//the point lights' clusters - render() fills in the tile size and depth slicing once it has built them
+	frame.clusterLightData = 1;
+	frame.clusterRanges = 2;
+	frame.clusterLightIndices = 3;
+	frame.clusterTilesX = clusterTilesX;
+	frame.clusterTilesY = clusterTilesY;
+	frame.clusterSlices = clusterSlices;
+	frame.clusterTileSize = glm::vec2(1.0f);
+	frame.clusterDepthParams = glm::vec2(0.0f);
+
+	//render() fills in the matrix and texel size once the shadow map is up to date
+	frame.shadowMap = 4;
+	frame.shadowMatrix = glm::mat4(1.0f);
+	frame.shadowTexelScale = 0.0f;
+
+	//one view unless render() sets up the spectator layout
+	frame.viewCount = 1;
+	for (int view = 0; view < maxViews; view++)
+		frame.viewProjections[view] = frame.projectionMatrix * frame.viewMatrix;
+	return frame;
+}
 
-	if (LPscore == 0) {
-		glBindTexture(GL_TEXTURE_2D, Lscore0Texture);
-	}
-	if (LPscore == 1) {
-		glBindTexture(GL_TEXTURE_2D, Lscore1Texture);
+//something drawn in the world pass - a built-in mesh, or the imported model that replaces it
+struct WorldObject
+{
+	GLuint texture;
+	GLuint vertexArrayObject;
+	bool indexed;
+	GLsizei count; //vertices, or indices if indexed
+	glm::mat4 worldMatrix;
+	const BoundingSphere *localBounds;
+};
+
+WorldObject worldObject(GLuint texture, const ModelMesh &model, GLuint vertexArrayObject, GLsizei vertexCount, const BoundingSphere &bounds,
+                        const glm::mat4 &worldMatrix)
+{
+	WorldObject object = { texture, vertexArrayObject, false, vertexCount, worldMatrix, &bounds };
+	if (model.indexCount > 0)
+	{
+		object.vertexArrayObject = model.vertexArrayObject;
+		object.indexed = true;
+		object.count = (GLsizei)model.indexCount;
+		object.localBounds = &model.bounds;
 	}
-	if (LPscore == 2) {
-		glBindTexture(GL_TEXTURE_2D, Lscore2Texture);
+	return object;
+}
+
+// tag::spectatorLayout[]
+//the spectator layout: the active camera across the top two thirds, and the other four side by side along the bottom
+//fills in GL viewports (x, y, width, height - from the bottom left) for a width x height target; returns the view count
+int spectatorViews(int activeStyle, int width, int height, int styles[maxViews], GLfloat viewports[maxViews][4])
+{
+	const float bottomHeight = (float)height / 3.0f;
+	styles[0] = activeStyle;
+	viewports[0][0] = 0.0f;
+	viewports[0][1] = bottomHeight;
+	viewports[0][2] = (float)width;
+	viewports[0][3] = (float)height - bottomHeight;
+	int view = 1;
+	for (int style = 0; style < maxViews; style++)
+	{
+		if (style == activeStyle)
+			continue;
+		styles[view] = style;
+		viewports[view][0] = (float)width * (view - 1) / (maxViews - 1);
+		viewports[view][1] = 0.0f;
+		viewports[view][2] = (float)width / (maxViews - 1);
+		viewports[view][3] = bottomHeight;
+		view++;
 	}
-	if (LPscore == 3) {
-		glBindTexture(GL_TEXTURE_2D, LwinnerTexture);
+	return view;
+}
+// end::spectatorLayout[]
+
+//draws into whatever framebuffer is bound, width x height pixels, through the render graph: the shadow map, then
+//the scene - straight into that framebuffer, or (with dynamic resolution on) into a transient target that is
+//upscaled into it - then the HUD, always at full resolution
+void render(const RenderSnapshot &snapshot, int width, int height)
+{
+	const glm::mat4 identity(1.0f);
+	clearRenderQueue(renderQueue);
+	renderQueue.nearPlane = cameraNearPlane; //before anything is submitted - each draw's depth key is quantised against them
+	renderQueue.farPlane = cameraFarPlane;
+
+	const float aspect = (float)width / (float)height;
+	const glm::mat4 &projection = projectionMatrixOf(sceneProjection, aspect);
+	const glm::mat4 &activeView = viewMatrixOf(snapshot, snapshot.cameraStyle);
+
+	//the spectator layout draws every camera style at once - each object is still submitted once, and the
+	//MULTIVIEW geometry shader fans its triangles out to the viewports
+	const bool multiview = snapshot.spectatorLayout && multiviewSupported;
+	const unsigned viewFeatures = multiview ? SHADER_MULTIVIEW : 0;
+	int viewStyles[maxViews];
+	GLfloat viewports[maxViews][4];
+	glm::mat4 viewProjections[maxViews];
+	const int viewCount = multiview ? spectatorViews(snapshot.cameraStyle, width, height, viewStyles, viewports) : 0;
+	for (int view = 0; view < viewCount; view++)
+		viewProjections[view] = projectionMatrixOf(spectatorProjections[view == 0 ? 0 : 1], viewports[view][2] / viewports[view][3]) *
+		                        viewMatrixOf(snapshot, viewStyles[view]);
+
+	//world objects get the full lighting model - but only if some of them is on screen
+	//their matrices are built once here, and shared by the shadow casters, the culling and the render queue
+	glm::mat4 worldMatrices[WORLD_TRANSFORM_COUNT];
+	buildWorldObjectMatrices(snapshot, worldMatrices);
+	const WorldObject worldObjects[] = {
+		worldObject(boundsTexture, boundsModel, boundsVertexArrayObject, 144, boundsBoundingSphere, worldMatrices[ARENA_TRANSFORM]),
+		worldObject(ballTexture, ballModel, cubeVertexArrayObject, 36, cubeBoundingSphere, worldMatrices[BALL_TRANSFORM]),
+		worldObject(LeftPaddleTexture, LeftPaddleModel, LeftPaddleVertexArrayObject, 36, LeftPaddleBoundingSphere, worldMatrices[LEFT_PADDLE_TRANSFORM]),
+		worldObject(RightPaddleTexture, RightPaddleModel, RightPaddleVertexArrayObject, 36, RightPaddleBoundingSphere, worldMatrices[RIGHT_PADDLE_TRANSFORM]),
+	};
+	const size_t worldObjectCount = sizeof(worldObjects) / sizeof(worldObjects[0]);
+
+	//shadows - the arena is static, so its depth is only redrawn when the light has moved far enough
+	//everything casts, on screen or not; the frustum is fitted around the arena, which holds the rest
+	ShadowCaster casters[worldObjectCount];
+	for (size_t i = 0; i < worldObjectCount; i++)
+	{
+		const WorldObject &object = worldObjects[i];
+		casters[i] = { object.vertexArrayObject, object.indexed, object.count, object.worldMatrix };
 	}
-	if (RPscore == 3) {
-		glBindTexture(GL_TEXTURE_2D, LloserTexture);
-		gameOver = true;
+	const BoundingSphere arenaBounds = { glm::vec3(casters[0].worldMatrix * glm::vec4(worldObjects[0].localBounds->center, 1.0f)),
+	                                     worldObjects[0].localBounds->radius };
+
+	//world-space spheres (all our transforms are rigid, so the radius carries over unchanged)
+	float sphereX[worldObjectCount], sphereY[worldObjectCount], sphereZ[worldObjectCount], sphereRadius[worldObjectCount];
+	uint8_t visible[worldObjectCount];
+	for (size_t i = 0; i < worldObjectCount; i++)
+	{
+		const WorldObject &object = worldObjects[i];
+		glm::vec4 center = object.worldMatrix * glm::vec4(object.localBounds->center, 1.0f);
+		sphereX[i] = center.x;
+		sphereY[i] = center.y;
+		sphereZ[i] = center.z;
+		sphereRadius[i] = object.localBounds->radius;
 	}
-	glBindVertexArray(leftUIVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
-
-	/////////
-	glm::mat4 projection;
-	projection = glm::perspective(45.0f, 1.0f, 0.1f, 100.0f);
-	glUniformMatrix4fv(projectionMatrixLocation, 1, false, glm::value_ptr(projection));
-
-	view = glm::lookAt(glm::vec3(0.0f, 0.0f, 1.0f) + cameraPosition, glm::vec3(ballPos.x, ballPos.y, 0.0f), cameraUp);
-	view1 = glm::lookAt(glm::vec3(2.0f, 0.0f, 1.0f) + cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), cameraUp);
-	view2 = glm::lookAt(glm::vec3(-2.0f, 0.0f, 1.0f) + cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), cameraUp);
-	view3 = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f) + cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), cameraUp);
-	view4 = glm::lookAt(cameraPosition, cameraPosition - cameraFront, cameraUp);
-	if (cameraStyle == 0) {
-		glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view));
-		cameraUp = glm::vec3(-1.0f, 0.0f, 0.0f);
+	if (multiview)
+	{
+		//on screen in any of the views
+		uint8_t visibleInView[worldObjectCount];
+		std::fill(visible, visible + worldObjectCount, 0);
+		for (int view = 0; view < viewCount; view++)
+		{
+			cullSpheres(extractFrustum(viewProjections[view]), sphereX, sphereY, sphereZ, sphereRadius, worldObjectCount, visibleInView);
+			for (size_t i = 0; i < worldObjectCount; i++)
+				visible[i] |= visibleInView[i];
+		}
 	}
-	if (cameraStyle == 1) {
-		glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view1));
-		cameraUp = glm::vec3(-1.0f, 0.0f, 0.0f);
+	else
+	{
+		cullSpheres(extractFrustum(projection * activeView), sphereX, sphereY, sphereZ, sphereRadius, worldObjectCount, visible);
 	}
-	if (cameraStyle == 2) {
-		glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view2));
-		cameraUp = glm::vec3(1.0f, 0.0f, 0.0f);
+
+	const unsigned litTextured = SHADER_LIT | SHADER_TEXTURED | viewFeatures;
+	culledObjectCount = 0;
+	for (size_t i = 0; i < worldObjectCount; i++)
+	{
+		const WorldObject &object = worldObjects[i];
+		if (!visible[i])
+		{
+			culledObjectCount++;
+			continue;
+		}
+		if (object.indexed)
+			submitIndexedDraw(renderQueue, PASS_WORLD, litTextured, object.texture, object.vertexArrayObject, 0, object.count,
+			                  objectParameters(object.worldMatrix, identity), viewDepthOf(activeView, object.worldMatrix));
+		else
+			submitDraw(renderQueue, PASS_WORLD, litTextured, object.texture, object.vertexArrayObject, 0, object.count,
+			           objectParameters(object.worldMatrix, identity), viewDepthOf(activeView, object.worldMatrix));
 	}
-	if (cameraStyle == 3) {
-		glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view3));
-		cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	//the skybox is just a texture around the camera - no lighting needed
+	submitDraw(renderQueue, PASS_SKYBOX, SHADER_TEXTURED | viewFeatures, skyboxTex, skyboxVertexArrayObject, 0, 36,
+	           objectParameters(snapshot.skyBoxmatrix * snapshot.skyBoxRotatematrix, identity), 0.0f);
+	sortRenderQueue(renderQueue);
+
+	//point lights into clusters
+	buildLightClusters(lightClusters, activeView, projection, cameraNearPlane, cameraFarPlane,
+	                   snapshot.pointLights, snapshot.pointLightCount);
+
+	// tag::renderGraph[]
+	GLint backbuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &backbuffer);
+	beginRenderGraph(renderGraph, (GLuint)backbuffer);
+
+	const RenderGraphHandle shadowDepth = createGraphTexture(renderGraph, "shadow map", { shadowMapSize, shadowMapSize, GL_DEPTH_COMPONENT24 });
+	addGraphPass(renderGraph, "shadow", {}, { shadowDepth }, [&](RenderGraph &, const RenderGraphPass &pass) {
+		updateShadowMap(shadowMap, pass.framebuffer, snapshot.lightPosition, arenaBounds, casters, 1, casters + 1, (int)worldObjectCount - 1);
+	});
+
+	//the dynamic resolution target is the drawable's size - the scale only changes how much of it is drawn into
+	RenderGraphHandle sceneColor = graphBackbuffer;
+	std::vector<RenderGraphHandle> sceneTargets(1, graphBackbuffer);
+	if (dynamicResolutionEnabled)
+	{
+		sceneColor = createGraphTexture(renderGraph, "scene colour", { width, height, GL_RGBA8 });
+		sceneTargets[0] = sceneColor;
+		sceneTargets.push_back(createGraphTexture(renderGraph, "scene depth", { width, height, GL_DEPTH_COMPONENT24 }));
 	}
-	if (cameraStyle == 4) {
-		glUniformMatrix4fv(viewMatrixLocation, 1, false, glm::value_ptr(view4));
-		cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	addGraphPass(renderGraph, "scene", { shadowDepth }, sceneTargets, [&](RenderGraph &graph, const RenderGraphPass &) {
+		if (dynamicResolutionEnabled)
+			beginScene(dynamicResolution, width, height);
+		else
+			glViewport(0, 0, width, height);
+		glEnable(GL_DEPTH_TEST);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		uploadLightClusters(lightClusters, 1);
+		bindShadowMap(shadowMap, graphTexture(graph, shadowDepth), 4);
+
+		//per-pass parameters - the world and skybox share the camera; cluster tiles are in the pixels of the viewport drawn into
+		const int sceneWidth = dynamicResolutionEnabled ? dynamicResolution.width : width;
+		const int sceneHeight = dynamicResolutionEnabled ? dynamicResolution.height : height;
+		FrameParameters frame = frameParametersOf(snapshot, aspect);
+		frame.clusterTileSize = glm::vec2((float)sceneWidth / clusterTilesX, (float)sceneHeight / clusterTilesY);
+		frame.clusterDepthParams = glm::vec2(lightClusters.depthScale, lightClusters.depthBias);
+		frame.shadowMatrix = shadowMatrixOf(shadowMap);
+		frame.shadowTexelScale = shadowTexelScaleOf(shadowMap);
+		if (multiview)
+		{
+			//the layout again, for the (possibly scaled down) target actually drawn into
+			spectatorViews(snapshot.cameraStyle, sceneWidth, sceneHeight, viewStyles, viewports);
+			glViewportArrayv(0, viewCount, &viewports[0][0]);
+			frame.viewCount = viewCount;
+			std::copy(viewProjections, viewProjections + viewCount, frame.viewProjections);
+		}
+		renderQueue.passParameters[PASS_WORLD] = frame;
+		renderQueue.passParameters[PASS_SKYBOX] = frame;
+		//not VAO state, and the HUD's draws with the array on may leave it undefined - so set each frame
+		glVertexAttrib3fv(vertexColorLocation, defaultVertexColor);
+
+		if (renderQueue.instanceStream)
+			beginStreamFrame(*renderQueue.instanceStream);
+		executeRenderQueue(renderQueue, shaderVariants);
+		if (renderQueue.instanceStream)
+			endStreamFrame(*renderQueue.instanceStream);
+		if (multiview)
+			glViewport(0, 0, sceneWidth, sceneHeight); //sets every viewport back to one
+	});
+
+	if (dynamicResolutionEnabled)
+	{
+		addGraphPass(renderGraph, "resolve", { sceneColor }, { graphBackbuffer }, [&](RenderGraph &graph, const RenderGraphPass &) {
+			resolveScene(dynamicResolution, graphFramebuffer(graph, { sceneColor }), width, height);
+		});
 	}
-	
-	glBindTexture(GL_TEXTURE_2D, boundsTexture);
-	glBindVertexArray(boundsVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(glm::mat4(1.0f)));
-	glDrawArrays(GL_TRIANGLES, 0, 144);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
-
-	glBindVertexArray(lightVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(lightMatrix));
-	//glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-
-	glBindTexture(GL_TEXTURE_2D, ballTexture);
-	glBindVertexArray(cubeVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(rotateMatrix));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(ballMatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
-
-	glBindTexture(GL_TEXTURE_2D, LeftPaddleTexture);
-	glBindVertexArray(LeftPaddleVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(padLmatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
 
-	glBindTexture(GL_TEXTURE_2D, RightPaddleTexture);
-	glBindVertexArray(RightPaddleVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(padRmatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
-
-	glBindTexture(GL_TEXTURE_2D, skyboxTex);
-	glBindVertexArray(skyboxVertexArrayObject);
-	glUniformMatrix4fv(rotateMatrixLocation, 1, GL_FALSE, glm::value_ptr(skyBoxRotatematrix));
-	glUniformMatrix4fv(modelMatrixLocation, 1, false, glm::value_ptr(skyBoxmatrix));
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindVertexArray(0);
-
-	
-
-	glUseProgram(0); //clean up
+	//HUD text over everything, in one draw
+	addGraphPass(renderGraph, "hud", {}, { graphBackbuffer }, [&](RenderGraph &graph, const RenderGraphPass &) {
+		std::string stats = "Draws: " + std::to_string(renderQueue.stats.draws) + " (culled " + std::to_string(culledObjectCount) + ")"
+		                  + " Binds: " + std::to_string(renderQueue.stats.programChanges) + "/"
+		                  + std::to_string(renderQueue.stats.textureChanges) + "/" + std::to_string(renderQueue.stats.vertexArrayChanges);
+		if (dynamicResolutionEnabled)
+			stats += " Scale: " + std::to_string((int)(dynamicResolution.scale * 100.0f + 0.5f)) + "%";
+		if (multiview)
+			stats += " Views: " + std::to_string(viewCount);
+		stats += " Shadow redraws: " + std::to_string(shadowMap.staticRenders);
+		stats += " Lights: " + std::to_string(lightClusters.lightCount) + " (" + std::to_string(lightClusters.assignedCount) + " assigned)";
+		char targets[64];
+		snprintf(targets, sizeof(targets), " Targets: %.1f MB (%.1f unaliased)",
+		         graph.stats.peakBytes / (1024.0 * 1024.0), graph.stats.unaliasedBytes / (1024.0 * 1024.0));
+		stats += targets;
+		glViewport(0, 0, width, height);
+		buildHudText(snapshot, stats, width, height);
+		drawText(textRenderer, hudText, width, height);
+	});
+
+	compileRenderGraph(renderGraph);
+	executeRenderGraph(renderGraph);
+	// end::renderGraph[]
 }
 // end::render[]
 
+// tag::renderSoftware[]
+//render() on the CPU - same passes, in the same order, without the GL state sorting (there is no state to change)
+void renderSoftware(const RenderSnapshot &snapshot)
+{
+	const glm::mat4 identity(1.0f);
+	beginSoftwareFrame(softwareRasterizer, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)); //preRender's clear colour
+
+	FrameParameters frame = frameParametersOf(snapshot, (float)softwareRasterizer.width / (float)softwareRasterizer.height);
+	const unsigned litTextured = SHADER_LIT | SHADER_TEXTURED;
+	glm::mat4 worldMatrices[WORLD_TRANSFORM_COUNT];
+	buildWorldObjectMatrices(snapshot, worldMatrices);
+	drawSoftware(softwareRasterizer, boundsMesh, &boundsImage, litTextured, true, frame, objectParameters(worldMatrices[ARENA_TRANSFORM], identity));
+	drawSoftware(softwareRasterizer, cubeMesh, &ballImage, litTextured, true, frame, objectParameters(worldMatrices[BALL_TRANSFORM], identity));
+	drawSoftware(softwareRasterizer, LeftPaddleMesh, &LeftPaddleImage, litTextured, true, frame, objectParameters(worldMatrices[LEFT_PADDLE_TRANSFORM], identity));
+	drawSoftware(softwareRasterizer, RightPaddleMesh, &RightPaddleImage, litTextured, true, frame, objectParameters(worldMatrices[RIGHT_PADDLE_TRANSFORM], identity));
+
+	drawSoftware(softwareRasterizer, skyboxMesh, &skyboxImage, SHADER_TEXTURED, true, frame,
+	             objectParameters(snapshot.skyBoxmatrix, snapshot.skyBoxRotatematrix));
+
+	finishSoftwareFrame(softwareRasterizer);
+
+	//HUD text - blended straight into the finished frame
+	std::string stats = "Triangles: " + std::to_string(softwareRasterizer.triangles.size()) + " (software)";
+	buildHudText(snapshot, stats, softwareRasterizer.width, softwareRasterizer.height);
+	drawSoftwareText(softwareRasterizer, glyphAtlas, hudText);
+}
+// end::renderSoftware[]
+
 // tag::postRender[]
 void postRender()
 {
 	SDL_GL_SwapWindow(win);; //present the frame buffer to the display (swapBuffers)
+	updateFrameTime();
+	frameLine += "Frame: " + std::to_string(frameCount++);
+	frameLine += " Draws: " + std::to_string(renderQueue.stats.draws) + " (culled " + std::to_string(culledObjectCount) + ")";
+	frameLine += " Binds (program/texture/VAO): " + std::to_string(renderQueue.stats.programChanges) + "/"
+	           + std::to_string(renderQueue.stats.textureChanges) + "/" + std::to_string(renderQueue.stats.vertexArrayChanges);
+	cout << "\r" << frameLine << std::flush;
+	frameLine = "";
+}
+
+void postRenderSoftware()
+{
+	presentSoftwareFrame(softwareRasterizer, win);
+	updateFrameTime();
 	frameLine += "Frame: " + std::to_string(frameCount++);
+	frameLine += " Triangles: " + std::to_string(softwareRasterizer.triangles.size()) + " (software)";
 	cout << "\r" << frameLine << std::flush;
 	frameLine = "";
 }
+
+//hand the frame just rendered to the video encoder - call once per new snapshot, before the swap
+void captureRenderedFrame(const RenderSnapshot &snapshot)
+{
+	if (!capturing)
+		return;
+	if (softwareRendering)
+		captureFramePixels(videoCapture, readSoftwareFrame(softwareRasterizer).data(), false, snapshot.tick);
+	else
+		captureFrame(videoCapture, snapshot.tick);
+}
 // end::postRender[]
 
 // tag::cleanUp[]
 void cleanUp()
 {
-	SDL_GL_DeleteContext(context);
+	destroyModels();
+	if (softwareRendering)
+	{
+		destroySoftwareRasterizer(softwareRasterizer);
+	}
+	else
+	{
+		if (renderQueue.instanceStream)
+			destroyStreamBuffer(*renderQueue.instanceStream);
+		if (dynamicResolutionEnabled)
+			destroyDynamicResolution(dynamicResolution);
+		destroyLightClusterBuffers(lightClusters);
+		destroyShadowMap(shadowMap);
+		destroyRenderGraph(renderGraph);
+		destroyTextRenderer(textRenderer);
+		SDL_GL_DeleteContext(context);
+	}
+	TTF_Quit();
 	SDL_DestroyWindow(win);
 	cout << "Cleaning up OK!\n";
 }
 // end::cleanUp[]
 
+// tag::renderThread[]
+//owns the GL context - draws the most recent snapshot, as fast as the driver (or vsync) allows
+//the input the snapshot is the first frame to show, if any - returns when it happened, or 0
+uint64_t newInputCounterOf(const RenderSnapshot &snapshot)
+{
+	if (snapshot.inputSerial == shownInputSerial)
+		return 0;
+	shownInputSerial = snapshot.inputSerial;
+	return snapshot.inputCounter;
+}
+
+//switch present mode if F4 asked for a different one - needs the context current
+void updatePresentMode()
+{
+	static int appliedRequest = -1;
+	const int request = requestedPresentMode;
+	if (request != appliedRequest)
+	{
+		presentMode = applyPresentMode((PresentMode)request);
+		appliedRequest = request;
+	}
+}
+
+int renderThreadMain(void *)
+{
+	createFrameLimiter(frameLimiter, frameLimit);
+	if (softwareRendering)
+	{
+		resetInputLatency(softwareLatency);
+		while (!done)
+		{
+			waitForNextFrame(frameLimiter);
+			bool fresh = renderSnapshots.acquire();
+			if (renderOnDemand && !fresh && !redrawRequested.exchange(false))
+			{
+				SDL_SemWaitTimeout(renderWake, idleWakeMs); //the last frame is still right
+				continue;
+			}
+			renderSoftware(renderSnapshots.readSlot());
+			if (fresh)
+				captureRenderedFrame(renderSnapshots.readSlot());
+			postRenderSoftware();
+			recordInputLatency(softwareLatency, newInputCounterOf(renderSnapshots.readSlot()));
+		}
+		return 0;
+	}
+
+	SDL_GL_MakeCurrent(win, context);
+	createFramesInFlight(framesInFlight, maxFramesInFlight);
+
+	while (!done)
+	{
+		updatePresentMode();
+
+		//wait first, and only then pick up the newest snapshot - so the wait doesn't add to the latency
+		waitForNextFrame(frameLimiter);
+		waitForFramesInFlight(framesInFlight);
+
+		bool fresh = renderSnapshots.acquire(); //if nothing new arrived, redraw the last snapshot
+		if (renderOnDemand && !fresh && !redrawRequested.exchange(false))
+		{
+			//unless it would be the frame already on screen - then sleep until the sim publishes something new
+			SDL_SemWaitTimeout(renderWake, idleWakeMs);
+			continue;
+		}
+		const RenderSnapshot &snapshot = renderSnapshots.readSlot();
+
+		preRender(snapshot.drawableWidth, snapshot.drawableHeight);
+
+		render(snapshot, snapshot.drawableWidth, snapshot.drawableHeight); // this should render the world state according to the snapshot -
+
+		if (fresh)
+			captureRenderedFrame(renderSnapshots.readSlot()); //only new sim ticks, so the video runs at game speed
+
+		postRender();
+		fenceFrame(framesInFlight, newInputCounterOf(snapshot));
+	}
+
+	destroyFramesInFlight(framesInFlight);
+	SDL_GL_MakeCurrent(win, nullptr); //hand the context back for cleanUp
+	return 0;
+}
+// end::renderThread[]
+
+// tag::simulationThread[]
+//fixed-rate simulation ticks, independent of how long rendering (or a swap) takes - each tick is run once
+//it is over in real time, so every input that happened during it has been queued, and is applied where it fell
+int simulationThreadMain(void *)
+{
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 ticksPerStep = (Uint64)(simTickLength * frequency);
+	Uint64 tickStart = SDL_GetPerformanceCounter();
+
+	while (!done)
+	{
+		const Uint64 tickEnd = tickStart + ticksPerStep;
+		Uint64 now = SDL_GetPerformanceCounter();
+		if (now < tickEnd)
+		{
+			SDL_Delay((Uint32)((tickEnd - now) * 1000 / frequency));
+			continue; //SDL_Delay rounds down - check again
+		}
+
+		applyInputEvents(tickStart, tickEnd);
+		updateSimulation(); // this should ONLY SET VARIABLES according to simulation
+		const bool changed = publishRenderSnapshot(); // hand the new state to the render thread
+
+		tickStart = tickEnd;
+		if (now - tickStart > frequency)
+			tickStart = now; //more than a second behind (e.g. a debugger break) - don't try to catch up
+
+		if (renderOnDemand && !changed && inputEvents.front() == nullptr)
+		{
+			//nothing moved, and nothing will until there is input - sleep until the input thread has some
+			simulationIdle = true;
+			SDL_SemWaitTimeout(simulationWake, idleWakeMs);
+			simulationIdle = false;
+			tickStart = SDL_GetPerformanceCounter(); //the input that woke us is applied at the start of the next tick
+		}
+	}
+	return 0;
+}
+// end::simulationThread[]
+
+// tag::runHeadless[]
+//no window - render `frames` sim ticks into an FBO, then save and/or check the last frame
+//returns the process exit code: 0 if the frame matched the golden image (or there was none to check)
+int runHeadless(int frames, const std::string &goldenPath, const std::string &savePath, int tolerance)
+{
+	if (SDL_Init(SDL_INIT_TIMER) != 0) { //no SDL video - there may be no display at all
+		cerr << "SDL_Init Error: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+
+	//the software renderer needs no context at all
+	HeadlessContext headless;
+	if (softwareRendering)
+	{
+		loadSoftwareAssets();
+	}
+	else
+	{
+		if (!createHeadlessContext(headless, 600, 600))
+		{
+			SDL_Quit();
+			return 1;
+		}
+		initGlew();
+		if (!createHeadlessFramebuffer(headless))
+		{
+			destroyHeadlessContext(headless);
+			SDL_Quit();
+			return 1;
+		}
+		loadAssets();
+	}
+	if (!capturePath.empty())
+		capturing = startVideoCapture(videoCapture, capturePath, 600, 600, (int)(1.0 / simTickLength + 0.5));
+
+	//same path as the render thread, minus the swap
+	const Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < frames; i++)
+	{
+		updateSimulation();
+		publishRenderSnapshot();
+		renderSnapshots.acquire();
+
+		if (softwareRendering)
+		{
+			renderSoftware(renderSnapshots.readSlot());
+		}
+		else
+		{
+			preRender(600, 600);
+			render(renderSnapshots.readSlot(), 600, 600); //always full resolution, so frames can be compared
+		}
+		captureRenderedFrame(renderSnapshots.readSlot());
+	}
+	if (!softwareRendering)
+		glFinish();
+	const double elapsedMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	cout << "Headless: rendered " << frames << " frames in " << elapsedMs << " ms ("
+	     << (frames > 0 ? elapsedMs / frames : 0.0) << " ms/frame)" << std::endl;
+
+	int result = 0;
+	const int width = 600;
+	const int height = 600;
+	std::vector<unsigned char> pixels = softwareRendering ? readSoftwareFrame(softwareRasterizer) : readHeadlessFrame(headless);
+	if (!savePath.empty() && saveFrameBMP(savePath, pixels, width, height))
+		cout << "Headless: saved frame to " << savePath << std::endl;
+	if (!goldenPath.empty())
+	{
+		const double maxMismatch = 0.001; //allow a few pixels of rasterisation differences between drivers
+		double mismatch = compareWithGolden(goldenPath, pixels, width, height, tolerance);
+		cout << "Headless: " << mismatch * 100.0 << "% of pixels differ from " << goldenPath << std::endl;
+		if (mismatch > maxMismatch)
+		{
+			cerr << "Headless: frame does not match the golden image." << std::endl;
+			result = 1;
+		}
+	}
+
+	if (capturing)
+		stopVideoCapture(videoCapture);
+	destroyModels();
+	if (softwareRendering)
+	{
+		destroySoftwareRasterizer(softwareRasterizer);
+	}
+	else
+	{
+		if (renderQueue.instanceStream)
+			destroyStreamBuffer(*renderQueue.instanceStream);
+		destroyLightClusterBuffers(lightClusters);
+		destroyShadowMap(shadowMap);
+		destroyRenderGraph(renderGraph);
+		destroyTextRenderer(textRenderer);
+		destroyHeadlessContext(headless);
+	}
+	TTF_Quit();
+	SDL_Quit();
+	return result;
+}
+// end::runHeadless[]
+
+#ifndef PONG_BENCHMARKS //the benchmarks link everything here but main() - see src/benchmarks
 // tag::main[]
 int main( int argc, char* args[] )
 {
 	exeName = args[0];
+
+	//command line options
+	int headlessFrames = -1; //-1: normal windowed game
+	std::string goldenPath;
+	std::string savePath;
+	int tolerance = 2;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = args[i];
+		if (arg == "--headless" && i + 1 < argc) headlessFrames = atoi(args[++i]);
+		else if (arg == "--golden" && i + 1 < argc) goldenPath = args[++i];
+		else if (arg == "--save-frame" && i + 1 < argc) savePath = args[++i];
+		else if (arg == "--tolerance" && i + 1 < argc) tolerance = atoi(args[++i]);
+		else if (arg == "--software") softwareRendering = true;
+		else if (arg == "--capture" && i + 1 < argc) capturePath = args[++i];
+		else if (arg == "--frame-budget" && i + 1 < argc) frameBudgetMs = (float)atof(args[++i]);
+		else if (arg == "--present" && i + 1 < argc)
+		{
+			PresentMode mode = PRESENT_VSYNC;
+			if (parsePresentMode(args[++i], mode))
+				requestedPresentMode = mode;
+			else
+				cerr << "Unknown present mode " << args[i] << " - use vsync, adaptive or uncapped" << std::endl;
+		}
+		else if (arg == "--fps-limit" && i + 1 < argc) frameLimit = atof(args[++i]);
+		else if (arg == "--frames-in-flight" && i + 1 < argc) maxFramesInFlight = atoi(args[++i]);
+		else if (arg == "--spectator") spectatorLayout = true;
+		else if (arg == "--on-demand") renderOnDemand = true;
+		else if (arg == "--lights" && i + 1 < argc) orbitLightCount = std::max(atoi(args[++i]), 0);
+		else cerr << "Ignoring unknown argument " << arg << std::endl;
+	}
+	if (headlessFrames >= 0)
+		return runHeadless(headlessFrames, goldenPath, savePath, tolerance);
+
 	//setup
 	//- do just once
 	initialise();
 	createWindow();
+	updateDrawableSize();
 
-	createContext();
-
-	initGlew();
+	if (softwareRendering)
+	{
+		loadSoftwareAssets(); //no GL at all - frames are drawn on the CPU and blitted to the window
+	}
+	else
+	{
+		createContext();
 
-	glViewport(0,0,600,600); //should check what the actual window res is?
+		initGlew();
 
-	SDL_GL_SwapWindow(win); //force a swap, to make the trace clearer
+		glViewport(0, 0, drawableWidth, drawableHeight);
 
-	//do stuff that only needs to happen once
-	//- create shaders
-	//- load vertex data
-	loadAssets();
+		SDL_GL_SwapWindow(win); //force a swap, to make the trace clearer
 
-	while (!done) //loop until done flag is set)
+		//do stuff that only needs to happen once
+		//- create shaders
+		//- load vertex data
+		loadAssets();
+		if (frameBudgetMs > 0.0f)
+			dynamicResolutionEnabled = createDynamicResolution(dynamicResolution, frameBudgetMs);
+	}
+	if (!capturePath.empty())
+		capturing = startVideoCapture(videoCapture, capturePath, 600, 600, (int)(1.0 / simTickLength + 0.5));
+	if (capturing && renderOnDemand)
 	{
-		handleInput(); // this should ONLY SET VARIABLES
-		updateSimulation(); // this should ONLY SET VARIABLES according to simulation
+		cout << "Rendering every frame while capturing - the video needs one per tick" << endl;
+		renderOnDemand = false;
+	}
+	if (renderOnDemand)
+	{
+		simulationWake = SDL_CreateSemaphore(0);
+		renderWake = SDL_CreateSemaphore(0);
+		if (simulationWake == nullptr || renderWake == nullptr)
+		{
+			cerr << "SDL_CreateSemaphore Error: " << SDL_GetError() << std::endl;
+			SDL_Quit();
+			exit(1);
+		}
+	}
 
-		preRender();
+	//one snapshot before the render thread starts, so it always has something to draw
+	updateSimulation();
+	publishRenderSnapshot();
 
-		render(); // this should render the world state according to VARIABLES -
+	//hand the GL context over to the render thread - this thread only runs input now
+	if (!softwareRendering)
+		SDL_GL_MakeCurrent(win, nullptr);
+	renderThread = SDL_CreateThread(renderThreadMain, "render", nullptr);
+	if (renderThread == nullptr)
+	{
+		cerr << "SDL_CreateThread Error: " << SDL_GetError() << std::endl;
+		SDL_Quit();
+		exit(1);
+	}
 
-		postRender();
+	simulationThread = SDL_CreateThread(simulationThreadMain, "simulation", nullptr);
+	if (simulationThread == nullptr)
+	{
+		cerr << "SDL_CreateThread Error: " << SDL_GetError() << std::endl;
+		done = true;
+		SDL_WaitThread(renderThread, nullptr);
+		SDL_Quit();
+		exit(1);
+	}
 
+	//this thread only samples input now - often, so every event is stamped close to when it happened
+	while (!done) //loop until done flag is set)
+	{
+		handleInput(); // this should ONLY QUEUE EVENTS
+		if (simulationIdle)
+			SDL_WaitEventTimeout(nullptr, idleWakeMs); //nothing is moving - sleep until there's an event
+		else
+			SDL_Delay(1);
 	}
 
+	wakeSimulation(); //so they see `done` now, rather than when they next time out
+	wakeRenderer();
+	SDL_WaitThread(simulationThread, nullptr);
+	SDL_WaitThread(renderThread, nullptr);
+	if (renderOnDemand)
+	{
+		SDL_DestroySemaphore(simulationWake);
+		SDL_DestroySemaphore(renderWake);
+		simulationWake = nullptr;
+		renderWake = nullptr;
+	}
+	const InputLatency &latency = softwareRendering ? softwareLatency : framesInFlight.latency;
+	if (latency.samples > 0)
+		cout << endl << "Input to present latency: " << latency.totalLatencyMs / latency.samples << " ms average, "
+		     << latency.maxLatencyMs << " ms worst, over " << latency.samples << " inputs" << std::endl;
+	if (!softwareRendering)
+		SDL_GL_MakeCurrent(win, context);
+	if (capturing)
+		stopVideoCapture(videoCapture); //collects the last readbacks, so needs the context back
+
 	//cleanup and exit
 	cleanUp();
 	SDL_Quit();
@@ -1783,3 +2884,4 @@ int main( int argc, char* args[] )
 	return 0;
 }
 // end::main[]
+#endif
@@ -0,0 +1,301 @@
+#include "meshCache.h"
+
+#include <iostream>
+#include <cstdio>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "shaderVariants.h"
+#include "vertexPacking.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::mapFile[]
+static bool mapFile(MappedFile &mapped, const std::string &filePath)
+{
+	mapped.data = nullptr;
+	mapped.size = 0;
+#ifdef _WIN32
+	mapped.mapping = nullptr;
+	mapped.file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mapped.file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	GetFileSizeEx(mapped.file, &size);
+	mapped.size = (size_t)size.QuadPart;
+	if (mapped.size > 0)
+		mapped.mapping = CreateFileMappingA(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapped.mapping)
+		mapped.data = MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	mapped.descriptor = open(filePath.c_str(), O_RDONLY);
+	if (mapped.descriptor < 0)
+		return false;
+	struct stat status;
+	fstat(mapped.descriptor, &status);
+	mapped.size = (size_t)status.st_size;
+	if (mapped.size > 0)
+	{
+		void *data = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, mapped.descriptor, 0);
+		mapped.data = (data == MAP_FAILED) ? nullptr : data;
+	}
+#endif
+	return mapped.data != nullptr;
+}
+
+static void unmapFile(MappedFile &mapped)
+{
+#ifdef _WIN32
+	if (mapped.data)
+		UnmapViewOfFile(mapped.data);
+	if (mapped.mapping)
+		CloseHandle(mapped.mapping);
+	if (mapped.file != INVALID_HANDLE_VALUE)
+		CloseHandle(mapped.file);
+	mapped.mapping = nullptr;
+	mapped.file = INVALID_HANDLE_VALUE;
+#else
+	if (mapped.data)
+		munmap((void *)mapped.data, mapped.size);
+	if (mapped.descriptor >= 0)
+		close(mapped.descriptor);
+	mapped.descriptor = -1;
+#endif
+	mapped.data = nullptr;
+	mapped.size = 0;
+}
+// end::mapFile[]
+
+// tag::importModel[]
+static bool fileStatus(const std::string &filePath, uint64_t &size, int64_t &time)
+{
+	struct stat status;
+	if (stat(filePath.c_str(), &status) != 0)
+		return false;
+	size = (uint64_t)status.st_size;
+	time = (int64_t)status.st_mtime;
+	return true;
+}
+
+//the slow path - parse the model with Assimp, flatten it into one indexed mesh, and write the cache
+static bool importModel(const std::string &modelPath, const std::string &cachePath)
+{
+	//FlipUVs: our textures are uploaded first row first, so v = 0 is the top of the image
+	Assimp::Importer importer;
+	const aiScene *scene = importer.ReadFile(modelPath,
+		aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_PreTransformVertices | aiProcess_FlipUVs
+		| aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality);
+	if (scene == nullptr)
+	{
+		cerr << "Model could not be imported from " << modelPath << ": " << importer.GetErrorString() << endl;
+		return false;
+	}
+
+	//PreTransformVertices has already baked the node transforms in, so the meshes can simply be appended
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	for (unsigned m = 0; m < scene->mNumMeshes; m++)
+	{
+		const aiMesh *mesh = scene->mMeshes[m];
+		if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE))
+			continue; //points and lines
+		const uint32_t base = (uint32_t)vertices.size();
+		for (unsigned v = 0; v < mesh->mNumVertices; v++)
+		{
+			MeshVertex vertex;
+			vertex.position[0] = mesh->mVertices[v].x;
+			vertex.position[1] = mesh->mVertices[v].y;
+			vertex.position[2] = mesh->mVertices[v].z;
+			vertex.normal[0] = mesh->mNormals ? mesh->mNormals[v].x : 0.0f;
+			vertex.normal[1] = mesh->mNormals ? mesh->mNormals[v].y : 0.0f;
+			vertex.normal[2] = mesh->mNormals ? mesh->mNormals[v].z : 1.0f;
+			vertex.uv[0] = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][v].x : 0.0f;
+			vertex.uv[1] = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][v].y : 0.0f;
+			vertices.push_back(vertex);
+		}
+		for (unsigned f = 0; f < mesh->mNumFaces; f++)
+		{
+			const aiFace &face = mesh->mFaces[f];
+			if (face.mNumIndices != 3)
+				continue;
+			for (int i = 0; i < 3; i++)
+				indices.push_back(base + face.mIndices[i]);
+		}
+	}
+	if (indices.empty())
+	{
+		cerr << "Model " << modelPath << " has no triangles." << endl;
+		return false;
+	}
+
+	MeshCacheHeader header;
+	header.magic = meshCacheMagic;
+	header.version = meshCacheVersion;
+	fileStatus(modelPath, header.sourceSize, header.sourceTime);
+	header.vertexCount = (uint32_t)vertices.size();
+	header.indexCount = (uint32_t)indices.size();
+	header.bounds = boundingSphereOf(boundingBoxOf(vertices[0].position, vertices.size(), sizeof(MeshVertex) / sizeof(float)));
+
+	FILE *file = fopen(cachePath.c_str(), "wb");
+	if (file == nullptr)
+	{
+		cerr << "Mesh cache could not be written to " << cachePath << endl;
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1
+	            && fwrite(vertices.data(), sizeof(MeshVertex), vertices.size(), file) == vertices.size()
+	            && fwrite(indices.data(), sizeof(uint32_t), indices.size(), file) == indices.size();
+	written = (fclose(file) == 0) && written;
+	if (!written)
+	{
+		cerr << "Mesh cache could not be written to " << cachePath << endl;
+		remove(cachePath.c_str());
+		return false;
+	}
+	cout << "Imported " << modelPath << " (" << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles) OK!" << endl;
+	return true;
+}
+// end::importModel[]
+
+// tag::loadModelMesh[]
+//map the cache, and check it is complete and (if the model is there to compare with) up to date
+static bool mapCache(ModelMesh &mesh, const std::string &cachePath, bool haveModel, uint64_t modelSize, int64_t modelTime)
+{
+	if (!mapFile(mesh.file, cachePath))
+	{
+		unmapFile(mesh.file);
+		return false;
+	}
+	const MeshCacheHeader *header = (const MeshCacheHeader *)mesh.file.data;
+	bool valid = mesh.file.size >= sizeof(MeshCacheHeader) && header->magic == meshCacheMagic && header->version == meshCacheVersion
+	          && mesh.file.size == sizeof(MeshCacheHeader) + header->vertexCount * sizeof(MeshVertex) + header->indexCount * sizeof(uint32_t);
+	if (valid && haveModel)
+		valid = header->sourceSize == modelSize && header->sourceTime == modelTime;
+	if (!valid)
+	{
+		unmapFile(mesh.file);
+		return false;
+	}
+
+	mesh.header = header;
+	mesh.vertices = (const MeshVertex *)(header + 1);
+	mesh.indices = (const uint32_t *)(mesh.vertices + header->vertexCount);
+	mesh.indexCount = header->indexCount;
+	mesh.bounds = header->bounds;
+	return true;
+}
+
+bool loadModelMesh(ModelMesh &mesh, const std::string &basePath)
+{
+	mesh.header = nullptr;
+	mesh.vertices = nullptr;
+	mesh.indices = nullptr;
+	mesh.indexCount = 0;
+	mesh.vertexBuffer = 0;
+	mesh.indexBuffer = 0;
+	mesh.vertexArrayObject = 0;
+
+	const char *extensions[] = { ".obj", ".fbx", ".gltf", ".glb" };
+	for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+	{
+		const std::string modelPath = basePath + extensions[i];
+		const std::string cachePath = modelPath + ".meshcache";
+		uint64_t modelSize = 0;
+		int64_t modelTime = 0;
+		const bool haveModel = fileStatus(modelPath, modelSize, modelTime);
+
+		//the fast path - no parsing at all, the file is used where it lies
+		if (mapCache(mesh, cachePath, haveModel, modelSize, modelTime))
+		{
+			cout << "Model " << cachePath << " mapped OK!" << endl;
+			return true;
+		}
+		if (haveModel)
+			return importModel(modelPath, cachePath) && mapCache(mesh, cachePath, true, modelSize, modelTime);
+	}
+	return false;
+}
+// end::loadModelMesh[]
+
+// tag::uploadModelMesh[]
+//what the GPU reads instead of a MeshVertex - half the size. The cache keeps floats, for the software renderer
+struct PackedMeshVertex
+{
+	PackedHalfPosition position;
+	PackedNormal normal;
+	PackedTextureCoordinate uv;
+};
+
+void uploadModelMesh(ModelMesh &mesh)
+{
+	//packed from the mapping - the pages are read in as they're packed
+	std::vector<PackedMeshVertex> packed(mesh.header->vertexCount);
+	for (uint32_t i = 0; i < mesh.header->vertexCount; i++)
+	{
+		const MeshVertex &vertex = mesh.vertices[i];
+		packed[i].position = packHalfPosition(glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]));
+		packed[i].normal = packNormal(glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]));
+		packed[i].uv = packTextureCoordinate(glm::vec2(vertex.uv[0], vertex.uv[1]));
+	}
+	glGenBuffers(1, &mesh.vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedMeshVertex), packed.data(), GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &mesh.vertexArrayObject);
+	glBindVertexArray(mesh.vertexArrayObject);
+	glGenBuffers(1, &mesh.indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer); //recorded in the VAO
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.header->indexCount * sizeof(uint32_t), mesh.indices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(positionLocation);
+	packedHalfPositionPointer(positionLocation, sizeof(PackedMeshVertex), offsetof(PackedMeshVertex, position));
+	glEnableVertexAttribArray(normalLocation); //vertexColor stays disabled - models are lit with the default colour
+	packedNormalPointer(normalLocation, sizeof(PackedMeshVertex), offsetof(PackedMeshVertex, normal));
+	glEnableVertexAttribArray(textureLocation);
+	packedTextureCoordinatePointer(textureLocation, sizeof(PackedMeshVertex), offsetof(PackedMeshVertex, uv));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void unmapModelMesh(ModelMesh &mesh)
+{
+	if (mesh.header)
+		unmapFile(mesh.file);
+	mesh.header = nullptr;
+	mesh.vertices = nullptr;
+	mesh.indices = nullptr;
+}
+
+void destroyModelMesh(ModelMesh &mesh)
+{
+	unmapModelMesh(mesh);
+	if (mesh.vertexArrayObject)
+	{
+		glDeleteVertexArrays(1, &mesh.vertexArrayObject);
+		glDeleteBuffers(1, &mesh.vertexBuffer);
+		glDeleteBuffers(1, &mesh.indexBuffer);
+	}
+	mesh.vertexArrayObject = 0;
+	mesh.vertexBuffer = 0;
+	mesh.indexBuffer = 0;
+	mesh.indexCount = 0;
+}
+// end::uploadModelMesh[]
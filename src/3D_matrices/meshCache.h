@@ -0,0 +1,83 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "frustumCulling.h"
+
+// tag::meshCacheFormat[]
+const uint32_t meshCacheMagic = 0x48534d50; //"PMSH"
+const uint32_t meshCacheVersion = 1;
+
+//interleaved - normals feed the normal attribute. uploadModelMesh packs it smaller for the GPU (see vertexPacking.h)
+struct MeshVertex
+{
+	float position[3];
+	float normal[3];
+	float uv[2];
+};
+
+//a .meshcache file is this header, then vertexCount MeshVertex, then indexCount uint32_t indices
+//native-endian and unpadded - it is a cache, rebuilt wherever it doesn't match, not an interchange format
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceSize; //of the model file the cache was built from - if either differs, it is rebuilt
+	int64_t sourceTime;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	BoundingSphere bounds; //local space, so culling doesn't need to touch the vertices
+};
+// end::meshCacheFormat[]
+
+// tag::modelMesh[]
+//a read-only view of a whole file, valid until unmapFile
+struct MappedFile
+{
+	const void *data;
+	size_t size;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int descriptor;
+#endif
+};
+
+//an imported model - the CPU data points straight into the mapped cache file
+struct ModelMesh
+{
+	MappedFile file;
+	const MeshCacheHeader *header; //nullptr when not mapped
+	const MeshVertex *vertices;
+	const uint32_t *indices;
+
+	uint32_t indexCount; //0 if nothing was loaded - kept, like bounds, after the mapping is released
+	BoundingSphere bounds;
+
+	GLuint vertexBuffer; //0 until uploadModelMesh
+	GLuint indexBuffer;
+	GLuint vertexArrayObject;
+};
+
+//load `basePath` plus the first of .obj, .fbx, .gltf or .glb that exists, through its .meshcache file
+//the cache is (re)built with Assimp if it is missing or older than the model - if there is only a
+//cache (the model file isn't shipped), the cache is used as it is. Returns false if there is neither
+bool loadModelMesh(ModelMesh &mesh, const std::string &basePath);
+
+//copy the mapped data into a VAO with a vertex and an element buffer - the mapping can be released after
+void uploadModelMesh(ModelMesh &mesh);
+
+//release the mapping (the GL buffers stay)
+void unmapModelMesh(ModelMesh &mesh);
+
+//release the mapping and the GL buffers
+void destroyModelMesh(ModelMesh &mesh);
+// end::modelMesh[]
+
+#endif
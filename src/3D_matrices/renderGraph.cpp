@@ -0,0 +1,417 @@
+#include "renderGraph.h"
+
+#include <iostream>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+const int poolRetainFrames = 30; //a pooled texture nobody has asked for in this many frames is deleted
+
+// tag::graphTextureFormats[]
+static bool isDepthFormat(GLenum internalFormat)
+{
+	return internalFormat == GL_DEPTH_COMPONENT24;
+}
+
+//the upload format and type glTexImage2D needs for an internal format, and roughly what it costs per texel
+static void textureFormatOf(GLenum internalFormat, GLenum &format, GLenum &type, size_t &texelBytes)
+{
+	switch (internalFormat)
+	{
+	case GL_RGBA16F: format = GL_RGBA; type = GL_HALF_FLOAT; texelBytes = 8; break;
+	case GL_R8: format = GL_RED; type = GL_UNSIGNED_BYTE; texelBytes = 1; break;
+	case GL_DEPTH_COMPONENT24: format = GL_DEPTH_COMPONENT; type = GL_UNSIGNED_INT; texelBytes = 4; break; //padded to 32 bits
+	default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; texelBytes = 4; break; //GL_RGBA8
+	}
+}
+
+static size_t bytesOf(const RenderGraphTextureDesc &desc)
+{
+	GLenum format, type;
+	size_t texelBytes;
+	textureFormatOf(desc.internalFormat, format, type, texelBytes);
+	return (size_t)desc.width * (size_t)desc.height * texelBytes;
+}
+
+static bool sameDesc(const RenderGraphTextureDesc &a, const RenderGraphTextureDesc &b)
+{
+	return a.width == b.width && a.height == b.height && a.internalFormat == b.internalFormat;
+}
+
+static GLuint createPoolTexture(const RenderGraphTextureDesc &desc)
+{
+	GLenum format, type;
+	size_t texelBytes;
+	textureFormatOf(desc.internalFormat, format, type, texelBytes);
+
+	//no mipmaps, so the default minification filter would leave it incomplete
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+//the texture and every framebuffer it is attached to
+static void deletePoolTexture(RenderGraph &graph, size_t index)
+{
+	const GLuint texture = graph.pool[index].texture;
+	for (size_t i = 0; i < graph.framebuffers.size(); )
+	{
+		std::vector<GLuint> &attachments = graph.framebuffers[i].attachments;
+		if (std::find(attachments.begin(), attachments.end(), texture) != attachments.end())
+		{
+			glDeleteFramebuffers(1, &graph.framebuffers[i].framebuffer);
+			graph.framebuffers.erase(graph.framebuffers.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+	glDeleteTextures(1, &texture);
+	graph.pool.erase(graph.pool.begin() + index);
+}
+// end::graphTextureFormats[]
+
+// tag::declareRenderGraph[]
+void beginRenderGraph(RenderGraph &graph, GLuint backbuffer)
+{
+	graph.backbuffer = backbuffer;
+	graph.textures.clear();
+	graph.passes.clear();
+	graph.order.clear();
+
+	RenderGraphTexture backbufferTexture = { "backbuffer", { 0, 0, 0 }, -1, -1, -1 };
+	graph.textures.push_back(backbufferTexture);
+}
+
+RenderGraphHandle createGraphTexture(RenderGraph &graph, const std::string &name, const RenderGraphTextureDesc &desc)
+{
+	RenderGraphTexture texture = { name, desc, -1, -1, -1 };
+	graph.textures.push_back(texture);
+	return (RenderGraphHandle)graph.textures.size() - 1;
+}
+
+void addGraphPass(RenderGraph &graph, const std::string &name, const std::vector<RenderGraphHandle> &reads,
+                  const std::vector<RenderGraphHandle> &writes, const RenderGraphExecute &execute)
+{
+	RenderGraphPass pass;
+	pass.name = name;
+	pass.reads = reads;
+	pass.writes = writes;
+	pass.execute = execute;
+	pass.culled = false;
+	pass.framebuffer = 0;
+	graph.passes.push_back(pass);
+}
+// end::declareRenderGraph[]
+
+// tag::compileRenderGraph[]
+static bool writesBackbuffer(const RenderGraphPass &pass)
+{
+	return std::find(pass.writes.begin(), pass.writes.end(), graphBackbuffer) != pass.writes.end();
+}
+
+//reference counting from the backbuffer back - a pass is kept if something it writes is read by a pass that is kept
+static void cullPasses(RenderGraph &graph)
+{
+	const size_t passCount = graph.passes.size();
+	std::vector<int> passRefs(passCount, 0);
+	std::vector<int> textureRefs(graph.textures.size(), 0);
+	for (size_t p = 0; p < passCount; p++)
+	{
+		passRefs[p] = (int)graph.passes[p].writes.size();
+		for (RenderGraphHandle read : graph.passes[p].reads)
+			textureRefs[read]++;
+	}
+
+	std::vector<RenderGraphHandle> unread;
+	for (size_t t = 1; t < graph.textures.size(); t++)
+		if (textureRefs[t] == 0)
+			unread.push_back((RenderGraphHandle)t);
+	auto cull = [&](size_t p) {
+		graph.passes[p].culled = true;
+		for (RenderGraphHandle read : graph.passes[p].reads)
+			if (--textureRefs[read] == 0 && read != graphBackbuffer)
+				unread.push_back(read);
+	};
+	for (size_t p = 0; p < passCount; p++)
+		if (passRefs[p] == 0 && !writesBackbuffer(graph.passes[p]))
+			cull(p);
+
+	while (!unread.empty())
+	{
+		RenderGraphHandle texture = unread.back();
+		unread.pop_back();
+		for (size_t p = 0; p < passCount; p++)
+		{
+			RenderGraphPass &pass = graph.passes[p];
+			if (pass.culled || std::find(pass.writes.begin(), pass.writes.end(), texture) == pass.writes.end())
+				continue;
+			if (--passRefs[p] == 0 && !writesBackbuffer(pass))
+				cull(p);
+		}
+	}
+}
+
+//a pass runs after every pass that writes what it reads, and after earlier passes that write what it writes
+//(so passes drawing over the same target keep the order they were declared in) - ties go by declaration order
+static void orderPasses(RenderGraph &graph)
+{
+	const size_t passCount = graph.passes.size();
+	std::vector<std::vector<int> > successors(passCount);
+	std::vector<int> predecessorCount(passCount, 0);
+	auto writes = [&](size_t p, RenderGraphHandle texture) {
+		return std::find(graph.passes[p].writes.begin(), graph.passes[p].writes.end(), texture) != graph.passes[p].writes.end();
+	};
+	for (size_t b = 0; b < passCount; b++)
+	{
+		if (graph.passes[b].culled)
+			continue;
+		for (size_t a = 0; a < passCount; a++)
+		{
+			if (a == b || graph.passes[a].culled)
+				continue;
+			bool dependsOn = false;
+			for (RenderGraphHandle read : graph.passes[b].reads)
+				dependsOn = dependsOn || writes(a, read);
+			for (RenderGraphHandle write : graph.passes[b].writes)
+				dependsOn = dependsOn || (a < b && writes(a, write));
+			if (dependsOn)
+			{
+				successors[a].push_back((int)b);
+				predecessorCount[b]++;
+			}
+		}
+	}
+
+	graph.order.clear();
+	std::vector<bool> done(passCount, false);
+	for (;;)
+	{
+		int next = -1;
+		for (size_t p = 0; p < passCount && next < 0; p++)
+			if (!graph.passes[p].culled && !done[p] && predecessorCount[p] == 0)
+				next = (int)p;
+		if (next < 0)
+			break;
+		done[next] = true;
+		graph.order.push_back(next);
+		for (int successor : successors[next])
+			predecessorCount[successor]--;
+	}
+
+	//a cycle - run what's left as declared, rather than not at all
+	for (size_t p = 0; p < passCount; p++)
+	{
+		if (!graph.passes[p].culled && !done[p])
+		{
+			cerr << "Render graph: pass " << graph.passes[p].name << " is part of a dependency cycle." << endl;
+			graph.order.push_back((int)p);
+		}
+	}
+}
+
+//hand each transient a pooled texture for [firstUse, lastUse] - one that is already free by then if there is
+//one with the same description, so transients that don't overlap share memory
+static void allocateTextures(RenderGraph &graph)
+{
+	for (size_t i = 0; i < graph.pool.size(); )
+	{
+		if (graph.pool[i].unusedFrames > poolRetainFrames)
+			deletePoolTexture(graph, i);
+		else
+			graph.pool[i++].busyUntil = -1;
+	}
+	std::vector<bool> usedThisFrame(graph.pool.size(), false);
+
+	for (size_t position = 0; position < graph.order.size(); position++)
+	{
+		const RenderGraphPass &pass = graph.passes[graph.order[position]];
+		std::vector<RenderGraphHandle> uses(pass.reads);
+		uses.insert(uses.end(), pass.writes.begin(), pass.writes.end());
+		for (RenderGraphHandle handle : uses)
+		{
+			RenderGraphTexture &texture = graph.textures[handle];
+			if (handle == graphBackbuffer)
+				continue;
+			if (texture.firstUse < 0)
+				texture.firstUse = (int)position;
+			texture.lastUse = (int)position;
+		}
+	}
+
+	size_t allocatedBytes = 0;
+	for (size_t position = 0; position < graph.order.size(); position++)
+	{
+		for (size_t t = 1; t < graph.textures.size(); t++)
+		{
+			RenderGraphTexture &texture = graph.textures[t];
+			if (texture.firstUse != (int)position)
+				continue;
+			int chosen = -1;
+			for (size_t i = 0; i < graph.pool.size() && chosen < 0; i++)
+				if (graph.pool[i].busyUntil < (int)position && sameDesc(graph.pool[i].desc, texture.desc))
+					chosen = (int)i;
+			if (chosen < 0)
+			{
+				PooledTexture pooled = { texture.desc, createPoolTexture(texture.desc), -1, 0 };
+				graph.pool.push_back(pooled);
+				usedThisFrame.push_back(false);
+				chosen = (int)graph.pool.size() - 1;
+				allocatedBytes += bytesOf(texture.desc);
+			}
+			graph.pool[chosen].busyUntil = texture.lastUse;
+			usedThisFrame[chosen] = true;
+			texture.pooled = chosen;
+		}
+	}
+	if (allocatedBytes > 0)
+		cout << "Render graph: allocated " << allocatedBytes / 1024 << " KB of render targets OK!" << endl;
+
+	for (size_t i = 0; i < graph.pool.size(); i++)
+		graph.pool[i].unusedFrames = usedThisFrame[i] ? 0 : graph.pool[i].unusedFrames + 1;
+}
+
+static void measureMemory(RenderGraph &graph)
+{
+	RenderGraphStats &stats = graph.stats;
+	stats.passes = (int)graph.passes.size();
+	stats.culledPasses = stats.passes - (int)graph.order.size();
+	stats.transientTextures = 0;
+	stats.pooledTextures = 0;
+	stats.peakBytes = 0;
+	stats.unaliasedBytes = 0;
+	stats.pooledBytes = 0;
+
+	//transients sharing a texture never overlap, so what is live at each point is just the sum over transients
+	std::vector<size_t> liveBytes(graph.order.size(), 0);
+	for (size_t t = 1; t < graph.textures.size(); t++)
+	{
+		const RenderGraphTexture &texture = graph.textures[t];
+		if (texture.pooled < 0)
+			continue;
+		const size_t bytes = bytesOf(texture.desc);
+		stats.transientTextures++;
+		stats.unaliasedBytes += bytes;
+		for (int position = texture.firstUse; position <= texture.lastUse; position++)
+			liveBytes[position] += bytes;
+	}
+	for (size_t position = 0; position < liveBytes.size(); position++)
+		stats.peakBytes = std::max(stats.peakBytes, liveBytes[position]);
+	for (size_t i = 0; i < graph.pool.size(); i++)
+	{
+		stats.pooledBytes += bytesOf(graph.pool[i].desc);
+		if (graph.pool[i].unusedFrames == 0)
+			stats.pooledTextures++;
+	}
+}
+
+void compileRenderGraph(RenderGraph &graph)
+{
+	cullPasses(graph);
+	orderPasses(graph);
+	allocateTextures(graph);
+	measureMemory(graph);
+}
+// end::compileRenderGraph[]
+
+// tag::executeRenderGraph[]
+GLuint graphTexture(const RenderGraph &graph, RenderGraphHandle handle)
+{
+	const RenderGraphTexture &texture = graph.textures[handle];
+	return texture.pooled >= 0 ? graph.pool[texture.pooled].texture : 0;
+}
+
+GLuint graphFramebuffer(RenderGraph &graph, const std::vector<RenderGraphHandle> &targets)
+{
+	std::vector<GLuint> attachments;
+	for (RenderGraphHandle target : targets)
+		if (target != graphBackbuffer)
+			attachments.push_back(graphTexture(graph, target));
+	if (attachments.empty())
+		return graph.backbuffer;
+
+	for (size_t i = 0; i < graph.framebuffers.size(); i++)
+		if (graph.framebuffers[i].attachments == attachments)
+			return graph.framebuffers[i].framebuffer;
+
+	//first time this set is drawn into - leave the bindings as they were
+	GLint previousDrawFramebuffer = 0;
+	GLint previousReadFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDrawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+
+	GraphFramebuffer created;
+	created.attachments = attachments;
+	glGenFramebuffers(1, &created.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, created.framebuffer);
+	std::vector<GLenum> drawBuffers;
+	for (RenderGraphHandle target : targets)
+	{
+		if (target == graphBackbuffer)
+			continue;
+		const GLuint texture = graphTexture(graph, target);
+		if (isDepthFormat(graph.textures[target].desc.internalFormat))
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+		}
+		else
+		{
+			const GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+			drawBuffers.push_back(attachment);
+		}
+	}
+	if (drawBuffers.empty())
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+	else
+	{
+		glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+	}
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		cerr << "Render graph: framebuffer for " << graph.textures[targets[0]].name << " is incomplete." << endl;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDrawFramebuffer);
+
+	graph.framebuffers.push_back(created);
+	return created.framebuffer;
+}
+
+void executeRenderGraph(RenderGraph &graph)
+{
+	for (size_t position = 0; position < graph.order.size(); position++)
+	{
+		RenderGraphPass &pass = graph.passes[graph.order[position]];
+		pass.framebuffer = graphFramebuffer(graph, pass.writes);
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		pass.execute(graph, pass);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, graph.backbuffer);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void destroyRenderGraph(RenderGraph &graph)
+{
+	while (!graph.pool.empty())
+		deletePoolTexture(graph, graph.pool.size() - 1);
+	for (size_t i = 0; i < graph.framebuffers.size(); i++)
+		glDeleteFramebuffers(1, &graph.framebuffers[i].framebuffer);
+	graph.framebuffers.clear();
+	graph.textures.clear();
+	graph.passes.clear();
+	graph.order.clear();
+}
+// end::executeRenderGraph[]
@@ -0,0 +1,113 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <GL/glew.h>
+
+// tag::renderGraphResources[]
+//a texture a pass reads or writes - transient ones only exist (in a pooled GL texture) from the first pass
+//that uses them to the last, so two with the same description and no overlap can share one texture
+typedef int RenderGraphHandle;
+const RenderGraphHandle graphBackbuffer = 0; //whatever framebuffer was bound when the graph began - always there
+
+struct RenderGraphTextureDesc
+{
+	int width;
+	int height;
+	GLenum internalFormat; //GL_RGBA8, GL_RGBA16F, GL_R8 or GL_DEPTH_COMPONENT24
+};
+
+struct RenderGraphTexture
+{
+	std::string name;
+	RenderGraphTextureDesc desc;
+	int firstUse; //positions in the execution order, -1 if no pass that survived culling uses it
+	int lastUse;
+	int pooled; //index into RenderGraph::pool once allocated, -1 before
+};
+
+//a GL texture kept across frames - handed to whichever transient fits it and is free at the time
+struct PooledTexture
+{
+	RenderGraphTextureDesc desc;
+	GLuint texture;
+	int busyUntil; //execution position of its current holder's last use this frame, -1 if free
+	int unusedFrames; //deleted after a while without being handed out
+};
+
+//framebuffers for the attachment sets passes write, created on first use
+struct GraphFramebuffer
+{
+	std::vector<GLuint> attachments;
+	GLuint framebuffer;
+};
+// end::renderGraphResources[]
+
+// tag::renderGraphPass[]
+struct RenderGraph;
+struct RenderGraphPass;
+typedef std::function<void(RenderGraph &graph, const RenderGraphPass &pass)> RenderGraphExecute;
+
+struct RenderGraphPass
+{
+	std::string name;
+	std::vector<RenderGraphHandle> reads;
+	std::vector<RenderGraphHandle> writes; //colour and depth targets (or graphBackbuffer, on its own)
+	RenderGraphExecute execute; //called with the writes bound as the draw framebuffer
+	bool culled; //nothing that reaches the backbuffer depends on it
+	GLuint framebuffer; //the draw framebuffer, while execute runs
+};
+
+struct RenderGraphStats
+{
+	int passes; //declared this frame
+	int culledPasses;
+	int transientTextures; //used this frame
+	int pooledTextures; //GL textures behind them
+	size_t peakBytes; //most transient memory in use at any point in the frame
+	size_t unaliasedBytes; //what it would be with a texture per transient
+	size_t pooledBytes; //everything the pool holds, including what this frame didn't need
+};
+
+//rebuilt every frame - passes are declared in the order they should run, then compiled and executed
+struct RenderGraph
+{
+	GLuint backbuffer;
+	std::vector<RenderGraphTexture> textures; //graphBackbuffer first
+	std::vector<RenderGraphPass> passes;
+	std::vector<int> order; //indices into passes, in execution order, culled passes left out
+	std::vector<PooledTexture> pool;
+	std::vector<GraphFramebuffer> framebuffers;
+	RenderGraphStats stats;
+};
+// end::renderGraphPass[]
+
+// tag::renderGraphFunctions[]
+//start a frame's graph - the pool and framebuffers carry over, the passes and textures don't
+void beginRenderGraph(RenderGraph &graph, GLuint backbuffer);
+
+RenderGraphHandle createGraphTexture(RenderGraph &graph, const std::string &name, const RenderGraphTextureDesc &desc);
+void addGraphPass(RenderGraph &graph, const std::string &name, const std::vector<RenderGraphHandle> &reads,
+                  const std::vector<RenderGraphHandle> &writes, const RenderGraphExecute &execute);
+
+//cull passes that don't contribute to the backbuffer, order the rest by their dependencies,
+//work out each transient's lifetime, and hand out pooled textures - aliasing those that don't overlap
+void compileRenderGraph(RenderGraph &graph);
+
+//run the passes in order - GL_TEXTURE0 is left active, and the backbuffer bound
+void executeRenderGraph(RenderGraph &graph);
+
+//the GL texture behind a transient - only valid during executeRenderGraph
+GLuint graphTexture(const RenderGraph &graph, RenderGraphHandle handle);
+
+//a framebuffer with these targets attached (e.g. to blit from) - only valid during executeRenderGraph
+GLuint graphFramebuffer(RenderGraph &graph, const std::vector<RenderGraphHandle> &targets);
+
+void destroyRenderGraph(RenderGraph &graph);
+// end::renderGraphFunctions[]
+
+#endif
@@ -0,0 +1,243 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+
+// tag::makeSortKey[]
+uint64_t makeSortKey(RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject, float depth01)
+{
+	depth01 = std::min(std::max(depth01, 0.0f), 1.0f);
+	uint64_t depthBits = (uint64_t)(depth01 * (float)((1 << 20) - 1));
+
+	//GL names are small integers, so the low bits identify them. If two ever collide they
+	//only sort next to each other - executeRenderQueue compares the real names before binding
+	return ((uint64_t)(pass & 0xF) << 60)
+	     | ((uint64_t)(shaderFeatures & 0xFF) << 52)
+	     | ((uint64_t)(texture & 0xFFFF) << 36)
+	     | ((uint64_t)(vertexArrayObject & 0xFFFF) << 20)
+	     | depthBits;
+}
+// end::makeSortKey[]
+
+void clearRenderQueue(RenderQueue &queue)
+{
+	queue.commands.clear();
+}
+
+// tag::submitDraw[]
+void submitDraw(RenderQueue &queue, RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject,
+                GLint first, GLsizei count, const ObjectParameters &object, float viewDepth)
+{
+	float depth01 = 0.0f;
+	if (queue.farPlane > queue.nearPlane)
+		depth01 = (viewDepth - queue.nearPlane) / (queue.farPlane - queue.nearPlane);
+
+	DrawCommand command;
+	command.key = makeSortKey(pass, shaderFeatures, texture, vertexArrayObject, depth01);
+	command.shaderFeatures = shaderFeatures;
+	command.texture = texture;
+	command.vertexArrayObject = vertexArrayObject;
+	command.indexed = false;
+	command.first = first;
+	command.count = count;
+	command.object = object;
+	queue.commands.push_back(command);
+}
+
+void submitIndexedDraw(RenderQueue &queue, RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject,
+                       GLint first, GLsizei count, const ObjectParameters &object, float viewDepth)
+{
+	submitDraw(queue, pass, shaderFeatures, texture, vertexArrayObject, first, count, object, viewDepth);
+	queue.commands.back().indexed = true;
+}
+// end::submitDraw[]
+
+// tag::sortRenderQueue[]
+void sortRenderQueue(RenderQueue &queue)
+{
+	const size_t count = queue.commands.size();
+	queue.keys.resize(count);
+	queue.keysScratch.resize(count);
+	queue.order.resize(count);
+	queue.orderScratch.resize(count);
+
+	uint64_t allOr = 0;
+	uint64_t allAnd = ~(uint64_t)0;
+	for (size_t i = 0; i < count; i++)
+	{
+		queue.keys[i] = queue.commands[i].key;
+		queue.order[i] = (uint32_t)i;
+		allOr |= queue.keys[i];
+		allAnd &= queue.keys[i];
+	}
+	const uint64_t varyingBits = allOr ^ allAnd; //bits that differ between at least two keys
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		if (((varyingBits >> shift) & 0xFF) == 0)
+			continue; //every key has the same byte here - this pass wouldn't move anything
+
+		size_t offsets[256] = { 0 };
+		for (size_t i = 0; i < count; i++)
+			offsets[(queue.keys[i] >> shift) & 0xFF]++;
+
+		size_t total = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			size_t bucketCount = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t destination = offsets[(queue.keys[i] >> shift) & 0xFF]++;
+			queue.keysScratch[destination] = queue.keys[i];
+			queue.orderScratch[destination] = queue.order[i];
+		}
+		queue.keys.swap(queue.keysScratch);
+		queue.order.swap(queue.orderScratch);
+	}
+}
+// end::sortRenderQueue[]
+
+// tag::executeRenderQueue[]
+static void applyPassState(RenderPass pass)
+{
+	if (pass == PASS_HUD)
+		glDisable(GL_DEPTH_TEST);
+	else
+		glEnable(GL_DEPTH_TEST);
+}
+
+//can b be drawn as another instance of a?
+static bool sameDrawState(const DrawCommand &a, const DrawCommand &b)
+{
+	return (a.key >> 60) == (b.key >> 60) && a.shaderFeatures == b.shaderFeatures && a.texture == b.texture
+	    && a.vertexArrayObject == b.vertexArrayObject && a.indexed == b.indexed && a.first == b.first && a.count == b.count;
+}
+
+//a run of sorted commands, drawn with one call
+struct DrawBatch
+{
+	size_t begin; //into queue.order
+	size_t count;
+	GLintptr instanceOffset; //where the instance matrices are in the stream buffer, -1 if not instanced
+};
+
+void executeRenderQueue(RenderQueue &queue, const ShaderVariant *variants)
+{
+	RenderQueueStats stats = { 0, 0, 0, 0, 0 };
+
+	//group the sorted draws into batches, and write instance matrices for the runs
+	std::vector<DrawBatch> batches;
+	for (size_t i = 0; i < queue.order.size();)
+	{
+		const DrawCommand &first = queue.commands[queue.order[i]];
+		size_t runLength = 1;
+		while (i + runLength < queue.order.size() && sameDrawState(first, queue.commands[queue.order[i + runLength]]))
+			runLength++;
+
+		DrawBatch batch = { i, 1, -1 };
+		if (runLength > 1 && queue.instanceStream && !(first.shaderFeatures & SHADER_INSTANCED))
+		{
+			GLintptr offset;
+			glm::mat4 *instances = (glm::mat4 *)allocateStream(*queue.instanceStream, runLength * sizeof(glm::mat4), sizeof(glm::mat4), offset);
+			if (instances)
+			{
+				for (size_t j = 0; j < runLength; j++)
+				{
+					instances[j] = queue.commands[queue.order[i + j]].object.modelMatrix;
+				}
+				batch.count = runLength;
+				batch.instanceOffset = offset;
+			}
+		}
+		batches.push_back(batch);
+		i += batch.count;
+	}
+	if (queue.instanceStream)
+		finishStreamWrites(*queue.instanceStream);
+
+	int currentPass = -1;
+	unsigned currentFeatures = ~0u;
+	GLuint currentTexture = ~0u;
+	GLuint currentVertexArrayObject = ~0u;
+	const ShaderVariant *variant = nullptr;
+
+	for (size_t b = 0; b < batches.size(); b++)
+	{
+		const DrawBatch &batch = batches[b];
+		const DrawCommand &command = queue.commands[queue.order[batch.begin]];
+		const bool instanced = batch.instanceOffset >= 0;
+		const unsigned features = instanced ? (command.shaderFeatures | SHADER_INSTANCED) : command.shaderFeatures;
+		int pass = (int)(command.key >> 60);
+
+		if (pass != currentPass)
+		{
+			applyPassState((RenderPass)pass);
+			currentPass = pass;
+			currentFeatures = ~0u; //new pass, new FrameParameters - must re-upload
+		}
+		if (features != currentFeatures)
+		{
+			variant = &variants[features];
+			glUseProgram(variant->program);
+			uploadParameters(variant->frameLayout, &queue.passParameters[pass]);
+			currentFeatures = features;
+			stats.programChanges++;
+		}
+		if (command.texture != currentTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, command.texture);
+			currentTexture = command.texture;
+			stats.textureChanges++;
+		}
+		if (command.vertexArrayObject != currentVertexArrayObject)
+		{
+			glBindVertexArray(command.vertexArrayObject);
+			currentVertexArrayObject = command.vertexArrayObject;
+			stats.vertexArrayChanges++;
+		}
+
+		if (instanced)
+		{
+			//point the mat4 attribute (4 vec4 columns) at this batch's matrices
+			glBindBuffer(GL_ARRAY_BUFFER, queue.instanceStream->buffer);
+			for (int column = 0; column < 4; column++)
+			{
+				glEnableVertexAttribArray(instanceMatrixLocation + column);
+				glVertexAttribPointer(instanceMatrixLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+				                      (GLvoid *)(batch.instanceOffset + column * sizeof(glm::vec4)));
+				glVertexAttribDivisor(instanceMatrixLocation + column, 1);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			if (command.indexed)
+				glDrawElementsInstanced(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid *)(command.first * sizeof(GLuint)), (GLsizei)batch.count);
+			else
+				glDrawArraysInstanced(GL_TRIANGLES, command.first, command.count, (GLsizei)batch.count);
+
+			for (int column = 0; column < 4; column++)
+				glDisableVertexAttribArray(instanceMatrixLocation + column);
+			stats.instancedDraws++;
+		}
+		else
+		{
+			uploadParameters(variant->objectLayout, &command.object);
+			if (command.indexed)
+				glDrawElements(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (GLvoid *)(command.first * sizeof(GLuint)));
+			else
+				glDrawArrays(GL_TRIANGLES, command.first, command.count);
+		}
+		stats.draws++;
+	}
+
+	//clean up
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	glEnable(GL_DEPTH_TEST);
+
+	queue.stats = stats;
+}
+// end::executeRenderQueue[]
@@ -0,0 +1,83 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "shaderVariants.h"
+#include "streamBuffer.h"
+
+// tag::renderPass[]
+//passes execute in this order, each with its own FrameParameters and fixed-function state
+enum RenderPass
+{
+	PASS_WORLD = 0, //opaque arena objects, depth tested, front-to-back
+	PASS_SKYBOX, //after the opaque world, so most of it fails the depth test early
+	PASS_HUD, //clip-space quads over everything, no depth test
+	RENDER_PASS_COUNT
+};
+// end::renderPass[]
+
+// tag::drawCommand[]
+//one draw, plus everything needed to issue it
+struct DrawCommand
+{
+	uint64_t key; //pass | program | texture | VAO | depth - see makeSortKey
+	unsigned shaderFeatures; //which ShaderVariant to draw with
+	GLuint texture;
+	GLuint vertexArrayObject;
+	bool indexed; //first and count are in GL_UNSIGNED_INT indices from the VAO's element buffer
+	GLint first;
+	GLsizei count;
+	ObjectParameters object;
+};
+
+//how many binds the last executeRenderQueue needed
+struct RenderQueueStats
+{
+	int draws; //draw calls issued
+	int instancedDraws; //of which were instanced batches
+	int programChanges;
+	int textureChanges;
+	int vertexArrayChanges;
+};
+
+struct RenderQueue
+{
+	std::vector<DrawCommand> commands;
+	std::vector<uint64_t> keys, keysScratch; //radix sort buffers
+	std::vector<uint32_t> order, orderScratch; //indices into commands, sorted by key
+	FrameParameters passParameters[RENDER_PASS_COUNT];
+	float nearPlane, farPlane; //view depth range quantised into the key
+	StreamBuffer *instanceStream; //if set, runs of identical draws become one instanced draw
+	RenderQueueStats stats;
+};
+// end::drawCommand[]
+
+// tag::renderQueueFunctions[]
+//packed, most significant first: pass (4 bits) | program (8) | texture (16) | VAO (16) | depth (20)
+//so sorting groups draws by pass, then by state, and orders each state group front-to-back
+uint64_t makeSortKey(RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject, float depth01);
+
+void clearRenderQueue(RenderQueue &queue);
+
+//queue a non-indexed triangle draw; viewDepth is the distance along the view direction (0 for HUD quads)
+//object.modelMatrix must be the whole world matrix (rotateMatrix the identity) - an instanced run streams it as it is.
+//The world objects' come from the batched kernels (buildWorldMatrices), one call for all of them
+void submitDraw(RenderQueue &queue, RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject,
+                GLint first, GLsizei count, const ObjectParameters &object, float viewDepth);
+
+//the same, drawing `count` GL_UNSIGNED_INT indices from the VAO's element buffer, starting at index `first`
+void submitIndexedDraw(RenderQueue &queue, RenderPass pass, unsigned shaderFeatures, GLuint texture, GLuint vertexArrayObject,
+                       GLint first, GLsizei count, const ObjectParameters &object, float viewDepth);
+
+//LSD radix sort of the keys (stable, 8 bits per pass, skipping bytes every key shares)
+void sortRenderQueue(RenderQueue &queue);
+
+//issue the sorted draws, only binding program/texture/VAO when they differ from the previous draw
+//runs of draws that differ only in ObjectParameters are merged into one instanced draw, with their
+//matrices streamed through queue.instanceStream (which must be between begin/endStreamFrame)
+void executeRenderQueue(RenderQueue &queue, const ShaderVariant *variants);
+// end::renderQueueFunctions[]
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "clusteredLighting.h"
+
+// tag::worldTransforms[]
+//the arena's, ball's and paddles' positions, rotations and scales, structure-of-arrays as TransformArrays reads them -
+//render() builds all their world matrices with one batched buildWorldMatrices call (batchTransforms.h)
+enum WorldTransform { ARENA_TRANSFORM, BALL_TRANSFORM, LEFT_PADDLE_TRANSFORM, RIGHT_PADDLE_TRANSFORM, WORLD_TRANSFORM_COUNT };
+struct WorldTransforms
+{
+	float positionX[WORLD_TRANSFORM_COUNT];
+	float positionY[WORLD_TRANSFORM_COUNT];
+	float positionZ[WORLD_TRANSFORM_COUNT];
+	float rotationX[WORLD_TRANSFORM_COUNT];
+	float rotationY[WORLD_TRANSFORM_COUNT];
+	float rotationZ[WORLD_TRANSFORM_COUNT];
+	float rotationW[WORLD_TRANSFORM_COUNT];
+	float scaleX[WORLD_TRANSFORM_COUNT];
+	float scaleY[WORLD_TRANSFORM_COUNT];
+	float scaleZ[WORLD_TRANSFORM_COUNT];
+};
+// end::worldTransforms[]
+
+// tag::renderSnapshot[]
+//everything render() needs from the simulation, copied once per sim tick
+//the sim thread fills one in and publishes it - the render thread only ever reads it
+struct RenderSnapshot
+{
+	uint64_t tick; //which simulation tick this is
+
+	//transforms
+	WorldTransforms world;
+	glm::mat4 lightMatrix;
+	glm::mat4 skyBoxmatrix;
+	glm::mat4 skyBoxRotatematrix;
+
+	//camera
+	int cameraStyle;
+	glm::vec3 cameraPosition;
+	glm::vec3 cameraFront;
+	glm::vec3 cameraUp;
+	glm::vec3 ballPos; //the ball-follow camera looks at it
+
+	//lighting
+	glm::vec3 lightPosition;
+	glm::vec3 lightColor;
+	PointLight pointLights[maxPointLights]; //the ball's glow, paddle flashes, sparks - see gatherPointLights
+	int pointLightCount;
+
+	//window - in drawable pixels, which on a high-DPI display can be more than the window's size
+	int drawableWidth;
+	int drawableHeight;
+
+	//the newest input this tick includes - the render thread measures input-to-present latency from it
+	uint64_t inputSerial; //counts input events
+	uint64_t inputCounter; //when the newest happened, on SDL_GetPerformanceCounter
+
+	//HUD
+	int RPscore;
+	int LPscore;
+	bool showStats;
+	bool spectatorLayout; //every camera style at once, in its own viewport
+};
+// end::renderSnapshot[]
+
+#endif
@@ -0,0 +1,153 @@
+#include "shaderReflection.h"
+
+#include <iostream>
+#include <algorithm>
+
+using std::cerr;
+using std::endl;
+
+// tag::reflectProgram[]
+static std::string stripArraySuffix(const std::string &name)
+{
+	size_t bracket = name.find('[');
+	return bracket == std::string::npos ? name : name.substr(0, bracket);
+}
+
+ProgramReflection reflectProgram(GLuint program)
+{
+	ProgramReflection reflection;
+	reflection.program = program;
+
+	GLint maxNameLength = 0;
+	GLint nameLength;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &nameLength);
+	maxNameLength = nameLength;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &nameLength);
+	maxNameLength = std::max(maxNameLength, nameLength);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &nameLength);
+	maxNameLength = std::max(maxNameLength, nameLength);
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+
+	//uniforms
+	GLint uniformCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		ReflectedVariable uniform;
+		GLsizei length = 0;
+		glGetActiveUniform(program, i, (GLsizei)nameBuffer.size(), &length, &uniform.size, &uniform.type, nameBuffer.data());
+		uniform.name = stripArraySuffix(std::string(nameBuffer.data(), length));
+
+		GLuint index = i;
+		glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.blockIndex);
+		uniform.location = uniform.blockIndex == -1 ? glGetUniformLocation(program, uniform.name.c_str()) : -1;
+
+		reflection.uniforms[uniform.name] = uniform;
+	}
+
+	//attributes
+	GLint attributeCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+	for (GLint i = 0; i < attributeCount; i++)
+	{
+		ReflectedVariable attribute;
+		GLsizei length = 0;
+		glGetActiveAttrib(program, i, (GLsizei)nameBuffer.size(), &length, &attribute.size, &attribute.type, nameBuffer.data());
+		attribute.name = std::string(nameBuffer.data(), length);
+		attribute.location = glGetAttribLocation(program, attribute.name.c_str());
+		attribute.blockIndex = -1;
+
+		reflection.attributes[attribute.name] = attribute;
+	}
+
+	//uniform blocks
+	GLint blockCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	for (GLint i = 0; i < blockCount; i++)
+	{
+		ReflectedBlock block;
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program, i, (GLsizei)nameBuffer.size(), &length, nameBuffer.data());
+		block.name = std::string(nameBuffer.data(), length);
+		block.index = i;
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+
+		reflection.uniformBlocks[block.name] = block;
+	}
+
+	return reflection;
+}
+// end::reflectProgram[]
+
+// tag::bindParameters[]
+static bool isSamplerType(GLenum type)
+{
+	switch (type)
+	{
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return true;
+	}
+	return false;
+}
+
+ParameterLayout bindParameters(const ProgramReflection &reflection, const ParameterField *fields, size_t fieldCount,
+                               std::vector<std::string> &missing)
+{
+	ParameterLayout layout;
+	for (size_t i = 0; i < fieldCount; i++)
+	{
+		const ParameterField &field = fields[i];
+		auto found = reflection.uniforms.find(field.name);
+		if (found == reflection.uniforms.end() || found->second.location == -1)
+		{
+			missing.push_back(field.name);
+			continue;
+		}
+
+		const ReflectedVariable &uniform = found->second;
+		bool samplerField = field.type == GL_INT && isSamplerType(uniform.type); //samplers are set as ints
+		if (uniform.type != field.type && !samplerField)
+		{
+			cerr << "Uniform " << field.name << " in program " << reflection.program
+			     << " has GL type 0x" << std::hex << uniform.type << ", parameter struct has 0x" << field.type << std::dec << endl;
+			missing.push_back(field.name);
+			continue;
+		}
+
+		ParameterBinding binding;
+		binding.location = uniform.location;
+		binding.type = field.type;
+		binding.offset = field.offset;
+		binding.count = std::min(field.count, uniform.size);
+		layout.push_back(binding);
+	}
+	return layout;
+}
+// end::bindParameters[]
+
+// tag::uploadParameters[]
+void uploadParameters(const ParameterLayout &layout, const void *parameters)
+{
+	const char *base = static_cast<const char *>(parameters);
+	for (size_t i = 0; i < layout.size(); i++)
+	{
+		const ParameterBinding &binding = layout[i];
+		const GLfloat *data = reinterpret_cast<const GLfloat *>(base + binding.offset);
+		switch (binding.type)
+		{
+		case GL_FLOAT_MAT4: glUniformMatrix4fv(binding.location, binding.count, GL_FALSE, data); break;
+		case GL_FLOAT_MAT3: glUniformMatrix3fv(binding.location, binding.count, GL_FALSE, data); break;
+		case GL_FLOAT_VEC4: glUniform4fv(binding.location, binding.count, data); break;
+		case GL_FLOAT_VEC3: glUniform3fv(binding.location, binding.count, data); break;
+		case GL_FLOAT_VEC2: glUniform2fv(binding.location, binding.count, data); break;
+		case GL_FLOAT: glUniform1fv(binding.location, binding.count, data); break;
+		case GL_INT: glUniform1iv(binding.location, binding.count, reinterpret_cast<const GLint *>(data)); break;
+		case GL_UNSIGNED_INT: glUniform1uiv(binding.location, binding.count, reinterpret_cast<const GLuint *>(data)); break;
+		}
+	}
+}
+// end::uploadParameters[]
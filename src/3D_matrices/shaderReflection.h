@@ -0,0 +1,69 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+// tag::reflection[]
+//what GL reports about one active uniform or attribute
+struct ReflectedVariable
+{
+	std::string name; //array uniforms have their "[0]" stripped
+	GLint location; //-1 for uniforms that live in a uniform block
+	GLenum type; //e.g. GL_FLOAT_MAT4
+	GLint size; //array length (1 for non-arrays)
+	GLint blockIndex; //-1 unless the uniform lives in a uniform block
+};
+
+struct ReflectedBlock
+{
+	std::string name;
+	GLuint index;
+	GLint dataSize; //bytes
+};
+
+//everything active in a linked program, hashed by name
+struct ProgramReflection
+{
+	GLuint program;
+	std::unordered_map<std::string, ReflectedVariable> uniforms;
+	std::unordered_map<std::string, ReflectedVariable> attributes;
+	std::unordered_map<std::string, ReflectedBlock> uniformBlocks;
+};
+
+ProgramReflection reflectProgram(GLuint program);
+// end::reflection[]
+
+// tag::parameterLayout[]
+//describes one member of a C++ parameter struct, which feeds the GLSL uniform of the same name
+struct ParameterField
+{
+	const char *name;
+	GLenum type; //GL type the member holds - must match the GLSL declaration
+	size_t offset; //offsetof(struct, member)
+	GLsizei count; //array length
+};
+
+//a field resolved against one program - everything the per-draw upload needs
+struct ParameterBinding
+{
+	GLint location;
+	GLenum type;
+	size_t offset;
+	GLsizei count;
+};
+typedef std::vector<ParameterBinding> ParameterLayout;
+
+//resolve `fields` against a reflected program, fields not active in the program are skipped
+//and their names appended to `missing`. Type mismatches are reported and skipped too.
+ParameterLayout bindParameters(const ProgramReflection &reflection, const ParameterField *fields, size_t fieldCount,
+                               std::vector<std::string> &missing);
+
+//upload a parameter struct - no string lookups, just a walk over precomputed offsets
+void uploadParameters(const ParameterLayout &layout, const void *parameters);
+// end::parameterLayout[]
+
+#endif
@@ -0,0 +1,69 @@
+#include "shaderVariants.h"
+
+#include <cstddef>
+
+// tag::applyShaderFeatures[]
+std::string applyShaderFeatures(const std::string &source, unsigned features)
+{
+	std::string defines;
+	if (features & SHADER_LIT) defines += "#define LIT\n";
+	if (features & SHADER_TEXTURED) defines += "#define TEXTURED\n";
+	if (features & SHADER_INSTANCED) defines += "#define INSTANCED\n";
+	if (features & SHADER_MULTIVIEW) defines += "#define MULTIVIEW\n";
+
+	size_t versionIdx = source.find("#version");
+	if (versionIdx == std::string::npos)
+		return defines + source;
+	size_t lineEnd = source.find('\n', versionIdx);
+	if (lineEnd == std::string::npos)
+		return source + "\n" + defines;
+	return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+// end::applyShaderFeatures[]
+
+// tag::shaderVariantUses[]
+bool shaderVariantUses(const std::string &name, unsigned features)
+{
+	if (name == "modelMatrix" || name == "rotateMatrix")
+		return !(features & SHADER_INSTANCED);
+	if (name == "viewMatrix" || name == "projectionMatrix")
+		return !(features & SHADER_MULTIVIEW);
+	if (name == "viewCount" || name == "viewProjections")
+		return (features & SHADER_MULTIVIEW) != 0;
+	if (name.compare(0, 7, "cluster") == 0)
+		return (features & SHADER_LIT) && !(features & SHADER_MULTIVIEW);
+	if (name == "lightPosition" || name == "lightColor" || name == "cameraPosition" || name.compare(0, 6, "shadow") == 0)
+		return (features & SHADER_LIT) != 0;
+	return true;
+}
+// end::shaderVariantUses[]
+
+// tag::parameterFields[]
+const ParameterField frameParameterFields[] = {
+	{ "viewMatrix", GL_FLOAT_MAT4, offsetof(FrameParameters, viewMatrix), 1 },
+	{ "projectionMatrix", GL_FLOAT_MAT4, offsetof(FrameParameters, projectionMatrix), 1 },
+	{ "lightPosition", GL_FLOAT_VEC3, offsetof(FrameParameters, lightPosition), 1 },
+	{ "lightColor", GL_FLOAT_VEC3, offsetof(FrameParameters, lightColor), 1 },
+	{ "cameraPosition", GL_FLOAT_VEC3, offsetof(FrameParameters, cameraPosition), 1 },
+	{ "clusterLightData", GL_INT, offsetof(FrameParameters, clusterLightData), 1 },
+	{ "clusterRanges", GL_INT, offsetof(FrameParameters, clusterRanges), 1 },
+	{ "clusterLightIndices", GL_INT, offsetof(FrameParameters, clusterLightIndices), 1 },
+	{ "clusterTilesX", GL_INT, offsetof(FrameParameters, clusterTilesX), 1 },
+	{ "clusterTilesY", GL_INT, offsetof(FrameParameters, clusterTilesY), 1 },
+	{ "clusterSlices", GL_INT, offsetof(FrameParameters, clusterSlices), 1 },
+	{ "clusterTileSize", GL_FLOAT_VEC2, offsetof(FrameParameters, clusterTileSize), 1 },
+	{ "clusterDepthParams", GL_FLOAT_VEC2, offsetof(FrameParameters, clusterDepthParams), 1 },
+	{ "shadowMap", GL_INT, offsetof(FrameParameters, shadowMap), 1 },
+	{ "shadowMatrix", GL_FLOAT_MAT4, offsetof(FrameParameters, shadowMatrix), 1 },
+	{ "shadowTexelScale", GL_FLOAT, offsetof(FrameParameters, shadowTexelScale), 1 },
+	{ "viewCount", GL_INT, offsetof(FrameParameters, viewCount), 1 },
+	{ "viewProjections", GL_FLOAT_MAT4, offsetof(FrameParameters, viewProjections), maxViews },
+};
+const size_t frameParameterFieldCount = sizeof(frameParameterFields) / sizeof(frameParameterFields[0]);
+
+const ParameterField objectParameterFields[] = {
+	{ "modelMatrix", GL_FLOAT_MAT4, offsetof(ObjectParameters, modelMatrix), 1 },
+	{ "rotateMatrix", GL_FLOAT_MAT4, offsetof(ObjectParameters, rotateMatrix), 1 },
+};
+const size_t objectParameterFieldCount = sizeof(objectParameterFields) / sizeof(objectParameterFields[0]);
+// end::parameterFields[]
@@ -0,0 +1,94 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <string>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "shaderReflection.h"
+
+// tag::shaderFeatures[]
+//feature bits - each combination is compiled from the same GLSL files into its own program
+enum ShaderFeature
+{
+	SHADER_LIT = 1 << 0, //ambient, diffuse and specular lighting
+	SHADER_TEXTURED = 1 << 1, //sample `tex` at the `texture` attribute
+	SHADER_INSTANCED = 1 << 2, //per-instance `instanceMatrix` attribute instead of model/rotate uniforms
+	SHADER_MULTIVIEW = 1 << 3, //a geometry shader draws each triangle into `viewCount` viewports (GL_ARB_viewport_array)
+	SHADER_FEATURE_COUNT = 4
+};
+const unsigned shaderVariantCount = 1 << SHADER_FEATURE_COUNT;
+const int maxViews = 5; //MULTIVIEW viewports - sizes the arrays in geometryShader.glsl
+
+//insert `#define`s for the requested features straight after the `#version` line (which must come first)
+std::string applyShaderFeatures(const std::string &source, unsigned features);
+
+//does the GLSL for `features` declare (and use) the uniform `name`? Mirrors the #ifdefs in the shaders
+bool shaderVariantUses(const std::string &name, unsigned features);
+// end::shaderFeatures[]
+
+// tag::attributeLocations[]
+//attribute locations - bound before linking, so every variant shares them (and the VAOs)
+const GLint positionLocation = 0; //location of the `position` attribute in the GLSL
+const GLint vertexColorLocation = 1; //location of the `vertexColor` attribute in the GLSL
+const GLint textureLocation = 2;
+const GLint instanceMatrixLocation = 3; //a mat4 takes 4 consecutive locations (3 to 6)
+const GLint normalLocation = 7; //lighting only - vertexColor is the albedo, and never doubles as the normal
+// end::attributeLocations[]
+
+// tag::shaderParameters[]
+//uniforms that change once per pass (camera and lighting)
+struct FrameParameters
+{
+	glm::mat4 viewMatrix;
+	glm::mat4 projectionMatrix;
+	glm::vec3 lightPosition;
+	glm::vec3 lightColor;
+	glm::vec3 cameraPosition;
+
+	//clustered point lights (LIT only) - texture units of the buffers, and the grid, from clusteredLighting.h
+	GLint clusterLightData;
+	GLint clusterRanges;
+	GLint clusterLightIndices;
+	GLint clusterTilesX;
+	GLint clusterTilesY;
+	GLint clusterSlices;
+	glm::vec2 clusterTileSize; //pixels - the size of the viewport the scene is drawn into, over the tile counts
+	glm::vec2 clusterDepthParams;
+
+	//the main light's shadow map (LIT only) - see shadowMap.h
+	GLint shadowMap; //texture unit
+	glm::mat4 shadowMatrix;
+	GLfloat shadowTexelScale; //lookups are offset along the normal by a few texels - see fragmentShader.glsl
+
+	//MULTIVIEW only - replaces viewMatrix and projectionMatrix, one per viewport
+	GLint viewCount;
+	glm::mat4 viewProjections[maxViews];
+};
+
+//uniforms that change per draw
+struct ObjectParameters
+{
+	glm::mat4 modelMatrix;
+	glm::mat4 rotateMatrix;
+};
+
+extern const ParameterField frameParameterFields[];
+extern const size_t frameParameterFieldCount;
+extern const ParameterField objectParameterFields[];
+extern const size_t objectParameterFieldCount;
+
+//one GLSL program per permutation, with its parameter structs already resolved against it
+struct ShaderVariant
+{
+	GLuint program;
+	ProgramReflection reflection;
+	ParameterLayout frameLayout;
+	ParameterLayout objectLayout;
+};
+// end::shaderParameters[]
+
+#endif
@@ -0,0 +1,5 @@
+#version 330
+//depth only - there is no colour attachment, the depth is written without any help
+void main()
+{
+}
@@ -0,0 +1,182 @@
+#include "shadowMap.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::createShadowMap[]
+static bool framebufferComplete(const char *name)
+{
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+		return true;
+	cerr << "Shadow map: " << name << " framebuffer is incomplete." << endl;
+	return false;
+}
+
+bool createShadowMap(ShadowMap &shadows, GLuint program)
+{
+	shadows.program = program;
+	shadows.viewProjectionLocation = glGetUniformLocation(program, "shadowViewProjection");
+	shadows.worldMatrixLocation = glGetUniformLocation(program, "worldMatrix");
+	shadows.staticValid = false;
+	shadows.cachedLightPosition = glm::vec3(0.0f);
+	shadows.viewProjection = glm::mat4(1.0f);
+	shadows.texelScale = 0.0f;
+	shadows.staticRenders = 0;
+
+	//depth only - no colour attachments, so no draw or read buffer either
+	glGenRenderbuffers(1, &shadows.staticDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, shadows.staticDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, shadowMapSize, shadowMapSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glGenFramebuffers(1, &shadows.staticFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadows.staticFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, shadows.staticDepth);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	const bool complete = framebufferComplete("static");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	//linear filtering with comparison on gives 2x2 PCF from each lookup; outside the map is lit
+	const GLfloat lit[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glGenSamplers(1, &shadows.sampler);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glSamplerParameterfv(shadows.sampler, GL_TEXTURE_BORDER_COLOR, lit);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glSamplerParameteri(shadows.sampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	if (!complete)
+	{
+		destroyShadowMap(shadows);
+		return false;
+	}
+	cout << "Shadow map created (" << shadowMapSize << "x" << shadowMapSize << ") OK!" << endl;
+	return true;
+}
+
+void destroyShadowMap(ShadowMap &shadows)
+{
+	glDeleteFramebuffers(1, &shadows.staticFramebuffer);
+	glDeleteRenderbuffers(1, &shadows.staticDepth);
+	glDeleteSamplers(1, &shadows.sampler);
+	glDeleteProgram(shadows.program);
+	shadows.staticFramebuffer = 0;
+	shadows.staticDepth = 0;
+	shadows.sampler = 0;
+	shadows.program = 0;
+}
+// end::createShadowMap[]
+
+// tag::updateShadowMap[]
+void invalidateStaticShadows(ShadowMap &shadows)
+{
+	shadows.staticValid = false;
+}
+
+//a perspective frustum from the light, just wide enough to take in the scene's bounding sphere
+static glm::mat4 lightViewProjectionOf(const glm::vec3 &lightPosition, const BoundingSphere &sceneBounds, float &texelScale)
+{
+	glm::vec3 toScene = sceneBounds.center - lightPosition;
+	float distance = glm::length(toScene);
+	glm::vec3 direction = distance > 1e-4f ? toScene / distance : glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::vec3 up = std::fabs(direction.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+	//a light inside the sphere can't see all of it through one frustum - take as much as a wide one allows
+	const float maxFov = glm::radians(120.0f);
+	float fov = maxFov;
+	float nearPlane = 0.02f;
+	if (distance > sceneBounds.radius * 1.01f)
+	{
+		fov = std::min(2.0f * std::asin(sceneBounds.radius / distance), maxFov);
+		nearPlane = std::max(distance - sceneBounds.radius, nearPlane);
+	}
+	float farPlane = distance + sceneBounds.radius;
+	texelScale = 2.0f * std::tan(fov * 0.5f) / shadowMapSize;
+	return glm::perspective(fov, 1.0f, nearPlane, farPlane) * glm::lookAt(lightPosition, lightPosition + direction, up);
+}
+
+static void drawCasters(const ShadowMap &shadows, const ShadowCaster *casters, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const ShadowCaster &caster = casters[i];
+		glUniformMatrix4fv(shadows.worldMatrixLocation, 1, GL_FALSE, glm::value_ptr(caster.worldMatrix));
+		glBindVertexArray(caster.vertexArrayObject);
+		if (caster.indexed)
+			glDrawElements(GL_TRIANGLES, caster.count, GL_UNSIGNED_INT, nullptr);
+		else
+			glDrawArrays(GL_TRIANGLES, 0, caster.count);
+	}
+}
+
+void updateShadowMap(ShadowMap &shadows, GLuint shadowFramebuffer, const glm::vec3 &lightPosition, const BoundingSphere &sceneBounds,
+                     const ShadowCaster *staticCasters, int staticCount, const ShadowCaster *dynamicCasters, int dynamicCount)
+{
+	glUseProgram(shadows.program);
+	glViewport(0, 0, shadowMapSize, shadowMapSize);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_POLYGON_OFFSET_FILL); //pushes the stored depth back, so lit surfaces don't shadow themselves
+	glPolygonOffset(2.0f, 4.0f);
+
+	//the static layer - every frame until the light has moved far enough is a copy of this, not a redraw
+	if (!shadows.staticValid || glm::length(lightPosition - shadows.cachedLightPosition) > shadowMapMoveThreshold)
+	{
+		shadows.cachedLightPosition = lightPosition;
+		shadows.viewProjection = lightViewProjectionOf(lightPosition, sceneBounds, shadows.texelScale);
+		glUniformMatrix4fv(shadows.viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(shadows.viewProjection));
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadows.staticFramebuffer);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		drawCasters(shadows, staticCasters, staticCount);
+		shadows.staticValid = true;
+		shadows.staticRenders++;
+	}
+	else
+	{
+		glUniformMatrix4fv(shadows.viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(shadows.viewProjection));
+	}
+
+	//static depth in, then the dynamic casters depth tested against it - from the same cached light position
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, shadows.staticFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadowFramebuffer);
+	glBlitFramebuffer(0, 0, shadowMapSize, shadowMapSize, 0, 0, shadowMapSize, shadowMapSize, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	drawCasters(shadows, dynamicCasters, dynamicCount);
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFramebuffer);
+}
+// end::updateShadowMap[]
+
+// tag::bindShadowMap[]
+glm::mat4 shadowMatrixOf(const ShadowMap &shadows)
+{
+	//clip space -1..1 to texture space 0..1, in x, y and depth
+	const glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+	return bias * shadows.viewProjection;
+}
+
+float shadowTexelScaleOf(const ShadowMap &shadows)
+{
+	return shadows.texelScale;
+}
+
+void bindShadowMap(const ShadowMap &shadows, GLuint depthTexture, GLuint unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glBindSampler(unit, shadows.sampler);
+	glActiveTexture(GL_TEXTURE0);
+}
+// end::bindShadowMap[]
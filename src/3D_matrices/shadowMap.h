@@ -0,0 +1,67 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "frustumCulling.h"
+
+// tag::shadowMap[]
+const int shadowMapSize = 1024; //texels along each side
+const float shadowMapMoveThreshold = 0.1f; //how far (world units) the light moves before the static layer is redrawn
+
+//something that casts a shadow - drawn depth only, with the VAO's position attribute
+struct ShadowCaster
+{
+	GLuint vertexArrayObject;
+	bool indexed; //count GL_UNSIGNED_INT indices from the VAO's element buffer, or count vertices
+	GLsizei count;
+	glm::mat4 worldMatrix;
+};
+
+//a depth map from the main light, in two layers: the static geometry's depth is cached, and only redrawn when
+//the light has moved far enough - each frame it is copied into the shadow map and the dynamic casters are drawn over it
+//the shadow map itself is a transient from the render graph - only the cached layer lives here
+struct ShadowMap
+{
+	GLuint program; //depth only - shadowVertexShader.glsl and shadowFragmentShader.glsl
+	GLint viewProjectionLocation;
+	GLint worldMatrixLocation;
+
+	GLuint staticFramebuffer; //the cached layer
+	GLuint staticDepth; //a renderbuffer - it is only ever copied from
+	GLuint sampler; //depth comparison, for sampler2DShadow - the texture's own state is left alone
+
+	bool staticValid;
+	glm::vec3 cachedLightPosition; //the light position both layers are drawn from - it lags the light by up to the threshold
+	glm::mat4 viewProjection; //world -> light clip space, for cachedLightPosition
+	float texelScale; //a shadow map texel's width in world units, per unit of depth from the light
+	int staticRenders; //how many times the static layer has been drawn
+};
+
+//`program` is linked by the caller (like the text renderer's) and owned by the shadow map from here on
+bool createShadowMap(ShadowMap &shadows, GLuint program);
+void destroyShadowMap(ShadowMap &shadows);
+
+//redraw the static layer on the next update - for when static geometry changes
+void invalidateStaticShadows(ShadowMap &shadows);
+
+//draw the shadow map for the light into shadowFramebuffer (a shadowMapSize square GL_DEPTH_COMPONENT24 target,
+//left bound), with the light's frustum fitted around sceneBounds (world space)
+void updateShadowMap(ShadowMap &shadows, GLuint shadowFramebuffer, const glm::vec3 &lightPosition, const BoundingSphere &sceneBounds,
+                     const ShadowCaster *staticCasters, int staticCount, const ShadowCaster *dynamicCasters, int dynamicCount);
+
+//world -> shadow map texture coordinates (xy) and compare depth (z), after the divide by w
+glm::mat4 shadowMatrixOf(const ShadowMap &shadows);
+//how far to offset a lookup along the surface normal is measured in texels - this turns w (after shadowMatrixOf) into world units
+float shadowTexelScaleOf(const ShadowMap &shadows);
+
+//bind the shadow map's depth texture (with depth comparison on, for sampler2DShadow) to `unit` - GL_TEXTURE0 is left active
+void bindShadowMap(const ShadowMap &shadows, GLuint depthTexture, GLuint unit);
+// end::shadowMap[]
+
+#endif
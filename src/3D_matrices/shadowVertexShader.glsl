@@ -0,0 +1,11 @@
+#version 330
+//depth only, from the main light - see shadowMap.h
+in vec3 position;
+
+uniform mat4 shadowViewProjection;
+uniform mat4 worldMatrix;
+
+void main()
+{
+		gl_Position = shadowViewProjection * worldMatrix * vec4(position, 1.0);
+}
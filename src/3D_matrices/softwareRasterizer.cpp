@@ -0,0 +1,516 @@
+#include "softwareRasterizer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define SOFTWARE_RASTERIZER_SSE
+	#include <xmmintrin.h>
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::softwareColors[]
+//colours are packed as R | G << 8 | B << 16 | A << 24 - byte order RGBA on little-endian machines
+static uint32_t packColor(const glm::vec4 &color)
+{
+	glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+	return (uint32_t)c.r | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+}
+
+static glm::vec4 unpackColor(uint32_t color)
+{
+	return glm::vec4(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, color >> 24) / 255.0f;
+}
+// end::softwareColors[]
+
+// tag::fetchTexel[]
+//GL_NEAREST with GL_CLAMP_TO_EDGE, like the GL textures
+static uint32_t fetchTexel(const SoftwareTexture &texture, float u, float v)
+{
+	int x = std::min(std::max((int)std::floor(u * texture.width), 0), texture.width - 1);
+	int y = std::min(std::max((int)std::floor(v * texture.height), 0), texture.height - 1);
+	return texture.texels[y * texture.width + x];
+}
+// end::fetchTexel[]
+
+// tag::softwareWorkers[]
+static void rasterizeTile(SoftwareRasterizer &rasterizer, int tile);
+
+static void rasterizeTiles(SoftwareRasterizer &rasterizer)
+{
+	const int tileCount = rasterizer.tilesX * rasterizer.tilesY;
+	for (int tile = rasterizer.nextTile++; tile < tileCount; tile = rasterizer.nextTile++)
+		rasterizeTile(rasterizer, tile);
+}
+
+static int softwareWorkerMain(void *data)
+{
+	SoftwareRasterizer &rasterizer = *(SoftwareRasterizer *)data;
+	for (;;)
+	{
+		SDL_SemWait(rasterizer.startWork);
+		if (rasterizer.quit)
+			break;
+		rasterizeTiles(rasterizer);
+		SDL_SemPost(rasterizer.workDone);
+	}
+	return 0;
+}
+
+bool createSoftwareRasterizer(SoftwareRasterizer &rasterizer, int width, int height, int threadCount)
+{
+	rasterizer.width = width;
+	rasterizer.height = height;
+	rasterizer.stride = (width + 3) & ~3;
+	rasterizer.tilesX = (width + softwareTileSize - 1) / softwareTileSize;
+	rasterizer.tilesY = (height + softwareTileSize - 1) / softwareTileSize;
+	rasterizer.color.assign(rasterizer.stride * height, 0);
+	rasterizer.depth.assign(rasterizer.stride * height, 1.0f);
+	rasterizer.clearColor = 0;
+	rasterizer.bins.assign(rasterizer.tilesX * rasterizer.tilesY, std::vector<uint32_t>());
+	rasterizer.nextTile = 0;
+	rasterizer.quit = false;
+
+	rasterizer.startWork = SDL_CreateSemaphore(0);
+	rasterizer.workDone = SDL_CreateSemaphore(0);
+	if (rasterizer.startWork == nullptr || rasterizer.workDone == nullptr)
+	{
+		cerr << "Software rasterizer: SDL_CreateSemaphore Error: " << SDL_GetError() << endl;
+		return false;
+	}
+
+	//the thread calling finishSoftwareFrame shades tiles too
+	if (threadCount <= 0)
+		threadCount = SDL_GetCPUCount();
+	for (int i = 1; i < threadCount; i++)
+	{
+		SDL_Thread *worker = SDL_CreateThread(softwareWorkerMain, "softwareRaster", &rasterizer);
+		if (worker == nullptr)
+		{
+			cerr << "Software rasterizer: SDL_CreateThread Error: " << SDL_GetError() << endl;
+			break;
+		}
+		rasterizer.workers.push_back(worker);
+	}
+	cout << "Software rasterizer created OK! " << width << "x" << height << " on "
+	     << rasterizer.workers.size() + 1 << " threads\n";
+	return true;
+}
+
+void destroySoftwareRasterizer(SoftwareRasterizer &rasterizer)
+{
+	rasterizer.quit = true;
+	for (size_t i = 0; i < rasterizer.workers.size(); i++)
+		SDL_SemPost(rasterizer.startWork);
+	for (size_t i = 0; i < rasterizer.workers.size(); i++)
+		SDL_WaitThread(rasterizer.workers[i], nullptr);
+	rasterizer.workers.clear();
+
+	if (rasterizer.startWork)
+		SDL_DestroySemaphore(rasterizer.startWork);
+	if (rasterizer.workDone)
+		SDL_DestroySemaphore(rasterizer.workDone);
+	rasterizer.startWork = nullptr;
+	rasterizer.workDone = nullptr;
+}
+// end::softwareWorkers[]
+
+// tag::beginSoftwareFrame[]
+void beginSoftwareFrame(SoftwareRasterizer &rasterizer, const glm::vec4 &clearColor)
+{
+	rasterizer.clearColor = packColor(clearColor);
+	rasterizer.draws.clear();
+	rasterizer.triangles.clear();
+	for (size_t i = 0; i < rasterizer.bins.size(); i++)
+		rasterizer.bins[i].clear();
+}
+// end::beginSoftwareFrame[]
+
+// tag::drawSoftware[]
+//a vertex shader output - clip-space position plus Texture, fragmentColor, fragmentPosition and fragmentNormal
+struct ClipVertex
+{
+	glm::vec4 position;
+	float varyings[softwareVaryingCount];
+};
+
+static ClipVertex lerpVertex(const ClipVertex &a, const ClipVertex &b, float t)
+{
+	ClipVertex result;
+	result.position = a.position + (b.position - a.position) * t;
+	for (int i = 0; i < softwareVaryingCount; i++)
+		result.varyings[i] = a.varyings[i] + (b.varyings[i] - a.varyings[i]) * t;
+	return result;
+}
+
+//Sutherland-Hodgman against the near plane (z >= -w) - the other planes are handled by the screen bounds
+//returns the vertex count of the clipped polygon (0, 3 or 4)
+static int clipNear(const ClipVertex *in, ClipVertex *out)
+{
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const ClipVertex &a = in[i];
+		const ClipVertex &b = in[(i + 1) % 3];
+		float da = a.position.z + a.position.w;
+		float db = b.position.z + b.position.w;
+		if (da >= 0.0f)
+			out[count++] = a;
+		if ((da >= 0.0f) != (db >= 0.0f))
+			out[count++] = lerpVertex(a, b, da / (da - db));
+	}
+	return count;
+}
+
+static void setupTriangle(SoftwareRasterizer &rasterizer, const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2)
+{
+	const ClipVertex *v[3] = { &v0, &v1, &v2 };
+	float sx[3], sy[3], sz[3], invW[3];
+	for (int i = 0; i < 3; i++)
+	{
+		invW[i] = 1.0f / v[i]->position.w;
+		sx[i] = (v[i]->position.x * invW[i] * 0.5f + 0.5f) * rasterizer.width;
+		sy[i] = (0.5f - v[i]->position.y * invW[i] * 0.5f) * rasterizer.height; //top row first
+		sz[i] = v[i]->position.z * invW[i] * 0.5f + 0.5f;
+	}
+
+	SoftwareTriangle triangle;
+	triangle.minX = std::max(0, (int)std::floor(std::min(std::min(sx[0], sx[1]), sx[2])));
+	triangle.minY = std::max(0, (int)std::floor(std::min(std::min(sy[0], sy[1]), sy[2])));
+	triangle.maxX = std::min(rasterizer.width - 1, (int)std::ceil(std::max(std::max(sx[0], sx[1]), sx[2])));
+	triangle.maxY = std::min(rasterizer.height - 1, (int)std::ceil(std::max(std::max(sy[0], sy[1]), sy[2])));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return; //off screen
+
+	//edge i is opposite vertex i, so edge i / area is vertex i's barycentric weight
+	float area = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		int k = (i + 2) % 3;
+		triangle.edgeA[i] = sy[j] - sy[k];
+		triangle.edgeB[i] = sx[k] - sx[j];
+		triangle.edgeC[i] = sx[j] * sy[k] - sx[k] * sy[j];
+		area += triangle.edgeC[i];
+	}
+	if (area == 0.0f)
+		return; //degenerate
+	if (area < 0.0f) //no back-face culling in the GL path either, so accept both windings
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			triangle.edgeA[i] = -triangle.edgeA[i];
+			triangle.edgeB[i] = -triangle.edgeB[i];
+			triangle.edgeC[i] = -triangle.edgeC[i];
+		}
+		area = -area;
+	}
+	for (int i = 0; i < 3; i++) //a shared edge is negated in the neighbouring triangle, so exactly one of them includes it
+		triangle.edgeInclusive[i] = triangle.edgeA[i] > 0.0f || (triangle.edgeA[i] == 0.0f && triangle.edgeB[i] > 0.0f);
+
+	//plane through the three vertex values
+	const float invArea = 1.0f / area;
+	auto plane = [&](float *out, float f0, float f1, float f2) {
+		out[0] = (triangle.edgeA[0] * f0 + triangle.edgeA[1] * f1 + triangle.edgeA[2] * f2) * invArea;
+		out[1] = (triangle.edgeB[0] * f0 + triangle.edgeB[1] * f1 + triangle.edgeB[2] * f2) * invArea;
+		out[2] = (triangle.edgeC[0] * f0 + triangle.edgeC[1] * f1 + triangle.edgeC[2] * f2) * invArea;
+	};
+	plane(triangle.depth, sz[0], sz[1], sz[2]); //depth is linear in screen space
+	plane(triangle.invW, invW[0], invW[1], invW[2]);
+	for (int i = 0; i < softwareVaryingCount; i++) //varyings/w are too - divided by 1/w per pixel for perspective-correct values
+		plane(triangle.varyings[i], v0.varyings[i] * invW[0], v1.varyings[i] * invW[1], v2.varyings[i] * invW[2]);
+	triangle.draw = (uint32_t)rasterizer.draws.size() - 1;
+
+	//bin into every tile the bounding box touches
+	const uint32_t index = (uint32_t)rasterizer.triangles.size();
+	rasterizer.triangles.push_back(triangle);
+	for (int tileY = triangle.minY / softwareTileSize; tileY <= triangle.maxY / softwareTileSize; tileY++)
+		for (int tileX = triangle.minX / softwareTileSize; tileX <= triangle.maxX / softwareTileSize; tileX++)
+			rasterizer.bins[tileY * rasterizer.tilesX + tileX].push_back(index);
+}
+
+void drawSoftware(SoftwareRasterizer &rasterizer, const SoftwareMesh &mesh, const SoftwareTexture *texture, unsigned shaderFeatures,
+                  bool depthTest, const FrameParameters &frame, const ObjectParameters &object)
+{
+	SoftwareDrawState draw;
+	draw.texture = texture;
+	draw.shaderFeatures = shaderFeatures;
+	draw.depthTest = depthTest;
+	draw.lightPosition = frame.lightPosition;
+	draw.lightColor = frame.lightColor;
+	draw.cameraPosition = frame.cameraPosition;
+	rasterizer.draws.push_back(draw);
+
+	//vertexShader.glsl, once per draw instead of once per vertex where it can be
+	const glm::mat4 worldMatrix = object.modelMatrix * object.rotateMatrix;
+	const glm::mat4 clipMatrix = frame.projectionMatrix * frame.viewMatrix * worldMatrix;
+	const glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(worldMatrix)));
+	const bool lit = (shaderFeatures & SHADER_LIT) != 0;
+	const bool textured = (shaderFeatures & SHADER_TEXTURED) != 0;
+
+	ClipVertex triangle[3];
+	const int corners = mesh.indices ? mesh.indexCount : mesh.vertexCount;
+	for (int corner = 0; corner + 2 < corners; corner += 3)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			const int vertex = mesh.indices ? (int)mesh.indices[corner + i] : corner + i;
+			const float *p = mesh.positions + vertex * mesh.positionStride;
+			glm::vec4 position(p[0], p[1], mesh.positionSize > 2 ? p[2] : 0.0f, 1.0f);
+			glm::vec3 vertexColor(0.0f);
+			if (mesh.colors)
+			{
+				const float *c = mesh.colors + vertex * mesh.colorStride;
+				for (int component = 0; component < mesh.colorSize && component < 3; component++)
+					vertexColor[component] = c[component];
+			}
+			glm::vec3 normal(0.0f);
+			if (lit && mesh.normals)
+			{
+				const float *n = mesh.normals + vertex * mesh.normalStride;
+				normal = glm::vec3(n[0], n[1], n[2]);
+			}
+
+			ClipVertex &out = triangle[i];
+			out.position = clipMatrix * position;
+			glm::vec3 fragmentNormal = normalMatrix * normal;
+			glm::vec3 fragmentPosition = lit ? glm::vec3(worldMatrix * position) : glm::vec3(0.0f);
+			out.varyings[0] = (textured && mesh.uvs) ? mesh.uvs[vertex * mesh.uvStride] : 0.0f;
+			out.varyings[1] = (textured && mesh.uvs) ? mesh.uvs[vertex * mesh.uvStride + 1] : 0.0f;
+			for (int component = 0; component < 3; component++)
+			{
+				out.varyings[2 + component] = vertexColor[component];
+				out.varyings[5 + component] = fragmentPosition[component];
+				out.varyings[8 + component] = fragmentNormal[component];
+			}
+		}
+
+		//trivially reject triangles entirely outside one side of the frustum
+		bool outside = false;
+		for (int axis = 0; axis < 3 && !outside; axis++)
+		{
+			outside = (triangle[0].position[axis] > triangle[0].position.w && triangle[1].position[axis] > triangle[1].position.w
+			           && triangle[2].position[axis] > triangle[2].position.w)
+			       || (triangle[0].position[axis] < -triangle[0].position.w && triangle[1].position[axis] < -triangle[1].position.w
+			           && triangle[2].position[axis] < -triangle[2].position.w);
+		}
+		if (outside)
+			continue;
+
+		ClipVertex clipped[4];
+		int clippedCount = clipNear(triangle, clipped);
+		for (int i = 1; i + 1 < clippedCount; i++)
+			setupTriangle(rasterizer, clipped[0], clipped[i], clipped[i + 1]);
+	}
+}
+// end::drawSoftware[]
+
+// tag::shadeFragment[]
+//fragmentShader.glsl for one pixel
+static uint32_t shadeFragment(const SoftwareTriangle &triangle, const SoftwareDrawState &draw, float x, float y)
+{
+	const float w = 1.0f / (triangle.invW[0] * x + triangle.invW[1] * y + triangle.invW[2]);
+	//only interpolate what this variant reads - textured unlit draws (the skybox) just need the uv
+	const int varyingCount = (draw.shaderFeatures & SHADER_LIT) ? 11 : (draw.shaderFeatures & SHADER_TEXTURED) ? 2 : 5;
+	float varyings[softwareVaryingCount];
+	for (int i = 0; i < varyingCount; i++)
+		varyings[i] = (triangle.varyings[i][0] * x + triangle.varyings[i][1] * y + triangle.varyings[i][2]) * w;
+	for (int i = varyingCount; i < softwareVaryingCount; i++)
+		varyings[i] = 0.0f;
+	const glm::vec3 fragmentColor(varyings[2], varyings[3], varyings[4]);
+	const glm::vec3 fragmentPosition(varyings[5], varyings[6], varyings[7]);
+	const glm::vec3 fragmentNormal(varyings[8], varyings[9], varyings[10]);
+
+	glm::vec4 baseColor(1.0f);
+	if ((draw.shaderFeatures & SHADER_TEXTURED) && draw.texture)
+	{
+		uint32_t texel = fetchTexel(*draw.texture, varyings[0], varyings[1]);
+		if ((draw.shaderFeatures & SHADER_LIT) == 0)
+			return texel; //unlit textured - the texel is the output colour, already packed
+		baseColor = unpackColor(texel);
+	}
+
+	if (draw.shaderFeatures & SHADER_LIT)
+	{
+		//ambient light
+		glm::vec3 ambient = 0.6f * draw.lightColor;
+
+		//Diffuse lighting
+		glm::vec3 normal = glm::normalize(fragmentNormal);
+		glm::vec3 lightDirection = glm::normalize(draw.lightPosition - fragmentPosition);
+		float diff = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 diffuse = diff * draw.lightColor;
+
+		//Specular lighting - pow(x, 32) as five squarings
+		glm::vec3 viewDirection = glm::normalize(draw.cameraPosition - fragmentPosition);
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+		float spec = std::max(glm::dot(viewDirection, reflectDirection), 0.0f);
+		for (int i = 0; i < 5; i++)
+			spec *= spec;
+		glm::vec3 specular = 0.9f * spec * draw.lightColor;
+
+		glm::vec3 result = (ambient + diffuse + specular) * fragmentColor;
+		return packColor(baseColor * glm::vec4(result, 1.0f));
+	}
+	if (draw.shaderFeatures & SHADER_TEXTURED)
+		return packColor(baseColor);
+	return packColor(glm::vec4(fragmentColor, 1.0f));
+}
+// end::shadeFragment[]
+
+// tag::rasterizeTile[]
+//coverage and depth test for pixels x..x+3 of row y, as a 4-bit mask - z gets each pixel's depth
+static int coverQuad(const SoftwareTriangle &triangle, int x, float y, int lastX, const float *depthRow, bool depthTest, float *z)
+{
+#ifdef SOFTWARE_RASTERIZER_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+	__m128 inside = _mm_cmple_ps(px, _mm_set1_ps(lastX + 0.5f)); //past the bounding box (or tile) edge
+	for (int i = 0; i < 3; i++)
+	{
+		__m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[i]), px), _mm_set1_ps(triangle.edgeB[i] * y + triangle.edgeC[i]));
+		inside = _mm_and_ps(inside, triangle.edgeInclusive[i] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+	}
+	if (_mm_movemask_ps(inside) == 0)
+		return 0;
+
+	__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depth[0]), px), _mm_set1_ps(triangle.depth[1] * y + triangle.depth[2]));
+	_mm_storeu_ps(z, depth);
+	if (depthTest) //GL_LESS, and nothing past the far plane
+		inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmplt_ps(depth, _mm_loadu_ps(depthRow + x)), _mm_cmple_ps(depth, _mm_set1_ps(1.0f))));
+	return _mm_movemask_ps(inside);
+#else
+	int mask = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		const float px = x + lane + 0.5f;
+		bool inside = x + lane <= lastX;
+		for (int i = 0; i < 3 && inside; i++)
+		{
+			float edge = triangle.edgeA[i] * px + triangle.edgeB[i] * y + triangle.edgeC[i];
+			inside = triangle.edgeInclusive[i] ? edge >= 0.0f : edge > 0.0f;
+		}
+		z[lane] = triangle.depth[0] * px + triangle.depth[1] * y + triangle.depth[2];
+		if (inside && depthTest)
+			inside = z[lane] < depthRow[x + lane] && z[lane] <= 1.0f;
+		if (inside)
+			mask |= 1 << lane;
+	}
+	return mask;
+#endif
+}
+
+static void rasterizeTile(SoftwareRasterizer &rasterizer, int tile)
+{
+	const int tileX0 = (tile % rasterizer.tilesX) * softwareTileSize;
+	const int tileY0 = (tile / rasterizer.tilesX) * softwareTileSize;
+	const int tileX1 = std::min(tileX0 + softwareTileSize, rasterizer.width) - 1;
+	const int tileY1 = std::min(tileY0 + softwareTileSize, rasterizer.height) - 1;
+
+	//clear - each tile owns its pixels, so this happens on the workers too
+	for (int y = tileY0; y <= tileY1; y++)
+	{
+		std::fill(rasterizer.color.begin() + y * rasterizer.stride + tileX0, rasterizer.color.begin() + y * rasterizer.stride + tileX1 + 1, rasterizer.clearColor);
+		std::fill(rasterizer.depth.begin() + y * rasterizer.stride + tileX0, rasterizer.depth.begin() + y * rasterizer.stride + tileX1 + 1, 1.0f);
+	}
+
+	const std::vector<uint32_t> &bin = rasterizer.bins[tile];
+	for (size_t b = 0; b < bin.size(); b++)
+	{
+		const SoftwareTriangle &triangle = rasterizer.triangles[bin[b]];
+		const SoftwareDrawState &draw = rasterizer.draws[triangle.draw];
+		const int lastX = std::min(triangle.maxX, tileX1);
+		const int lastY = std::min(triangle.maxY, tileY1);
+		//4-pixel steps start on a multiple of 4 from the tile origin, so they never leave the tile
+		const int firstX = tileX0 + ((std::max(triangle.minX, tileX0) - tileX0) & ~3);
+		const int firstY = std::max(triangle.minY, tileY0);
+
+		for (int y = firstY; y <= lastY; y++)
+		{
+			const float py = y + 0.5f;
+			uint32_t *colorRow = &rasterizer.color[y * rasterizer.stride];
+			float *depthRow = &rasterizer.depth[y * rasterizer.stride];
+			for (int x = firstX; x <= lastX; x += 4)
+			{
+				float z[4];
+				int mask = coverQuad(triangle, x, py, lastX, depthRow, draw.depthTest, z);
+				for (int lane = 0; mask != 0; lane++, mask >>= 1)
+				{
+					if ((mask & 1) == 0)
+						continue;
+					colorRow[x + lane] = shadeFragment(triangle, draw, x + lane + 0.5f, py);
+					if (draw.depthTest)
+						depthRow[x + lane] = z[lane];
+				}
+			}
+		}
+	}
+}
+
+void finishSoftwareFrame(SoftwareRasterizer &rasterizer)
+{
+	rasterizer.nextTile = 0;
+	for (size_t i = 0; i < rasterizer.workers.size(); i++)
+		SDL_SemPost(rasterizer.startWork);
+	rasterizeTiles(rasterizer);
+	for (size_t i = 0; i < rasterizer.workers.size(); i++)
+		SDL_SemWait(rasterizer.workDone);
+}
+// end::rasterizeTile[]
+
+// tag::softwareOutput[]
+std::vector<unsigned char> readSoftwareFrame(const SoftwareRasterizer &rasterizer)
+{
+	std::vector<unsigned char> pixels(rasterizer.width * rasterizer.height * 4);
+	for (int y = 0; y < rasterizer.height; y++)
+	{
+		for (int x = 0; x < rasterizer.width; x++)
+		{
+			uint32_t color = rasterizer.color[y * rasterizer.stride + x];
+			unsigned char *pixel = &pixels[(y * rasterizer.width + x) * 4];
+			pixel[0] = color & 0xff;
+			pixel[1] = (color >> 8) & 0xff;
+			pixel[2] = (color >> 16) & 0xff;
+			pixel[3] = color >> 24;
+		}
+	}
+	return pixels;
+}
+
+void presentSoftwareFrame(const SoftwareRasterizer &rasterizer, SDL_Window *window)
+{
+	SDL_Surface *windowSurface = SDL_GetWindowSurface(window);
+	SDL_Surface *frame = SDL_CreateRGBSurfaceFrom((void *)rasterizer.color.data(), rasterizer.width, rasterizer.height, 32,
+	                                              rasterizer.stride * 4, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+	if (windowSurface == nullptr || frame == nullptr)
+	{
+		cerr << "Software rasterizer: could not present the frame: " << SDL_GetError() << endl;
+		if (frame)
+			SDL_FreeSurface(frame);
+		return;
+	}
+	SDL_SetSurfaceBlendMode(frame, SDL_BLENDMODE_NONE); //copy, don't blend with what was there
+	if (windowSurface->w == rasterizer.width && windowSurface->h == rasterizer.height)
+	{
+		SDL_BlitSurface(frame, nullptr, windowSurface, nullptr);
+	}
+	else
+	{
+		//the window has been resized - the frame stays the size it is, scaled to fit and centred (letterboxed)
+		float scale = std::min((float)windowSurface->w / rasterizer.width, (float)windowSurface->h / rasterizer.height);
+		SDL_Rect fit;
+		fit.w = (int)(rasterizer.width * scale);
+		fit.h = (int)(rasterizer.height * scale);
+		fit.x = (windowSurface->w - fit.w) / 2;
+		fit.y = (windowSurface->h - fit.h) / 2;
+		SDL_FillRect(windowSurface, nullptr, SDL_MapRGB(windowSurface->format, 0, 0, 0));
+		SDL_BlitScaled(frame, nullptr, windowSurface, &fit);
+	}
+	SDL_FreeSurface(frame);
+	SDL_UpdateWindowSurface(window);
+}
+// end::softwareOutput[]
@@ -0,0 +1,118 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <SDL.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "shaderVariants.h"
+
+// tag::softwareResources[]
+//RGBA8 texels, first row of the image file first - the same layout glTexImage2D gets (and decodeImages produces)
+struct SoftwareTexture
+{
+	int width;
+	int height;
+	std::vector<uint32_t> texels;
+};
+
+//the CPU side of a VAO - pointers straight into the vertex data arrays, strides in floats
+//a null uvs/colors/normals pointer reads as zero, like a disabled vertex attribute - a stride of 0 reads the same value for every vertex
+//with indices set, triangles are indexCount indices into the vertices (glDrawElements), otherwise vertexCount vertices in order
+struct SoftwareMesh
+{
+	const float *positions;
+	int positionSize; //2 or 3 components
+	int positionStride;
+	const float *uvs;
+	int uvStride;
+	const float *colors;
+	int colorSize;
+	int colorStride;
+	const float *normals; //3 components - the lit variants' normal, separate from the colour it multiplies
+	int normalStride;
+	int vertexCount;
+	const uint32_t *indices;
+	int indexCount;
+};
+// end::softwareResources[]
+
+// tag::softwareRasterizer[]
+const int softwareTileSize = 32; //pixels, a multiple of the 4-pixel SIMD step
+const int softwareVaryingCount = 11; //uv, fragmentColor, fragmentPosition, fragmentNormal
+
+//a screen-space triangle, set up once and then shared by every tile it overlaps
+//values are planes (a*x + b*y + c) in pixel coordinates, varyings are pre-divided by w
+struct SoftwareTriangle
+{
+	float edgeA[3], edgeB[3], edgeC[3]; //edge functions, >= 0 inside
+	bool edgeInclusive[3]; //top-left rule - pixels exactly on a shared edge belong to one triangle only
+	float depth[3];
+	float invW[3];
+	float varyings[softwareVaryingCount][3];
+	int minX, minY, maxX, maxY;
+	uint32_t draw;
+};
+
+//per-draw state the fragment stage needs
+struct SoftwareDrawState
+{
+	const SoftwareTexture *texture;
+	unsigned shaderFeatures; //SHADER_LIT and SHADER_TEXTURED, as for the GLSL variants
+	bool depthTest;
+	glm::vec3 lightPosition;
+	glm::vec3 lightColor;
+	glm::vec3 cameraPosition;
+};
+
+//binned tile renderer - draws are transformed, clipped and binned on the calling thread,
+//then finishSoftwareFrame shades the tiles across a pool of worker threads
+struct SoftwareRasterizer
+{
+	int width;
+	int height;
+	int stride; //pixels per row, padded to the SIMD width
+	int tilesX;
+	int tilesY;
+	std::vector<uint32_t> color; //RGBA8, top row first
+	std::vector<float> depth;
+	uint32_t clearColor;
+
+	std::vector<SoftwareDrawState> draws;
+	std::vector<SoftwareTriangle> triangles;
+	std::vector<std::vector<uint32_t> > bins; //triangle indices per tile, in submission order
+
+	std::vector<SDL_Thread *> workers;
+	SDL_sem *startWork;
+	SDL_sem *workDone;
+	std::atomic<int> nextTile;
+	std::atomic<bool> quit;
+};
+
+//threadCount 0 uses one thread per core (the calling thread counts as one)
+bool createSoftwareRasterizer(SoftwareRasterizer &rasterizer, int width, int height, int threadCount = 0);
+void destroySoftwareRasterizer(SoftwareRasterizer &rasterizer);
+
+void beginSoftwareFrame(SoftwareRasterizer &rasterizer, const glm::vec4 &clearColor);
+
+//a port of vertexShader.glsl and fragmentShader.glsl (without INSTANCED)
+void drawSoftware(SoftwareRasterizer &rasterizer, const SoftwareMesh &mesh, const SoftwareTexture *texture, unsigned shaderFeatures,
+                  bool depthTest, const FrameParameters &frame, const ObjectParameters &object);
+
+//shade every tile - returns when the colour buffer is complete
+void finishSoftwareFrame(SoftwareRasterizer &rasterizer);
+
+//copy out as tightly packed RGBA, top row first (the layout saveFrameBMP and compareWithGolden take)
+std::vector<unsigned char> readSoftwareFrame(const SoftwareRasterizer &rasterizer);
+
+//blit to a window created without SDL_WINDOW_OPENGL
+void presentSoftwareFrame(const SoftwareRasterizer &rasterizer, SDL_Window *window);
+// end::softwareRasterizer[]
+
+#endif
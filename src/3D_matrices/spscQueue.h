@@ -0,0 +1,53 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// tag::spscQueue[]
+//lock-free single-producer/single-consumer FIFO, in a fixed ring of Capacity slots (a power of two)
+//
+//head and tail only ever grow - the writer owns tail, the reader owns head, and each only reads the
+//other's. Unlike TripleBuffer nothing is dropped: every value pushed is popped, in order, or push fails
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	//writer thread - returns false (and leaves the queue alone) if it is full
+	bool push(const T &value)
+	{
+		const size_t writeAt = tail.load(std::memory_order_relaxed);
+		if (writeAt - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		slots[writeAt & (Capacity - 1)] = value;
+		tail.store(writeAt + 1, std::memory_order_release);
+		return true;
+	}
+
+	//reader thread - the oldest value, without removing it. Returns nullptr if the queue is empty
+	const T *front() const
+	{
+		const size_t readAt = head.load(std::memory_order_relaxed);
+		if (readAt == tail.load(std::memory_order_acquire))
+			return nullptr;
+		return &slots[readAt & (Capacity - 1)];
+	}
+
+	//reader thread - remove the value front() returned
+	void pop()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	T slots[Capacity];
+	std::atomic<size_t> head; //next to read
+	std::atomic<size_t> tail; //next to write
+};
+// end::spscQueue[]
+
+#endif
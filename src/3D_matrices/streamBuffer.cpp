@@ -0,0 +1,142 @@
+#include "streamBuffer.h"
+
+#include <iostream>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::createStreamBuffer[]
+bool createStreamBuffer(StreamBuffer &stream, GLenum target, GLsizeiptr segmentSize)
+{
+	stream.target = target;
+	stream.segmentSize = segmentSize;
+	stream.persistent = GLEW_ARB_buffer_storage != 0;
+	stream.persistentPointer = nullptr;
+	stream.segment = 0;
+	stream.offset = 0;
+	stream.segmentPointer = nullptr;
+	for (int i = 0; i < streamBufferSegmentCount; i++)
+		stream.fences[i] = 0;
+
+	glGenBuffers(1, &stream.buffer);
+	glBindBuffer(target, stream.buffer);
+	if (stream.persistent)
+	{
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, segmentSize * streamBufferSegmentCount, nullptr, flags);
+		stream.persistentPointer = (char *)glMapBufferRange(target, 0, segmentSize * streamBufferSegmentCount, flags);
+		if (stream.persistentPointer == nullptr)
+		{
+			cerr << "Persistent mapping of stream buffer failed, falling back to orphaning." << endl;
+			glDeleteBuffers(1, &stream.buffer);
+			glGenBuffers(1, &stream.buffer);
+			glBindBuffer(target, stream.buffer);
+			stream.persistent = false;
+		}
+	}
+	if (!stream.persistent)
+		glBufferData(target, segmentSize, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(target, 0);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		cerr << "Stream buffer creation failed." << endl;
+		return false;
+	}
+	cout << "Stream buffer created OK! GLUint is: " << stream.buffer
+	     << (stream.persistent ? " (persistent, " : " (orphaning, ") << streamBufferSegmentCount << " x " << segmentSize << " bytes)" << endl;
+	return true;
+}
+
+void destroyStreamBuffer(StreamBuffer &stream)
+{
+	for (int i = 0; i < streamBufferSegmentCount; i++)
+	{
+		if (stream.fences[i])
+			glDeleteSync(stream.fences[i]);
+		stream.fences[i] = 0;
+	}
+	if (stream.persistent)
+	{
+		glBindBuffer(stream.target, stream.buffer);
+		glUnmapBuffer(stream.target);
+		glBindBuffer(stream.target, 0);
+	}
+	glDeleteBuffers(1, &stream.buffer);
+	stream.buffer = 0;
+	stream.persistentPointer = nullptr;
+	stream.segmentPointer = nullptr;
+}
+// end::createStreamBuffer[]
+
+// tag::beginStreamFrame[]
+void beginStreamFrame(StreamBuffer &stream)
+{
+	stream.offset = 0;
+	if (stream.persistent)
+	{
+		stream.segment = (stream.segment + 1) % streamBufferSegmentCount;
+
+		//wait for the GPU to finish the frame that last used this segment (normally long done)
+		GLsync fence = stream.fences[stream.segment];
+		if (fence)
+		{
+			GLenum waitResult = glClientWaitSync(fence, 0, 0);
+			while (waitResult != GL_ALREADY_SIGNALED && waitResult != GL_CONDITION_SATISFIED && waitResult != GL_WAIT_FAILED)
+				waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms
+			glDeleteSync(fence);
+			stream.fences[stream.segment] = 0;
+		}
+		stream.segmentPointer = stream.persistentPointer + stream.segment * stream.segmentSize;
+	}
+	else
+	{
+		//orphan the old storage (the GPU keeps reading it), and map the new storage
+		glBindBuffer(stream.target, stream.buffer);
+		glBufferData(stream.target, stream.segmentSize, nullptr, GL_STREAM_DRAW);
+		stream.segmentPointer = (char *)glMapBufferRange(stream.target, 0, stream.segmentSize,
+		                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		glBindBuffer(stream.target, 0);
+	}
+}
+// end::beginStreamFrame[]
+
+// tag::allocateStream[]
+void *allocateStream(StreamBuffer &stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr &bufferOffset)
+{
+	if (stream.segmentPointer == nullptr)
+		return nullptr;
+
+	GLsizeiptr start = (stream.offset + alignment - 1) / alignment * alignment;
+	if (start + size > stream.segmentSize)
+		return nullptr;
+
+	stream.offset = start + size;
+	bufferOffset = (stream.persistent ? stream.segment * stream.segmentSize : 0) + start;
+	return stream.segmentPointer + start;
+}
+// end::allocateStream[]
+
+// tag::endStreamFrame[]
+void finishStreamWrites(StreamBuffer &stream)
+{
+	//coherent persistent mappings need nothing - the writes are already visible to the GPU
+	if (!stream.persistent && stream.segmentPointer)
+	{
+		glBindBuffer(stream.target, stream.buffer);
+		glUnmapBuffer(stream.target);
+		glBindBuffer(stream.target, 0);
+	}
+	stream.segmentPointer = nullptr;
+}
+
+void endStreamFrame(StreamBuffer &stream)
+{
+	finishStreamWrites(stream);
+
+	//remember when the GPU is done with this segment, so we don't overwrite it too early
+	if (stream.persistent)
+		stream.fences[stream.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+// end::endStreamFrame[]
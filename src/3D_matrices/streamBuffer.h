@@ -0,0 +1,47 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+
+// tag::streamBuffer[]
+//per-frame dynamic data (instance transforms, HUD quads, uniform blocks, ...) is written here
+//
+//with GL_ARB_buffer_storage the buffer is mapped once, persistently, and split into
+//streamBufferSegmentCount segments - one per frame in flight, each guarded by a fence.
+//on plain GL 3.3 the buffer is orphaned and re-mapped every frame instead, which lets
+//the driver hand us fresh memory rather than stall on the copy the GPU is still reading.
+const int streamBufferSegmentCount = 3;
+
+struct StreamBuffer
+{
+	GLenum target;
+	GLuint buffer;
+	GLsizeiptr segmentSize;
+	bool persistent; //true if using the GL_ARB_buffer_storage path
+	char *persistentPointer; //whole-buffer mapping, persistent path only
+	GLsync fences[streamBufferSegmentCount];
+	int segment; //segment being written this frame
+	GLsizeiptr offset; //write head within the segment
+	char *segmentPointer; //CPU address of the segment being written (nullptr outside a frame)
+};
+
+//returns false (after reporting why) if the buffer could not be created
+bool createStreamBuffer(StreamBuffer &stream, GLenum target, GLsizeiptr segmentSize);
+void destroyStreamBuffer(StreamBuffer &stream);
+
+//start writing a new frame's data - may block if the GPU is still reading this segment
+void beginStreamFrame(StreamBuffer &stream);
+
+//reserve `size` bytes aligned to `alignment`, returns where to write them, and (in bufferOffset)
+//where GL will find them in stream.buffer. Returns nullptr if the segment is full.
+void *allocateStream(StreamBuffer &stream, GLsizeiptr size, GLsizeiptr alignment, GLintptr &bufferOffset);
+
+//finish the frame's writes - call before issuing any draw that reads them
+//(a non-persistent mapping must be unmapped before GL may read the buffer)
+void finishStreamWrites(StreamBuffer &stream);
+
+//end the frame - call after the last draw that reads this frame's data has been issued
+void endStreamFrame(StreamBuffer &stream);
+// end::streamBuffer[]
+
+#endif
@@ -0,0 +1,12 @@
+#version 330
+//HUD text - the glyph atlas holds coverage only, the colour comes from the vertices
+in vec4 fragmentColor;
+in vec2 Texture;
+
+uniform sampler2D atlas;
+
+out vec4 outputColor;
+void main()
+{
+	outputColor = vec4(fragmentColor.rgb, fragmentColor.a * texture(atlas, Texture).r);
+}
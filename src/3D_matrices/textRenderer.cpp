@@ -0,0 +1,346 @@
+#include "textRenderer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <SDL_ttf.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::createGlyphAtlas[]
+//a glyph cropped to its inked pixels, waiting to be packed
+struct GlyphBitmap
+{
+	int font;
+	int character;
+	int width, height;
+	int offsetX, offsetY;
+	std::vector<uint8_t> coverage;
+};
+
+//render one character on its own line, so SDL_ttf places it against the ascent for us, then crop it
+static GlyphBitmap rasterizeGlyph(TTF_Font *font, int fontIndex, int character)
+{
+	GlyphBitmap bitmap;
+	bitmap.font = fontIndex;
+	bitmap.character = character;
+	bitmap.width = 0;
+	bitmap.height = 0;
+	bitmap.offsetX = 0;
+	bitmap.offsetY = 0;
+
+	const char text[2] = { (char)character, 0 };
+	const SDL_Color white = { 255, 255, 255, 255 };
+	SDL_Surface *surface = TTF_RenderText_Blended(font, text, white);
+	if (surface == nullptr)
+		return bitmap; //nothing to draw, e.g. a space
+
+	SDL_LockSurface(surface);
+	int minX = surface->w, minY = surface->h, maxX = -1, maxY = -1;
+	std::vector<uint8_t> alpha(surface->w * surface->h);
+	for (int y = 0; y < surface->h; y++)
+	{
+		const Uint32 *row = (const Uint32 *)((const char *)surface->pixels + y * surface->pitch);
+		for (int x = 0; x < surface->w; x++)
+		{
+			Uint8 r, g, b, a;
+			SDL_GetRGBA(row[x], surface->format, &r, &g, &b, &a);
+			alpha[y * surface->w + x] = a;
+			if (a)
+			{
+				minX = std::min(minX, x);
+				maxX = std::max(maxX, x);
+				minY = std::min(minY, y);
+				maxY = std::max(maxY, y);
+			}
+		}
+	}
+	SDL_UnlockSurface(surface);
+
+	if (maxX >= 0)
+	{
+		bitmap.width = maxX - minX + 1;
+		bitmap.height = maxY - minY + 1;
+		bitmap.offsetX = minX;
+		bitmap.offsetY = minY;
+		bitmap.coverage.resize(bitmap.width * bitmap.height);
+		for (int y = 0; y < bitmap.height; y++)
+			std::copy(alpha.begin() + (minY + y) * surface->w + minX, alpha.begin() + (minY + y) * surface->w + maxX + 1,
+			          bitmap.coverage.begin() + y * bitmap.width);
+	}
+	SDL_FreeSurface(surface);
+	return bitmap;
+}
+
+bool createGlyphAtlas(GlyphAtlas &atlas, const std::string &fontPath, const std::vector<int> &pixelSizes)
+{
+	std::vector<GlyphBitmap> bitmaps;
+	atlas.fonts.assign(pixelSizes.size(), GlyphFont());
+	for (size_t f = 0; f < pixelSizes.size(); f++)
+	{
+		TTF_Font *font = TTF_OpenFont(fontPath.c_str(), pixelSizes[f]);
+		if (font == nullptr)
+		{
+			cerr << "Font could not be loaded from " << fontPath << ": " << TTF_GetError() << endl;
+			return false;
+		}
+		GlyphFont &glyphFont = atlas.fonts[f];
+		glyphFont.pixelSize = pixelSizes[f];
+		glyphFont.lineHeight = TTF_FontLineSkip(font);
+		for (int c = 0; c < glyphCount; c++)
+		{
+			int minX, maxX, minY, maxY, advance;
+			if (TTF_GlyphMetrics(font, (Uint16)(glyphFirst + c), &minX, &maxX, &minY, &maxY, &advance) != 0)
+				advance = 0;
+			glyphFont.glyphs[c].advance = advance;
+			bitmaps.push_back(rasterizeGlyph(font, (int)f, glyphFirst + c));
+		}
+		TTF_CloseFont(font);
+	}
+
+	//shelf packing - tallest first, so each row wastes little height
+	std::vector<size_t> order(bitmaps.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&bitmaps](size_t a, size_t b) { return bitmaps[a].height > bitmaps[b].height; });
+
+	int penX = glyphPadding, penY = glyphPadding, rowHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const GlyphBitmap &bitmap = bitmaps[order[i]];
+		if (penX + bitmap.width + glyphPadding > glyphAtlasWidth)
+		{
+			penX = glyphPadding;
+			penY += rowHeight + glyphPadding;
+			rowHeight = 0;
+		}
+		Glyph &glyph = atlas.fonts[bitmap.font].glyphs[bitmap.character - glyphFirst];
+		glyph.x = penX;
+		glyph.y = penY;
+		glyph.width = bitmap.width;
+		glyph.height = bitmap.height;
+		glyph.offsetX = bitmap.offsetX;
+		glyph.offsetY = bitmap.offsetY;
+		penX += bitmap.width + glyphPadding;
+		rowHeight = std::max(rowHeight, bitmap.height);
+	}
+
+	atlas.width = glyphAtlasWidth;
+	atlas.height = penY + rowHeight + glyphPadding;
+	atlas.coverage.assign(atlas.width * atlas.height, 0);
+	for (size_t i = 0; i < bitmaps.size(); i++)
+	{
+		const GlyphBitmap &bitmap = bitmaps[i];
+		const Glyph &glyph = atlas.fonts[bitmap.font].glyphs[bitmap.character - glyphFirst];
+		for (int y = 0; y < bitmap.height; y++)
+			std::copy(bitmap.coverage.begin() + y * bitmap.width, bitmap.coverage.begin() + (y + 1) * bitmap.width,
+			          atlas.coverage.begin() + (glyph.y + y) * atlas.width + glyph.x);
+	}
+
+	cout << "Glyph atlas created OK! " << bitmaps.size() << " glyphs in " << atlas.width << "x" << atlas.height << " texels" << endl;
+	return true;
+}
+// end::createGlyphAtlas[]
+
+// tag::textBatch[]
+void clearText(TextBatch &batch)
+{
+	batch.quads.clear();
+}
+
+float addText(TextBatch &batch, const GlyphAtlas &atlas, int font, const std::string &text, float x, float y, const glm::vec4 &color)
+{
+	const GlyphFont &glyphFont = atlas.fonts[font];
+	const float u = 1.0f / atlas.width;
+	const float v = 1.0f / atlas.height;
+	float penX = x;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		int c = (unsigned char)text[i] - glyphFirst;
+		if (c < 0 || c >= glyphCount)
+			c = '?' - glyphFirst;
+		const Glyph &glyph = glyphFont.glyphs[c];
+		if (glyph.width > 0)
+		{
+			TextQuad quad;
+			quad.x0 = std::floor(penX) + glyph.offsetX; //whole pixels, so glyphs map 1:1 onto texels
+			quad.y0 = std::floor(y) + glyph.offsetY;
+			quad.x1 = quad.x0 + glyph.width;
+			quad.y1 = quad.y0 + glyph.height;
+			quad.u0 = glyph.x * u;
+			quad.v0 = glyph.y * v;
+			quad.u1 = (glyph.x + glyph.width) * u;
+			quad.v1 = (glyph.y + glyph.height) * v;
+			quad.color = color;
+			batch.quads.push_back(quad);
+		}
+		penX += glyph.advance;
+	}
+	return penX - x;
+}
+
+float measureText(const GlyphAtlas &atlas, int font, const std::string &text)
+{
+	const GlyphFont &glyphFont = atlas.fonts[font];
+	float width = 0.0f;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		int c = (unsigned char)text[i] - glyphFirst;
+		if (c < 0 || c >= glyphCount)
+			c = '?' - glyphFirst;
+		width += glyphFont.glyphs[c].advance;
+	}
+	return width;
+}
+// end::textBatch[]
+
+// tag::createTextRenderer[]
+bool createTextRenderer(TextRenderer &renderer, const GlyphAtlas &atlas, GLuint program)
+{
+	renderer.program = program;
+	renderer.screenSizeLocation = glGetUniformLocation(program, "screenSize");
+	renderer.atlasLocation = glGetUniformLocation(program, "atlas");
+
+	//single channel - the shader reads coverage from .r
+	glGenTextures(1, &renderer.atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, renderer.atlasTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas.width, atlas.height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.coverage.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//segments are a whole number of vertices, so a stream offset is always a valid first vertex
+	if (!createStreamBuffer(renderer.vertices, GL_ARRAY_BUFFER, textMaxGlyphs * 6 * sizeof(TextVertex)))
+		return false;
+
+	glGenVertexArrays(1, &renderer.vertexArrayObject);
+	glBindVertexArray(renderer.vertexArrayObject);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.vertices.buffer);
+	glEnableVertexAttribArray(positionLocation);
+	glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid *)offsetof(TextVertex, x));
+	glEnableVertexAttribArray(vertexColorLocation);
+	glVertexAttribPointer(vertexColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid *)offsetof(TextVertex, r));
+	glEnableVertexAttribArray(textureLocation);
+	glVertexAttribPointer(textureLocation, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (GLvoid *)offsetof(TextVertex, u));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	cout << "Text renderer created OK! Atlas GLUint is: " << renderer.atlasTexture << endl;
+	return true;
+}
+
+void destroyTextRenderer(TextRenderer &renderer)
+{
+	destroyStreamBuffer(renderer.vertices);
+	glDeleteVertexArrays(1, &renderer.vertexArrayObject);
+	glDeleteTextures(1, &renderer.atlasTexture);
+	glDeleteProgram(renderer.program);
+}
+// end::createTextRenderer[]
+
+// tag::drawText[]
+static void writeVertex(TextVertex &vertex, float x, float y, float u, float v, const glm::vec4 &color)
+{
+	vertex.x = x;
+	vertex.y = y;
+	vertex.r = color.r;
+	vertex.g = color.g;
+	vertex.b = color.b;
+	vertex.a = color.a;
+	vertex.u = u;
+	vertex.v = v;
+}
+
+void drawText(TextRenderer &renderer, const TextBatch &batch, int screenWidth, int screenHeight)
+{
+	const size_t glyphs = std::min(batch.quads.size(), (size_t)textMaxGlyphs);
+	if (glyphs == 0)
+		return;
+
+	//two triangles per glyph, written straight into this frame's segment of the stream
+	beginStreamFrame(renderer.vertices);
+	GLintptr offset = 0;
+	TextVertex *vertices = (TextVertex *)allocateStream(renderer.vertices, glyphs * 6 * sizeof(TextVertex), sizeof(TextVertex), offset);
+	if (vertices == nullptr)
+	{
+		endStreamFrame(renderer.vertices);
+		return;
+	}
+	for (size_t i = 0; i < glyphs; i++)
+	{
+		const TextQuad &q = batch.quads[i];
+		TextVertex *v = vertices + i * 6;
+		writeVertex(v[0], q.x0, q.y0, q.u0, q.v0, q.color);
+		writeVertex(v[1], q.x0, q.y1, q.u0, q.v1, q.color);
+		writeVertex(v[2], q.x1, q.y1, q.u1, q.v1, q.color);
+		writeVertex(v[3], q.x1, q.y1, q.u1, q.v1, q.color);
+		writeVertex(v[4], q.x1, q.y0, q.u1, q.v0, q.color);
+		writeVertex(v[5], q.x0, q.y0, q.u0, q.v0, q.color);
+	}
+	finishStreamWrites(renderer.vertices);
+
+	glUseProgram(renderer.program);
+	glUniform2f(renderer.screenSizeLocation, (float)screenWidth, (float)screenHeight);
+	glUniform1i(renderer.atlasLocation, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderer.atlasTexture);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE); //keep the destination alpha, for --capture
+
+	glBindVertexArray(renderer.vertexArrayObject);
+	glDrawArrays(GL_TRIANGLES, (GLint)(offset / sizeof(TextVertex)), (GLsizei)(glyphs * 6));
+	glBindVertexArray(0);
+
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	endStreamFrame(renderer.vertices);
+}
+// end::drawText[]
+
+// tag::drawSoftwareText[]
+//glyphs are drawn 1:1, so nearest texel lookups give the same result as GL's linear filtering
+void drawSoftwareText(SoftwareRasterizer &rasterizer, const GlyphAtlas &atlas, const TextBatch &batch)
+{
+	for (size_t i = 0; i < batch.quads.size(); i++)
+	{
+		const TextQuad &q = batch.quads[i];
+		const int x0 = std::max((int)q.x0, 0), x1 = std::min((int)q.x1, rasterizer.width);
+		const int y0 = std::max((int)q.y0, 0), y1 = std::min((int)q.y1, rasterizer.height);
+		const int atlasX = (int)(q.u0 * atlas.width + 0.5f) - (int)q.x0;
+		const int atlasY = (int)(q.v0 * atlas.height + 0.5f) - (int)q.y0;
+		const glm::vec4 color = glm::clamp(q.color, 0.0f, 1.0f) * 255.0f;
+		for (int y = y0; y < y1; y++)
+		{
+			const uint8_t *coverage = &atlas.coverage[(atlasY + y) * atlas.width + atlasX];
+			uint32_t *pixel = &rasterizer.color[y * rasterizer.stride];
+			for (int x = x0; x < x1; x++)
+			{
+				const int alpha = (int)(coverage[x] * q.color.a + 0.5f);
+				if (alpha == 0)
+					continue;
+				//source-over, per RGB channel - the destination alpha is left alone, as with glBlendFunc
+				uint32_t dst = pixel[x];
+				uint32_t out = dst & 0xff000000u;
+				for (int channel = 0; channel < 3; channel++)
+				{
+					int d = (dst >> (channel * 8)) & 0xff;
+					int blended = d + ((int)(color[channel] + 0.5f) - d) * alpha / 255;
+					out |= (uint32_t)blended << (channel * 8);
+				}
+				pixel[x] = out;
+			}
+		}
+	}
+}
+// end::drawSoftwareText[]
@@ -0,0 +1,106 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+#include "shaderVariants.h"
+#include "streamBuffer.h"
+#include "softwareRasterizer.h"
+
+// tag::glyphAtlas[]
+const int glyphFirst = 32; //printable ASCII, ' ' to '~'
+const int glyphCount = 95;
+const int glyphAtlasWidth = 512; //the height is whatever the packed glyphs need
+const int glyphPadding = 1; //clear texels around each glyph, so linear filtering doesn't bleed
+
+//one glyph's rectangle in the atlas, and where it sits relative to the pen (top of the line)
+struct Glyph
+{
+	int x, y, width, height; //texels
+	int offsetX, offsetY;
+	int advance;
+};
+
+//one font size - glyphs are rasterized at the size they are drawn, so text stays sharp
+struct GlyphFont
+{
+	int pixelSize;
+	int lineHeight;
+	Glyph glyphs[glyphCount];
+};
+
+//every size of the font, packed once at load time into a single 8-bit coverage texture
+struct GlyphAtlas
+{
+	int width;
+	int height;
+	std::vector<uint8_t> coverage; //top row first
+	std::vector<GlyphFont> fonts; //in the order of the sizes passed to createGlyphAtlas
+};
+
+//rasterize printable ASCII with SDL_ttf (TTF_Init must have been called) - no GL calls
+bool createGlyphAtlas(GlyphAtlas &atlas, const std::string &fontPath, const std::vector<int> &pixelSizes);
+// end::glyphAtlas[]
+
+// tag::textBatch[]
+//a glyph to draw, in pixels from the top-left of the screen
+struct TextQuad
+{
+	float x0, y0, x1, y1;
+	float u0, v0, u1, v1;
+	glm::vec4 color;
+};
+
+//all the text for a frame - drawn with one draw call
+struct TextBatch
+{
+	std::vector<TextQuad> quads;
+};
+
+void clearText(TextBatch &batch);
+
+//queue a line of text with its top-left corner at (x, y) - returns its width in pixels
+float addText(TextBatch &batch, const GlyphAtlas &atlas, int font, const std::string &text, float x, float y, const glm::vec4 &color);
+
+float measureText(const GlyphAtlas &atlas, int font, const std::string &text);
+// end::textBatch[]
+
+// tag::textRenderer[]
+const int textMaxGlyphs = 2048; //per frame - any more are dropped
+
+struct TextVertex
+{
+	float x, y;
+	float r, g, b, a;
+	float u, v;
+};
+
+struct TextRenderer
+{
+	GLuint program; //textVertexShader.glsl and textFragmentShader.glsl
+	GLint screenSizeLocation;
+	GLint atlasLocation;
+	GLuint atlasTexture;
+	GLuint vertexArrayObject;
+	StreamBuffer vertices; //quads are expanded straight into the stream each frame
+};
+
+//upload the atlas and set up the vertex stream - takes ownership of program
+bool createTextRenderer(TextRenderer &renderer, const GlyphAtlas &atlas, GLuint program);
+void destroyTextRenderer(TextRenderer &renderer);
+
+//blend the batch over the framebuffer - no depth test, so call after everything else
+void drawText(TextRenderer &renderer, const TextBatch &batch, int screenWidth, int screenHeight);
+
+//the same for the software renderer - call after finishSoftwareFrame
+void drawSoftwareText(SoftwareRasterizer &rasterizer, const GlyphAtlas &atlas, const TextBatch &batch);
+// end::textRenderer[]
+
+#endif
@@ -0,0 +1,17 @@
+#version 330
+//HUD text - positions are in pixels, from the top-left corner of the screen
+in vec2 position;
+in vec4 vertexColor;
+in vec2 texture;
+
+out vec4 fragmentColor;
+out vec2 Texture;
+
+uniform vec2 screenSize;
+
+void main()
+{
+		gl_Position = vec4(position.x / screenSize.x * 2.0 - 1.0, 1.0 - position.y / screenSize.y * 2.0, 0.0, 1.0);
+		fragmentColor = vertexColor;
+		Texture = texture;
+}
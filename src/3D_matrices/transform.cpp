@@ -0,0 +1,84 @@
+#include "transform.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// tag::transform[]
+Transform makeTransform(const glm::vec3 &position)
+{
+	Transform transform;
+	transform.position = position;
+	transform.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	transform.scale = glm::vec3(1.0f);
+	transform.worldMatrix = glm::mat4(1.0f);
+	transform.dirty = true;
+	return transform;
+}
+
+void setPosition(Transform &transform, const glm::vec3 &position)
+{
+	if (position == transform.position)
+		return;
+	transform.position = position;
+	transform.dirty = true;
+}
+
+void setRotation(Transform &transform, const glm::quat &rotation)
+{
+	if (rotation == transform.rotation)
+		return;
+	transform.rotation = rotation;
+	transform.dirty = true;
+}
+
+void setScale(Transform &transform, const glm::vec3 &scale)
+{
+	if (scale == transform.scale)
+		return;
+	transform.scale = scale;
+	transform.dirty = true;
+}
+
+const glm::mat4 &worldMatrixOf(Transform &transform)
+{
+	if (transform.dirty)
+	{
+		//the rotation and scale go straight into the upper 3x3, rather than through two matrix multiplies
+		const glm::mat3 rotation = glm::mat3_cast(transform.rotation);
+		transform.worldMatrix = glm::mat4(glm::vec4(rotation[0] * transform.scale.x, 0.0f),
+		                                  glm::vec4(rotation[1] * transform.scale.y, 0.0f),
+		                                  glm::vec4(rotation[2] * transform.scale.z, 0.0f),
+		                                  glm::vec4(transform.position, 1.0f));
+		transform.dirty = false;
+	}
+	return transform.worldMatrix;
+}
+// end::transform[]
+
+// tag::cachedCamera[]
+const glm::mat4 &lookAtOf(CachedLookAt &cache, const glm::vec3 &eye, const glm::vec3 &center, const glm::vec3 &up)
+{
+	if (!cache.valid || eye != cache.eye || center != cache.center || up != cache.up)
+	{
+		cache.eye = eye;
+		cache.center = center;
+		cache.up = up;
+		cache.matrix = glm::lookAt(eye, center, up);
+		cache.valid = true;
+	}
+	return cache.matrix;
+}
+
+const glm::mat4 &perspectiveOf(CachedProjection &cache, float fov, float aspect, float nearPlane, float farPlane)
+{
+	if (!cache.valid || fov != cache.fov || aspect != cache.aspect || nearPlane != cache.nearPlane || farPlane != cache.farPlane)
+	{
+		cache.fov = fov;
+		cache.aspect = aspect;
+		cache.nearPlane = nearPlane;
+		cache.farPlane = farPlane;
+		cache.matrix = glm::perspective(fov, aspect, nearPlane, farPlane);
+		cache.valid = true;
+	}
+	return cache.matrix;
+}
+// end::cachedCamera[]
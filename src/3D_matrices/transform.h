@@ -0,0 +1,56 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// tag::transform[]
+//an object's position, rotation and scale, with its world matrix cached - setting a part to the value it
+//already has doesn't dirty it, so a static object's matrix is built once, however often it is "moved"
+struct Transform
+{
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+	glm::mat4 worldMatrix; //only up to date when !dirty - read it with worldMatrixOf
+	bool dirty;
+};
+
+Transform makeTransform(const glm::vec3 &position = glm::vec3(0.0f));
+
+void setPosition(Transform &transform, const glm::vec3 &position);
+void setRotation(Transform &transform, const glm::quat &rotation);
+void setScale(Transform &transform, const glm::vec3 &scale);
+
+//translate * rotate * scale - rebuilt here if anything changed since the last call
+const glm::mat4 &worldMatrixOf(Transform &transform);
+// end::transform[]
+
+// tag::cachedCamera[]
+//a lookAt, only recomputed when the eye, target or up direction change
+struct CachedLookAt
+{
+	glm::vec3 eye;
+	glm::vec3 center;
+	glm::vec3 up;
+	glm::mat4 matrix;
+	bool valid;
+};
+
+//a perspective projection, only recomputed when the field of view or aspect ratio change (e.g. on a resize)
+struct CachedProjection
+{
+	float fov;
+	float aspect;
+	float nearPlane;
+	float farPlane;
+	glm::mat4 matrix;
+	bool valid;
+};
+
+const glm::mat4 &lookAtOf(CachedLookAt &cache, const glm::vec3 &eye, const glm::vec3 &center, const glm::vec3 &up);
+const glm::mat4 &perspectiveOf(CachedProjection &cache, float fov, float aspect, float nearPlane, float farPlane);
+// end::cachedCamera[]
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// tag::tripleBuffer[]
+//lock-free single-producer/single-consumer hand-over of the latest value
+//
+//three slots: the writer owns one, the reader owns one, and the third ("middle") is swapped
+//atomically with whichever side is done. The writer never waits for the reader and the reader
+//always gets the most recent complete value - older unread values are simply dropped.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+	//the slot the writer fills in - only touch from the writer thread
+	T &writeSlot() { return slots[writeIndex]; }
+
+	//hand the write slot over, and take the old middle slot to write into next time
+	void publish()
+	{
+		unsigned previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+		writeIndex = previous & indexMask;
+	}
+
+	//if something new was published, make it the read slot. Returns false if nothing new
+	bool acquire()
+	{
+		if (!(middle.load(std::memory_order_acquire) & freshBit))
+			return false;
+		unsigned previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & indexMask;
+		return true;
+	}
+
+	//the latest value acquired - only touch from the reader thread
+	const T &readSlot() const { return slots[readIndex]; }
+
+private:
+	static const unsigned indexMask = 3;
+	static const unsigned freshBit = 4; //set in `middle` when it holds a value the reader hasn't seen
+
+	T slots[3];
+	std::atomic<unsigned> middle;
+	unsigned writeIndex;
+	unsigned readIndex;
+};
+// end::tripleBuffer[]
+
+#endif
@@ -0,0 +1,90 @@
+#include "vertexPacking.h"
+
+#include <iostream>
+
+#include <glm/gtc/packing.hpp>
+
+using std::cerr;
+using std::endl;
+
+// tag::vertexPacking[]
+PackedPosition packPosition(const glm::vec3 &position)
+{
+	return glm::packSnorm4x16(glm::vec4(position, 1.0f));
+}
+
+PackedHalfPosition packHalfPosition(const glm::vec3 &position)
+{
+	return glm::packHalf4x16(glm::vec4(position, 1.0f));
+}
+
+PackedNormal packNormal(const glm::vec3 &normal)
+{
+	const float length = glm::length(normal);
+	return glm::packSnorm3x10_1x2(glm::vec4(length > 1e-8f ? normal / length : glm::vec3(0.0f), 0.0f));
+}
+
+PackedTextureCoordinate packTextureCoordinate(const glm::vec2 &uv)
+{
+	return glm::packHalf2x16(uv);
+}
+
+bool packPositions(std::vector<PackedPosition> &packed, const GLfloat *positions, size_t count, int stride)
+{
+	packed.reserve(packed.size() + count);
+	for (size_t vertex = 0; vertex < count; vertex++)
+	{
+		const GLfloat *p = positions + vertex * stride;
+		const glm::vec3 position(p[0], p[1], p[2]);
+		if (glm::any(glm::greaterThan(glm::abs(position), glm::vec3(1.0f))))
+		{
+			cerr << "Vertex packing: vertex " << vertex << " is outside -1..1, so can't be a normalized position." << endl;
+			return false;
+		}
+		packed.push_back(packPosition(position));
+	}
+	return true;
+}
+
+void packNormals(std::vector<PackedNormal> &packed, const GLfloat *normals, size_t count, int stride)
+{
+	packed.reserve(packed.size() + count);
+	for (size_t vertex = 0; vertex < count; vertex++)
+	{
+		const GLfloat *n = normals + vertex * stride;
+		packed.push_back(packNormal(glm::vec3(n[0], n[1], n[2])));
+	}
+}
+
+void packTextureCoordinates(std::vector<PackedTextureCoordinate> &packed, const GLfloat *uvs, size_t count, int stride)
+{
+	packed.reserve(packed.size() + count);
+	for (size_t vertex = 0; vertex < count; vertex++)
+		packed.push_back(packTextureCoordinate(glm::vec2(uvs[vertex * stride], uvs[vertex * stride + 1])));
+}
+// end::vertexPacking[]
+
+// tag::packedVertexPointers[]
+//normalized, so the shader still sees floats - its inputs don't change with the format. Four-component
+//attributes feed vec3 inputs fine (w is dropped); GL_INT_2_10_10_10_REV can only be read as four components,
+//so the normal's two spare bits come through as a w the shader never reads
+void packedPositionPointer(GLuint location, GLsizei stride, size_t offset)
+{
+	glVertexAttribPointer(location, 4, GL_SHORT, GL_TRUE, stride, (GLvoid *)offset);
+}
+
+void packedHalfPositionPointer(GLuint location, GLsizei stride, size_t offset)
+{
+	glVertexAttribPointer(location, 4, GL_HALF_FLOAT, GL_FALSE, stride, (GLvoid *)offset);
+}
+
+void packedNormalPointer(GLuint location, GLsizei stride, size_t offset)
+{
+	glVertexAttribPointer(location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (GLvoid *)offset);
+}
+
+void packedTextureCoordinatePointer(GLuint location, GLsizei stride, size_t offset)
+{
+	glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, (GLvoid *)offset);
+}
+// end::packedVertexPointers[]
@@ -0,0 +1,46 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+
+// tag::packedVertexFormats[]
+//vertex attributes in the form the GPU reads them - the GLfloat arrays stay on the CPU, for bounds and the software renderer
+
+//16-bit normalized x, y, z and w = 1 (which keeps vertices 4-byte aligned) - the mesh must fit in -1..1, which leaves 1/32767 of error;
+//anything bigger is scaled up by its world matrix instead (as the skybox is)
+typedef uint64_t PackedPosition;
+//four half floats, w = 1 - for imported models, which can be any size
+typedef uint64_t PackedHalfPosition;
+//10 bits each for x, y and z (GL_INT_2_10_10_10_REV) - normalized first, so within a tenth of a degree
+typedef uint32_t PackedNormal;
+//two half floats - within 1/4096 anywhere in 0..1, and 0 and 1 exactly
+typedef uint32_t PackedTextureCoordinate;
+// end::packedVertexFormats[]
+
+// tag::vertexPacking[]
+PackedPosition packPosition(const glm::vec3 &position);
+PackedHalfPosition packHalfPosition(const glm::vec3 &position);
+PackedNormal packNormal(const glm::vec3 &normal); //a zero normal stays zero
+PackedTextureCoordinate packTextureCoordinate(const glm::vec2 &uv);
+
+//`count` vertices, `stride` floats apart, appended to `packed`
+//positions outside -1..1 would be clamped - packPositions says where and returns false instead
+bool packPositions(std::vector<PackedPosition> &packed, const GLfloat *positions, size_t count, int stride);
+void packNormals(std::vector<PackedNormal> &packed, const GLfloat *normals, size_t count, int stride);
+void packTextureCoordinates(std::vector<PackedTextureCoordinate> &packed, const GLfloat *uvs, size_t count, int stride);
+
+//the glVertexAttribPointer for each format, from the bound GL_ARRAY_BUFFER - stride 0 is tightly packed
+void packedPositionPointer(GLuint location, GLsizei stride, size_t offset);
+void packedHalfPositionPointer(GLuint location, GLsizei stride, size_t offset);
+void packedNormalPointer(GLuint location, GLsizei stride, size_t offset);
+void packedTextureCoordinatePointer(GLuint location, GLsizei stride, size_t offset);
+// end::vertexPacking[]
+
+#endif
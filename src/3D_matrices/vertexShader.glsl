@@ -1,21 +1,62 @@
 #version 330
+//permutations: LIT, TEXTURED, INSTANCED and MULTIVIEW are #defined (after #version) by initializeProgram
 in vec3 position;
-in vec3 vertexColor;
+in vec3 vertexColor; //the albedo - multiplies the lighting
+in vec3 normal;
 in vec2 texture;
+#ifdef INSTANCED
+in mat4 instanceMatrix; //modelMatrix * rotateMatrix, one per instance
+#endif
 
+#ifdef MULTIVIEW
+//the geometry shader projects each triangle once per view, and passes these on under their fragment* names
+#define fragmentPosition geometryPosition
+#define fragmentColor geometryColor
+#define fragmentNormal geometryNormal
+#define Texture geometryTexture
+#define fragmentViewDepth geometryViewDepth
+#endif
 out vec3 fragmentPosition;
 out vec3 fragmentColor;
+out vec3 fragmentNormal;
 out vec2 Texture;
+out float fragmentViewDepth;
 
-uniform mat4 modelMatrix      = mat4(1.0);
 uniform mat4 viewMatrix       = mat4(1.0);
 uniform mat4 projectionMatrix = mat4(1.0);
+#ifndef INSTANCED
+uniform mat4 modelMatrix      = mat4(1.0);
 uniform mat4 rotateMatrix = mat4(1.0);
+#endif
 
 void main()
 {
-		gl_Position = projectionMatrix * viewMatrix * modelMatrix * rotateMatrix * vec4(position, 1.0);
-		fragmentColor =  mat3(transpose(inverse(modelMatrix))) * vertexColor; 
-		fragmentPosition = vec3(modelMatrix * rotateMatrix * vec4(position, 1.0f));
+#ifdef INSTANCED
+		mat4 worldMatrix = instanceMatrix;
+#else
+		mat4 worldMatrix = modelMatrix * rotateMatrix;
+#endif
+#ifdef MULTIVIEW
+		gl_Position = worldMatrix * vec4(position, 1.0);
+		vec4 viewPosition = vec4(0.0);
+#else
+		vec4 viewPosition = viewMatrix * worldMatrix * vec4(position, 1.0);
+		gl_Position = projectionMatrix * viewPosition;
+#endif
+#ifdef LIT
+		fragmentNormal = mat3(transpose(inverse(worldMatrix))) * normal; //the same whether or not the draw was batched
+		fragmentColor = vertexColor;
+		fragmentPosition = vec3(worldMatrix * vec4(position, 1.0f));
+		fragmentViewDepth = -viewPosition.z;
+#else
+		fragmentNormal = vec3(0.0);
+		fragmentColor = vertexColor;
+		fragmentPosition = vec3(0.0);
+		fragmentViewDepth = 0.0;
+#endif
+#ifdef TEXTURED
 		Texture = texture;
+#else
+		Texture = vec2(0.0);
+#endif
 }
@@ -0,0 +1,345 @@
+#include "videoCapture.h"
+
+#include <iostream>
+#include <cstring>
+
+#define __STDC_CONSTANT_MACROS //libavutil uses UINT64_C
+extern "C" {
+	#include <libavcodec/avcodec.h>
+	#include <libavutil/frame.h>
+	#include <libavutil/opt.h>
+	#include <libswscale/swscale.h>
+}
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::encodeFrames[]
+//libavcodec 57.37 brought in send/receive, and FFmpeg 5 removed avcodec_encode_video2 - the old call is only
+//kept for older builds, like the vendored 57.10 on Windows
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100)
+//send a frame (or null, to drain the encoder) and write every packet that is ready - true if any were
+static bool encodeAndWrite(VideoCapture &capture, AVFrame *frame)
+{
+	if (avcodec_send_frame(capture.codec, frame) < 0)
+	{
+		cerr << "Capture: error encoding a frame." << endl;
+		return false;
+	}
+	AVPacket *packet = av_packet_alloc();
+	bool wrote = false;
+	for (;;)
+	{
+		int result = avcodec_receive_packet(capture.codec, packet);
+		if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+			break;
+		if (result < 0)
+		{
+			cerr << "Capture: error encoding a frame." << endl;
+			break;
+		}
+		fwrite(packet->data, 1, packet->size, capture.file); //raw Annex B stream - no container needed
+		av_packet_unref(packet);
+		wrote = true;
+	}
+	av_packet_free(&packet);
+	return wrote;
+}
+
+//a null frame drains everything the encoder still holds, in one go
+static void flushEncoder(VideoCapture &capture)
+{
+	encodeAndWrite(capture, nullptr);
+}
+#else
+//write whatever packets the encoder has ready - frame may be null to flush
+static bool encodeAndWrite(VideoCapture &capture, AVFrame *frame)
+{
+	AVPacket packet;
+	av_init_packet(&packet);
+	packet.data = nullptr;
+	packet.size = 0;
+
+	int gotPacket = 0;
+	if (avcodec_encode_video2(capture.codec, &packet, frame, &gotPacket) < 0)
+	{
+		cerr << "Capture: error encoding a frame." << endl;
+		return false;
+	}
+	if (gotPacket)
+	{
+		fwrite(packet.data, 1, packet.size, capture.file); //raw Annex B stream - no container needed
+		av_packet_unref(&packet);
+	}
+	return gotPacket != 0;
+}
+
+//each null frame gives back one delayed packet, until there are none
+static void flushEncoder(VideoCapture &capture)
+{
+	while (encodeAndWrite(capture, nullptr))
+		;
+}
+#endif
+
+static void encodeFrame(VideoCapture &capture, int index)
+{
+	//RGBA -> YUV 4:2:0, flipping GL's bottom-up rows with a negative stride
+	const int rowSize = capture.width * 4;
+	const unsigned char *pixels = capture.frames[index].data();
+	const uint8_t *source[1] = { pixels };
+	int sourceStride[1] = { rowSize };
+	if (capture.frameBottomUp[index])
+	{
+		source[0] = pixels + (capture.height - 1) * rowSize;
+		sourceStride[0] = -rowSize;
+	}
+	av_frame_make_writable(capture.picture);
+	sws_scale(capture.converter, source, sourceStride, 0, capture.height, capture.picture->data, capture.picture->linesize);
+
+	//the encoder needs strictly increasing timestamps
+	int64_t pts = capture.framePts[index];
+	if (pts <= capture.lastPts)
+		pts = capture.lastPts + 1;
+	capture.lastPts = pts;
+	capture.picture->pts = pts;
+
+	encodeAndWrite(capture, capture.picture);
+	capture.framesEncoded++;
+}
+
+static int encoderThreadMain(void *data)
+{
+	VideoCapture &capture = *(VideoCapture *)data;
+	for (;;)
+	{
+		SDL_LockMutex(capture.lock);
+		while (capture.pendingFrames.empty() && !capture.finishing)
+			SDL_CondWait(capture.wake, capture.lock);
+		if (capture.pendingFrames.empty()) //finishing, and nothing left
+		{
+			SDL_UnlockMutex(capture.lock);
+			break;
+		}
+		int index = capture.pendingFrames.front();
+		capture.pendingFrames.pop_front();
+		SDL_UnlockMutex(capture.lock);
+
+		encodeFrame(capture, index);
+
+		SDL_LockMutex(capture.lock);
+		capture.freeFrames.push_back(index);
+		SDL_UnlockMutex(capture.lock);
+	}
+
+	//delayed frames (B-frames, lookahead)
+	flushEncoder(capture);
+	return 0;
+}
+// end::encodeFrames[]
+
+// tag::startVideoCapture[]
+bool startVideoCapture(VideoCapture &capture, const std::string &filePath, int width, int height, int frameRate)
+{
+	capture.width = width;
+	capture.height = height;
+	capture.frameRate = frameRate;
+	capture.file = nullptr;
+	for (int i = 0; i < captureRingSize; i++)
+	{
+		capture.pixelBuffers[i] = 0;
+		capture.fences[i] = 0;
+		capture.bufferPts[i] = 0;
+	}
+	capture.framesIssued = 0;
+	capture.framesCollected = 0;
+	capture.finishing = false;
+	capture.lock = nullptr;
+	capture.wake = nullptr;
+	capture.encoderThread = nullptr;
+	capture.codec = nullptr;
+	capture.picture = nullptr;
+	capture.converter = nullptr;
+	capture.lastPts = -1;
+	capture.framesEncoded = 0;
+	capture.framesDropped = 0;
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+	avcodec_register_all(); //automatic from 58.9, and gone in FFmpeg 5
+#endif
+	const AVCodec *encoder = avcodec_find_encoder(AV_CODEC_ID_H264);
+	if (encoder == nullptr)
+	{
+		cerr << "Capture: this FFmpeg build has no H.264 encoder." << endl;
+		return false;
+	}
+
+	capture.codec = avcodec_alloc_context3(encoder);
+	capture.codec->width = width;
+	capture.codec->height = height;
+	capture.codec->time_base.num = 1;
+	capture.codec->time_base.den = frameRate;
+	capture.codec->gop_size = frameRate; //a keyframe a second, so the file can be seeked
+	capture.codec->pix_fmt = AV_PIX_FMT_YUV420P;
+	av_opt_set(capture.codec->priv_data, "preset", "veryfast", 0); //x264 - keep up in real time
+	if (avcodec_open2(capture.codec, encoder, nullptr) < 0)
+	{
+		cerr << "Capture: could not open the H.264 encoder." << endl;
+		avcodec_free_context(&capture.codec);
+		return false;
+	}
+
+	capture.picture = av_frame_alloc();
+	capture.picture->format = AV_PIX_FMT_YUV420P;
+	capture.picture->width = width;
+	capture.picture->height = height;
+	av_frame_get_buffer(capture.picture, 32);
+	capture.converter = sws_getContext(width, height, AV_PIX_FMT_RGBA, width, height, AV_PIX_FMT_YUV420P,
+	                                   SWS_BILINEAR, nullptr, nullptr, nullptr);
+
+	capture.file = fopen(filePath.c_str(), "wb");
+	if (capture.file == nullptr || capture.converter == nullptr)
+	{
+		cerr << "Capture: could not open " << filePath << " for writing." << endl;
+		stopVideoCapture(capture);
+		return false;
+	}
+
+	capture.frames.assign(captureQueueSize, std::vector<unsigned char>(width * height * 4));
+	capture.framePts.assign(captureQueueSize, 0);
+	capture.frameBottomUp.assign(captureQueueSize, false);
+	capture.freeFrames.clear();
+	for (int i = 0; i < captureQueueSize; i++)
+		capture.freeFrames.push_back(i);
+
+	capture.lock = SDL_CreateMutex();
+	capture.wake = SDL_CreateCond();
+	capture.encoderThread = SDL_CreateThread(encoderThreadMain, "encoder", &capture);
+	if (capture.encoderThread == nullptr)
+	{
+		cerr << "Capture: SDL_CreateThread Error: " << SDL_GetError() << endl;
+		stopVideoCapture(capture);
+		return false;
+	}
+
+	cout << "Capture: recording " << width << "x" << height << " at " << frameRate << " fps to " << filePath << " OK!\n";
+	return true;
+}
+// end::startVideoCapture[]
+
+// tag::captureFrame[]
+void captureFramePixels(VideoCapture &capture, const unsigned char *pixels, bool bottomRowFirst, int64_t pts)
+{
+	SDL_LockMutex(capture.lock);
+	if (capture.freeFrames.empty())
+	{
+		//the encoder is behind - drop this frame rather than hold up rendering
+		capture.framesDropped++;
+		SDL_UnlockMutex(capture.lock);
+		return;
+	}
+	int index = capture.freeFrames.back();
+	capture.freeFrames.pop_back();
+	SDL_UnlockMutex(capture.lock);
+
+	//the frame is ours until it is queued, so copy without holding the lock
+	memcpy(capture.frames[index].data(), pixels, capture.frames[index].size());
+	capture.framePts[index] = pts;
+	capture.frameBottomUp[index] = bottomRowFirst;
+
+	SDL_LockMutex(capture.lock);
+	capture.pendingFrames.push_back(index);
+	SDL_CondSignal(capture.wake);
+	SDL_UnlockMutex(capture.lock);
+}
+
+//map the oldest outstanding readback and queue it for the encoder
+static void collectOldestFrame(VideoCapture &capture)
+{
+	const int slot = capture.framesCollected % captureRingSize;
+	const GLuint64 timeout = 100000000; //100ms - only reached if the GPU is far behind
+	glClientWaitSync(capture.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+	glDeleteSync(capture.fences[slot]);
+	capture.fences[slot] = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pixelBuffers[slot]);
+	const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, capture.width * capture.height * 4, GL_MAP_READ_BIT);
+	if (pixels)
+	{
+		captureFramePixels(capture, (const unsigned char *)pixels, true, capture.bufferPts[slot]);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	capture.framesCollected++;
+}
+
+void captureFrame(VideoCapture &capture, int64_t pts)
+{
+	if (capture.pixelBuffers[0] == 0)
+	{
+		glGenBuffers(captureRingSize, capture.pixelBuffers);
+		for (int i = 0; i < captureRingSize; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pixelBuffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, capture.width * capture.height * 4, nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	//frames read back captureRingSize - 1 frames ago are done by now, so mapping them won't wait
+	while (capture.framesIssued - capture.framesCollected >= (uint64_t)(captureRingSize - 1) && capture.framesIssued > capture.framesCollected)
+		collectOldestFrame(capture);
+
+	//start an asynchronous readback into the next PBO - glReadPixels returns straight away
+	const int slot = capture.framesIssued % captureRingSize;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture.pixelBuffers[slot]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, capture.width, capture.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	capture.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	capture.bufferPts[slot] = pts;
+	capture.framesIssued++;
+}
+// end::captureFrame[]
+
+// tag::stopVideoCapture[]
+void stopVideoCapture(VideoCapture &capture)
+{
+	if (capture.pixelBuffers[0] != 0)
+	{
+		while (capture.framesCollected < capture.framesIssued)
+			collectOldestFrame(capture);
+		glDeleteBuffers(captureRingSize, capture.pixelBuffers);
+		capture.pixelBuffers[0] = 0;
+	}
+
+	if (capture.encoderThread)
+	{
+		SDL_LockMutex(capture.lock);
+		capture.finishing = true;
+		SDL_CondSignal(capture.wake);
+		SDL_UnlockMutex(capture.lock);
+		SDL_WaitThread(capture.encoderThread, nullptr); //encodes the queue, then flushes the encoder
+		capture.encoderThread = nullptr;
+		cout << "Capture: encoded " << capture.framesEncoded << " frames, dropped " << capture.framesDropped << endl;
+	}
+
+	if (capture.file)
+		fclose(capture.file);
+	capture.file = nullptr;
+	if (capture.converter)
+		sws_freeContext(capture.converter);
+	capture.converter = nullptr;
+	if (capture.picture)
+		av_frame_free(&capture.picture);
+	if (capture.codec)
+		avcodec_free_context(&capture.codec);
+	if (capture.wake)
+		SDL_DestroyCond(capture.wake);
+	capture.wake = nullptr;
+	if (capture.lock)
+		SDL_DestroyMutex(capture.lock);
+	capture.lock = nullptr;
+}
+// end::stopVideoCapture[]
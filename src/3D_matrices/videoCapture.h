@@ -0,0 +1,73 @@
+#ifndef VIDEO_CAPTURE_H
+#define VIDEO_CAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <SDL.h>
+
+struct AVCodecContext;
+struct AVFrame;
+struct SwsContext;
+
+// tag::videoCapture[]
+const int captureRingSize = 3; //PBOs - each is mapped captureRingSize - 1 frames after its glReadPixels
+const int captureQueueSize = 8; //frames waiting for the encoder - any more and new frames are dropped
+
+//records frames to a raw H.264 stream (libavcodec), without stalling the render thread:
+//glReadPixels goes into a ring of pixel buffer objects and is only mapped a couple of frames later,
+//and colour conversion (libswscale) and encoding happen on a worker thread
+struct VideoCapture
+{
+	int width;
+	int height;
+	int frameRate;
+	FILE *file;
+
+	//render thread only
+	GLuint pixelBuffers[captureRingSize]; //created on the first captureFrame, so CPU-only capture needs no GL
+	GLsync fences[captureRingSize];
+	int64_t bufferPts[captureRingSize];
+	uint64_t framesIssued;
+	uint64_t framesCollected;
+
+	//hand-over to the encoder thread, guarded by `lock`
+	std::vector<std::vector<unsigned char> > frames; //RGBA
+	std::vector<int64_t> framePts;
+	std::vector<bool> frameBottomUp; //glReadPixels rows come bottom row first
+	std::vector<int> freeFrames;
+	std::deque<int> pendingFrames;
+	bool finishing;
+	SDL_mutex *lock;
+	SDL_cond *wake;
+	SDL_Thread *encoderThread;
+
+	//encoder thread only
+	AVCodecContext *codec;
+	AVFrame *picture;
+	SwsContext *converter;
+	int64_t lastPts;
+
+	uint64_t framesEncoded;
+	uint64_t framesDropped;
+};
+
+//open the encoder and output file, and start the encoder thread - no GL calls
+bool startVideoCapture(VideoCapture &capture, const std::string &filePath, int width, int height, int frameRate);
+
+//read back the current read framebuffer (call after rendering, before the swap)
+//pts is in frames - pass the simulation tick so the video keeps game time
+void captureFrame(VideoCapture &capture, int64_t pts);
+
+//queue an RGBA frame that is already in memory (e.g. the software renderer's)
+void captureFramePixels(VideoCapture &capture, const unsigned char *pixels, bool bottomRowFirst, int64_t pts);
+
+//collect outstanding readbacks (needs the GL context if captureFrame was used), flush the encoder and close the file
+void stopVideoCapture(VideoCapture &capture);
+// end::videoCapture[]
+
+#endif
@@ -0,0 +1,124 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#include <SDL.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h>
+	#define BENCHMARK_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+	#define BENCHMARK_TSC
+#endif
+
+volatile float benchmarkSink = 0.0f;
+
+// tag::runBenchmark[]
+static uint64_t cycleCounter()
+{
+#ifdef BENCHMARK_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+//one sample - returns seconds, and the cycles it took
+static double timeSample(const BenchmarkBody &body, size_t iterations, uint64_t &cycles)
+{
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const uint64_t startCycles = cycleCounter();
+	body(iterations);
+	cycles = cycleCounter() - startCycles;
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static double medianOf(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	const size_t middle = values.size() / 2;
+	return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+bool runBenchmark(const BenchmarkSettings &settings, const std::string &name, const std::string &unit,
+                  const BenchmarkBody &body, BenchmarkResult &result)
+{
+	if (!settings.filter.empty() && name.find(settings.filter) == std::string::npos)
+		return false;
+
+	//enough iterations that the timer's resolution (and the call through body) is lost in the noise
+	uint64_t cycles;
+	size_t iterations = 1;
+	while (timeSample(body, iterations, cycles) * 1000.0 < settings.sampleMs && iterations < ((size_t)1 << 30))
+		iterations *= 2;
+	timeSample(body, iterations, cycles); //warm up - caches, branch predictors, clocks
+
+	std::vector<double> ns, cyclesPerOp;
+	for (int sample = 0; sample < settings.samples; sample++)
+	{
+		const double seconds = timeSample(body, iterations, cycles);
+		ns.push_back(seconds * 1e9 / iterations);
+		cyclesPerOp.push_back((double)cycles / iterations);
+	}
+
+	double mean = 0.0;
+	for (size_t i = 0; i < ns.size(); i++)
+		mean += ns[i];
+	mean /= ns.size();
+	double variance = 0.0;
+	for (size_t i = 0; i < ns.size(); i++)
+		variance += (ns[i] - mean) * (ns[i] - mean);
+	variance /= ns.size() > 1 ? ns.size() - 1 : 1;
+
+	result.name = name;
+	result.unit = unit;
+	result.iterations = iterations;
+	result.samples = settings.samples;
+	result.minNs = *std::min_element(ns.begin(), ns.end());
+	result.medianNs = medianOf(ns);
+	result.meanNs = mean;
+	result.stddevNs = std::sqrt(variance);
+	result.minCycles = *std::min_element(cyclesPerOp.begin(), cyclesPerOp.end());
+	result.medianCycles = medianOf(cyclesPerOp);
+	return true;
+}
+// end::runBenchmark[]
+
+// tag::benchmarkJson[]
+static std::string jsonNumber(double value)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%.4f", value);
+	return text;
+}
+
+std::string benchmarkJson(const std::vector<BenchmarkResult> &results, const std::string &transformKernel)
+{
+	std::ostringstream json;
+	json << "{\n";
+	json << "  \"platform\": \"" << SDL_GetPlatform() << "\",\n";
+	json << "  \"cpuCount\": " << SDL_GetCPUCount() << ",\n";
+	json << "  \"transformKernel\": \"" << transformKernel << "\",\n";
+	json << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult &result = results[i];
+		json << "    {\n";
+		json << "      \"name\": \"" << result.name << "\",\n";
+		json << "      \"unit\": \"" << result.unit << "\",\n";
+		json << "      \"iterations\": " << result.iterations << ",\n";
+		json << "      \"samples\": " << result.samples << ",\n";
+		json << "      \"nsPerOp\": { \"min\": " << jsonNumber(result.minNs) << ", \"median\": " << jsonNumber(result.medianNs)
+		     << ", \"mean\": " << jsonNumber(result.meanNs) << ", \"stddev\": " << jsonNumber(result.stddevNs) << " },\n";
+		json << "      \"cyclesPerOp\": { \"min\": " << jsonNumber(result.minCycles) << ", \"median\": " << jsonNumber(result.medianCycles) << " }\n";
+		json << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n";
+	json << "}\n";
+	return json.str();
+}
+// end::benchmarkJson[]
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+// tag::benchmark[]
+//runs the operation being timed `iterations` times
+typedef std::function<void(size_t iterations)> BenchmarkBody;
+
+struct BenchmarkSettings
+{
+	int samples; //timed samples per benchmark - the statistics are over these
+	double sampleMs; //each sample runs enough iterations to take at least this long
+	std::string filter; //only run benchmarks whose name contains this
+};
+
+//per-operation timings, over the samples
+struct BenchmarkResult
+{
+	std::string name;
+	std::string unit; //what one operation is, e.g. "tick" or "matrix"
+	size_t iterations; //per sample
+	int samples;
+	double minNs;
+	double medianNs;
+	double meanNs;
+	double stddevNs;
+	double minCycles; //from the time stamp counter - 0 where there isn't one
+	double medianCycles;
+};
+
+//time body: double the iterations until a sample takes settings.sampleMs, warm up with one sample, then take
+//settings.samples. Returns false (leaving result alone) if the filter skips it
+bool runBenchmark(const BenchmarkSettings &settings, const std::string &name, const std::string &unit,
+                  const BenchmarkBody &body, BenchmarkResult &result);
+
+//results as a JSON document, with enough about the machine to tell runs apart
+std::string benchmarkJson(const std::vector<BenchmarkResult> &results, const std::string &transformKernel);
+// end::benchmark[]
+
+// tag::doNotOptimize[]
+//results fed in here count as used, so the compiler can't drop the work that produced them
+extern volatile float benchmarkSink;
+
+inline void keepResult(float value)
+{
+	benchmarkSink = value;
+}
+// end::doNotOptimize[]
+
+#endif
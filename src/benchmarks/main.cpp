@@ -0,0 +1,344 @@
+//microbenchmarks for the game's hot paths - writes the results as JSON, to compare one commit with another
+//built from the same sources as 3D_matrices (see premake5.lua), so it times the code the game actually runs
+
+// tag::includes[]
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+#include <SDL.h>
+
+#define GLM_FORCE_RADIANS // suppress a warning in GLM 0.9.5
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "benchmark.h"
+#include "shaderVariants.h"
+#include "batchTransforms.h"
+#include "imageLoader.h"
+// end::includes[]
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// tag::gameHooks[]
+//the game's simulation, from 3D_matrices/main.cpp
+extern bool go;
+void updateSimulation(double simLength);
+bool ballOnPaddle(const glm::vec3 &ball, const glm::vec3 &paddle);
+bool verifyBuiltInMeshes();
+// end::gameHooks[]
+
+// tag::benchmarkData[]
+const size_t batchSize = 1024; //objects per batch - the loops below cycle through it
+uint32_t benchmarkRandom = 12345; //a fixed seed, so every run times the same data
+
+float randomUnit() //-1 to 1
+{
+	benchmarkRandom = benchmarkRandom * 1664525u + 1013904223u;
+	return (benchmarkRandom >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+glm::vec3 randomVec3(float scale)
+{
+	float x = randomUnit(), y = randomUnit(), z = randomUnit();
+	return glm::vec3(x, y, z) * scale;
+}
+// end::benchmarkData[]
+
+// tag::simulationBenchmarks[]
+//one sim tick, mid rally - a point that ends is served again straight away, so every tick moves the ball
+void benchmarkSimulation(size_t iterations)
+{
+	for (size_t i = 0; i < iterations; i++)
+	{
+		go = true;
+		updateSimulation(1.0 / 60.0);
+	}
+}
+
+std::vector<glm::vec3> ballPositions, paddlePositions;
+
+//the ball-paddle test, against positions spread over the arena
+void benchmarkCollision(size_t iterations)
+{
+	int hits = 0;
+	for (size_t i = 0; i < iterations; i++)
+		hits += ballOnPaddle(ballPositions[i % batchSize], paddlePositions[i % batchSize]) ? 1 : 0;
+	keepResult((float)hits);
+}
+// end::simulationBenchmarks[]
+
+// tag::cameraBenchmarks[]
+//the camera and animation calls made every frame - the inputs vary so none of it can be hoisted out of the loop
+void benchmarkLookAt(size_t iterations)
+{
+	const glm::vec3 up(0.0f, 1.0f, 0.0f);
+	float sum = 0.0f;
+	for (size_t i = 0; i < iterations; i++)
+	{
+		const glm::vec3 &eye = ballPositions[i % batchSize];
+		sum += glm::lookAt(eye + glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(eye.x, eye.y, 0.0f), up)[3][2];
+	}
+	keepResult(sum);
+}
+
+void benchmarkPerspective(size_t iterations)
+{
+	float sum = 0.0f;
+	for (size_t i = 0; i < iterations; i++)
+		sum += glm::perspective(45.0f, 1.0f + (float)(i % 64) / 64.0f, 0.1f, 100.0f)[0][0];
+	keepResult(sum);
+}
+
+void benchmarkRotate(size_t iterations)
+{
+	const glm::vec3 unit45 = glm::normalize(glm::vec3(0, 1, 1));
+	glm::mat4 rotateMatrix(1.0f);
+	for (size_t i = 0; i < iterations; i++)
+		rotateMatrix = glm::rotate(rotateMatrix, 1.0f / 60.0f, unit45);
+	keepResult(rotateMatrix[0][0]);
+}
+
+//the same spin as a quaternion, as the ball's orientation is kept now
+void benchmarkQuaternionSpin(size_t iterations)
+{
+	const glm::quat step = glm::angleAxis(1.0f / 60.0f, glm::normalize(glm::vec3(0, 1, 1)));
+	glm::quat orientation(1.0f, 0.0f, 0.0f, 0.0f);
+	for (size_t i = 0; i < iterations; i++)
+		orientation = orientation * step;
+	keepResult(orientation.w);
+}
+// end::cameraBenchmarks[]
+
+// tag::uploadBenchmarks[]
+std::vector<ObjectParameters> objects;
+std::vector<glm::mat4> instanceMatrices;
+std::vector<float> transformValues[10]; //position xyz, rotation xyzw, scale xyz
+TransformArrays transforms;
+
+//what the render queue does for each draw in an instanced run - model * rotate into the instance stream
+void benchmarkInstanceMatrices(size_t iterations)
+{
+	for (size_t done = 0; done < iterations; done += batchSize)
+	{
+		const size_t count = std::min(batchSize, iterations - done);
+		for (size_t j = 0; j < count; j++)
+			instanceMatrices[j] = objects[j].modelMatrix * objects[j].rotateMatrix;
+	}
+	keepResult(instanceMatrices[0][3][0]);
+}
+
+//world matrices from position, rotation and scale, with one of the batched kernels
+BenchmarkBody worldMatricesBenchmark(TransformKernel kernel)
+{
+	return [kernel](size_t iterations)
+	{
+		for (size_t done = 0; done < iterations; done += batchSize)
+			buildWorldMatrices(kernel, transforms, std::min(batchSize, iterations - done), &instanceMatrices[0]);
+		keepResult(instanceMatrices[0][3][0]);
+	};
+}
+
+std::vector<float> orientationValues[4], stepValues[4], blendValues[4];
+OrientationArrays orientations, steps, blends;
+
+//a tick of spin for every object - one orientation each
+void benchmarkIntegrateOrientations(size_t iterations)
+{
+	for (size_t done = 0; done < iterations; done += batchSize)
+		integrateOrientations(orientations, steps, std::min(batchSize, iterations - done));
+	renormalizeOrientations(orientations, batchSize); //once per sample, as the game does every so often
+	keepResult(orientations.w[0]);
+}
+
+void benchmarkSlerpOrientations(size_t iterations)
+{
+	for (size_t done = 0; done < iterations; done += batchSize)
+		slerpOrientations(orientations, steps, 0.3f, blends, std::min(batchSize, iterations - done));
+	keepResult(blends.w[0]);
+}
+// end::uploadBenchmarks[]
+
+// tag::imageBenchmarks[]
+const int benchmarkImageSize = 256;
+std::vector<unsigned char> bmpFile; //a 24 bit BMP, in memory so the disk isn't timed
+SDL_Surface *bmpSurface = nullptr; //the same, already loaded
+
+bool createBenchmarkImage()
+{
+	//blue, green, red in memory - how a 24 bit BMP stores its pixels
+	SDL_Surface *surface = SDL_CreateRGBSurface(0, benchmarkImageSize, benchmarkImageSize, 24, 0xff0000, 0x00ff00, 0x0000ff, 0);
+	if (surface == nullptr)
+	{
+		cerr << "SDL_CreateRGBSurface Error: " << SDL_GetError() << endl;
+		return false;
+	}
+	for (int y = 0; y < surface->h; y++)
+	{
+		unsigned char *row = (unsigned char *)surface->pixels + y * surface->pitch;
+		for (int x = 0; x < surface->w * 3; x++)
+			row[x] = (unsigned char)(x * 7 + y * 13);
+	}
+
+	bmpFile.resize(benchmarkImageSize * benchmarkImageSize * 3 + 1024);
+	SDL_RWops *file = SDL_RWFromMem(&bmpFile[0], (int)bmpFile.size());
+	const bool saved = SDL_SaveBMP_RW(surface, file, 0) == 0;
+	bmpFile.resize((size_t)SDL_RWtell(file));
+	SDL_RWclose(file);
+	SDL_FreeSurface(surface);
+	if (!saved)
+	{
+		cerr << "SDL_SaveBMP_RW Error: " << SDL_GetError() << endl;
+		return false;
+	}
+	bmpSurface = SDL_LoadBMP_RW(SDL_RWFromConstMem(&bmpFile[0], (int)bmpFile.size()), 1);
+	return bmpSurface != nullptr;
+}
+
+//the whole of decoding an asset that is still a .bmp - parse, then swizzle BGR into RGBA texels
+void benchmarkBmpDecode(size_t iterations)
+{
+	DecodedImage image;
+	for (size_t i = 0; i < iterations; i++)
+	{
+		SDL_Surface *surface = SDL_LoadBMP_RW(SDL_RWFromConstMem(&bmpFile[0], (int)bmpFile.size()), 1);
+		convertDecodedSurface(image, surface);
+		SDL_FreeSurface(surface);
+	}
+	keepResult((float)image.texels[0]);
+}
+
+//just the swizzle
+void benchmarkBmpSwizzle(size_t iterations)
+{
+	DecodedImage image;
+	for (size_t i = 0; i < iterations; i++)
+		convertDecodedSurface(image, bmpSurface);
+	keepResult((float)image.texels[0]);
+}
+// end::imageBenchmarks[]
+
+// tag::benchmarkSetup[]
+void createBenchmarkData()
+{
+	for (size_t i = 0; i < batchSize; i++)
+	{
+		ballPositions.push_back(randomVec3(0.9f));
+		paddlePositions.push_back(glm::vec3(0.8f, randomUnit() * 0.8f, 0.0f));
+
+		const glm::vec3 position = randomVec3(10.0f);
+		const glm::quat rotation = glm::normalize(glm::quat(randomUnit(), randomUnit(), randomUnit(), randomUnit()));
+		const glm::vec3 scale = glm::vec3(1.0f) + randomVec3(0.5f);
+		ObjectParameters object;
+		object.modelMatrix = glm::translate(glm::mat4(1.0f), position);
+		object.rotateMatrix = glm::mat4_cast(rotation);
+		objects.push_back(object);
+
+		const float values[10] = { position.x, position.y, position.z, rotation.x, rotation.y, rotation.z, rotation.w, scale.x, scale.y, scale.z };
+		for (int v = 0; v < 10; v++)
+			transformValues[v].push_back(values[v]);
+	}
+	for (size_t i = 0; i < batchSize; i++)
+	{
+		const glm::quat step = glm::angleAxis(0.02f, glm::normalize(randomVec3(1.0f) + glm::vec3(0.0f, 0.0f, 2.0f)));
+		const float values[4] = { step.x, step.y, step.z, step.w };
+		for (int c = 0; c < 4; c++)
+		{
+			orientationValues[c].push_back(transformValues[3 + c][i]);
+			stepValues[c].push_back(values[c]);
+			blendValues[c].push_back(0.0f);
+		}
+	}
+	const OrientationArrays orientationArrays = { &orientationValues[0][0], &orientationValues[1][0], &orientationValues[2][0], &orientationValues[3][0] };
+	const OrientationArrays stepArrays = { &stepValues[0][0], &stepValues[1][0], &stepValues[2][0], &stepValues[3][0] };
+	const OrientationArrays blendArrays = { &blendValues[0][0], &blendValues[1][0], &blendValues[2][0], &blendValues[3][0] };
+	orientations = orientationArrays;
+	steps = stepArrays;
+	blends = blendArrays;
+	instanceMatrices.resize(batchSize);
+	const TransformArrays arrays = { &transformValues[0][0], &transformValues[1][0], &transformValues[2][0], &transformValues[3][0],
+	                                 &transformValues[4][0], &transformValues[5][0], &transformValues[6][0], &transformValues[7][0],
+	                                 &transformValues[8][0], &transformValues[9][0] };
+	transforms = arrays;
+}
+// end::benchmarkSetup[]
+
+// tag::main[]
+int main(int argc, char* args[])
+{
+	BenchmarkSettings settings;
+	settings.samples = 25;
+	settings.sampleMs = 5.0;
+	std::string jsonPath = "benchmarks.json";
+	bool verifyOnly = false; //--verify: the self-checks below, without timing anything - quick enough for every CI run
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = args[i];
+		if (arg == "--samples" && i + 1 < argc) settings.samples = std::max(atoi(args[++i]), 2);
+		else if (arg == "--sample-ms" && i + 1 < argc) settings.sampleMs = atof(args[++i]);
+		else if (arg == "--filter" && i + 1 < argc) settings.filter = args[++i];
+		else if (arg == "--json" && i + 1 < argc) jsonPath = args[++i];
+		else if (arg == "--verify") verifyOnly = true;
+		else cerr << "Ignoring unknown argument " << arg << std::endl;
+	}
+
+	if (!verifyTransformKernels() || !verifyBuiltInMeshes())
+		return 1;
+	if (verifyOnly)
+		return 0;
+
+	createBenchmarkData();
+	if (!createBenchmarkImage())
+		return 1;
+
+	std::vector<BenchmarkResult> results;
+	BenchmarkResult result;
+	struct { const char *name; const char *unit; BenchmarkBody body; } benchmarks[] = {
+		{ "updateSimulation", "tick", benchmarkSimulation },
+		{ "ballOnPaddle", "check", benchmarkCollision },
+		{ "lookAt", "matrix", benchmarkLookAt },
+		{ "perspective", "matrix", benchmarkPerspective },
+		{ "rotate", "matrix", benchmarkRotate },
+		{ "quaternionSpin", "step", benchmarkQuaternionSpin },
+		{ "instanceMatrices", "matrix", benchmarkInstanceMatrices },
+		{ "buildWorldMatrices/scalar", "matrix", worldMatricesBenchmark(TRANSFORM_KERNEL_SCALAR) },
+		{ "buildWorldMatrices/SSE", "matrix", worldMatricesBenchmark(TRANSFORM_KERNEL_SSE) },
+		{ "buildWorldMatrices/AVX2", "matrix", worldMatricesBenchmark(TRANSFORM_KERNEL_AVX2) },
+		{ "integrateOrientations", "orientation", benchmarkIntegrateOrientations },
+		{ "slerpOrientations", "orientation", benchmarkSlerpOrientations },
+		{ "bmpDecode", "256x256 image", benchmarkBmpDecode },
+		{ "bmpSwizzle", "256x256 image", benchmarkBmpSwizzle },
+	};
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	{
+		//a kernel the CPU can't run would only time the fallback again
+		if (std::string(benchmarks[i].name) == "buildWorldMatrices/AVX2" && bestTransformKernel() < TRANSFORM_KERNEL_AVX2)
+			continue;
+		if (std::string(benchmarks[i].name) == "buildWorldMatrices/SSE" && bestTransformKernel() < TRANSFORM_KERNEL_SSE)
+			continue;
+		if (!runBenchmark(settings, benchmarks[i].name, benchmarks[i].unit, benchmarks[i].body, result))
+			continue;
+		results.push_back(result);
+		printf("%-28s %10.2f ns/%s (min %.2f, stddev %.2f) %10.1f cycles\n", result.name.c_str(), result.medianNs,
+		       result.unit.c_str(), result.minNs, result.stddevNs, result.medianCycles);
+	}
+	SDL_FreeSurface(bmpSurface);
+
+	std::ofstream json(jsonPath.c_str());
+	json << benchmarkJson(results, transformKernelName(bestTransformKernel()));
+	if (!json)
+	{
+		cerr << "Could not write " << jsonPath << endl;
+		return 1;
+	}
+	cout << "Wrote " << results.size() << " results to " << jsonPath << " OK!" << endl;
+	return 0;
+}
+// end::main[]